@@ -0,0 +1,54 @@
+#include "AdaptiveThreshold.h"
+#include <algorithm>
+#include <cmath>
+
+using namespace std;
+
+AdaptiveThreshold::AdaptiveThreshold(int initial) : current(initial) {}
+
+int AdaptiveThreshold::update(const int* hist, int bins, int shift, int total)
+{
+    if(total == 0) return current;
+
+    // median and start of the bright tail
+    int median = -1, tail = bins - 1;
+    int cumulative = 0;
+    for(int i = 0; i < bins; i++){
+        cumulative += hist[i];
+        if(median == -1 && cumulative >= total / 2) median = i;
+        if(cumulative >= total * TAIL_START){
+            tail = i;
+            break;
+        }
+    }
+
+    // Otsu on [tail, bins)
+    double sum = 0, count = 0;
+    for(int i = tail; i < bins; i++){
+        sum += (double)i * hist[i];
+        count += hist[i];
+    }
+    int otsu = tail;
+    double sumBelow = 0, countBelow = 0, bestVariance = 0;
+    for(int i = tail; i < bins - 1; i++){
+        countBelow += hist[i];
+        sumBelow += (double)i * hist[i];
+        double countAbove = count - countBelow;
+        if(countBelow == 0 || countAbove == 0) continue;
+        double meanBelow = sumBelow / countBelow;
+        double meanAbove = (sum - sumBelow) / countAbove;
+        double variance = countBelow * countAbove * (meanBelow - meanAbove) * (meanBelow - meanAbove);
+        if(variance > bestVariance){
+            bestVariance = variance;
+            otsu = i + 1;
+        }
+    }
+
+    int computed = max(otsu << shift, max((median << shift) * AMBIENT_FACTOR, MIN_THRESHOLD));
+
+    // hysteresis, small changes are ignored so blobs do not flicker on the threshold
+    if(abs(computed - current) > current * HYSTERESIS){
+        current += (int)((computed - current) * SMOOTHING);
+    }
+    return current;
+}
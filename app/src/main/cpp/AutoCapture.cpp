@@ -0,0 +1,105 @@
+#include "AutoCapture.h"
+#include "Util.h"
+
+AutoCapture::AutoCapture()
+{
+    reset();
+}
+
+void AutoCapture::reset()
+{
+    buckets.assign(BUCKETS, vector<int>());
+    visited.assign(BUCKETS, false);
+    stableFrames = 0;
+    captured = false;
+}
+
+int AutoCapture::bucketOf(float depth) const
+{
+    int bucket = (int)floor((depth - NEAREST) / BUCKET_SIZE);
+    return bucket >= 0 && bucket < BUCKETS ? bucket : -1;
+}
+
+void AutoCapture::add(int index, float depth)
+{
+    int bucket = bucketOf(depth);
+    if(bucket == -1) return;
+    buckets[bucket].push_back(index);
+    visited[bucket] = true;
+}
+
+bool AutoCapture::update(bool valid, Point2i uv, float depth)
+{
+    if(!valid){
+        stableFrames = 0;
+        return false;
+    }
+    Point2i moved = uv - stillPoint;
+    if(stableFrames == 0 || abs(moved.x) > STILL_DISTANCE || abs(moved.y) > STILL_DISTANCE
+       || fabs(depth - stillDepth) > STILL_DEPTH){
+        stillPoint = uv;
+        stillDepth = depth;
+        stableFrames = 0;
+    }
+    if(++stableFrames < STABLE_FRAMES) return false;
+
+    int bucket = bucketOf(depth);
+    if(bucket == -1) return false;
+    visited[bucket] = true;
+
+    // the same pose is taken once, the marker should be moved for the next point
+    Point2i separation = uv - lastCapture;
+    if(captured && abs(separation.x) < MIN_SEPARATION && abs(separation.y) < MIN_SEPARATION
+       && bucket == bucketOf(lastCaptureDepth)){
+        return false;
+    }
+
+    int least = PER_BUCKET;
+    for(int b = 0; b < BUCKETS; b++){
+        if(visited[b]) least = min(least, (int)buckets[b].size());
+    }
+    int count = (int)buckets[bucket].size();
+    if(count >= PER_BUCKET || count > least) return false; // other depths are behind
+
+    pendingCapture = uv;
+    pendingDepth = depth;
+    stableFrames = 0;
+    LOGD("Auto capture: averaging a point at %.1f cm, bucket %d has %d points", depth, bucket, count);
+    return true;
+}
+
+void AutoCapture::finish(bool saved)
+{
+    // a rejected pose is taken again once the blob holds still
+    if(!saved) return;
+    lastCapture = pendingCapture;
+    lastCaptureDepth = pendingDepth;
+    captured = true;
+}
+
+int AutoCapture::neededDepth() const
+{
+    // the range grows outwards from the depths which are sampled already
+    int full = 0, points = 0;
+    float center = 0;
+    for(int b = 0; b < BUCKETS; b++){
+        int count = (int)buckets[b].size();
+        if(count >= PER_BUCKET) full++;
+        points += count;
+        center += b * count;
+    }
+    if(full >= COMPLETE_BUCKETS) return -1;
+    center = points > 0 ? center / points : BUCKETS / 2;
+
+    int least = -1;
+    for(int b = 0; b < BUCKETS; b++)
+    {
+        int count = (int)buckets[b].size();
+        if(count >= PER_BUCKET) continue;
+        if(least == -1 || count < (int)buckets[least].size()
+           || (count == (int)buckets[least].size() && fabs(b - center) < fabs(least - center))){
+            least = b;
+        }
+    }
+    return (int)(NEAREST + (least + 0.5f) * BUCKET_SIZE);
+}
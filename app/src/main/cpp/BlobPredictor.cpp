@@ -0,0 +1,44 @@
+#include "BlobPredictor.h"
+
+BlobPredictor::BlobPredictor(){}
+
+void BlobPredictor::reset()
+{
+    previous.clear();
+    previousTimestamp = 0;
+}
+
+void BlobPredictor::predict(vector<int> &centers, int64_t timestamp, int64_t latency, Size bounds)
+{
+    vector<Point2f> current;
+    for(int i = 0; i + 1 < (int)centers.size(); i += 2){
+        current.push_back(Point2f(centers[i], centers[i+1]));
+    }
+
+    double dt = (double)(timestamp - previousTimestamp);
+    if(previousTimestamp != 0 && dt > 0 && latency > 0)
+    {
+        for(int i = 0; i < (int)current.size(); i++)
+        {
+            // nearest blob of the previous frame is assumed to be the same marker
+            int match = -1;
+            float best = MAX_MATCH_DISTANCE;
+            for(int j = 0; j < (int)previous.size(); j++){
+                float d = (float)norm(current[i] - previous[j]);
+                if(d < best){
+                    best = d;
+                    match = j;
+                }
+            }
+            if(match == -1) continue;
+
+            Point2f velocity = (current[i] - previous[match]) * (float)(1.0 / dt); // pro. pixel per us
+            Point2f predicted = current[i] + velocity * (float)latency;
+            centers[2*i]   = min(max((int)predicted.x, 0), bounds.width);
+            centers[2*i+1] = min(max((int)predicted.y, 0), bounds.height);
+        }
+    }
+
+    previous = current;
+    previousTimestamp = timestamp;
+}
@@ -5,7 +5,11 @@
 #include "Calibrator.h"
 #include "Util.h"
 
-Calibrator::Calibrator()
+// Markers of the calibration board relative to the projector center, in pro. pixel.
+// No two markers are related by a rotation or a mirror, so every marker is identified.
+static const Point2f CONSTELLATION[] = {{0, 0}, {-360, -200}, {-60, -220}, {300, -120}, {-200, 180}};
+
+Calibrator::Calibrator() : retroThreshold(RETRO_THRESHOLD)
 {
     //LOGD("Calibrator is created.");
     pattern = Mat::zeros(101,101,CV_8UC1);
@@ -34,11 +38,50 @@ void Calibrator::setMode(int i){
             currentMode = TEST;
             LOGD("Mode: TEST");
             break;
+        case 5:
+            currentMode = SCAN;
+            LOGD("Mode: SCAN");
+            break;
         default:
             currentMode = UNKNOWN;
             LOGD("Mode: UNKNOWN (%d)", i);
             break;
     }
+    changeGate.invalidate();
+    averager.cancel();
+    autoAveraging = false;
+    // calibration pattern is projected only in calibration mode
+    output.setPattern(currentMode == CALIBRATION ? calibrationPattern() : Mat());
+    if(currentMode == SCAN) startScan();
+}
+
+const Mat& Calibrator::calibrationPattern() const
+{
+    return constellationEnabled && !constellationPattern.empty() ? constellationPattern : pattern;
+}
+
+void Calibrator::setOverlayBitmaps(JNIEnv* env, jobject first, jobject second)
+{
+    lock_guard<mutex> lock (outputMutex);
+    callbackManager.setOverlayBitmaps(env, first, second);
+    output.setSize(callbackManager.overlaySize(), Size(projector.width, projector.height));
+}
+
+void Calibrator::setOutputCadence(int hz)
+{
+    output.setCadence(hz);
+}
+
+// Not locked with flagMutex, it runs on the UI thread and the output stage has its own lock
+int Calibrator::onVsync(JNIEnv* env)
+{
+    int64_t captureTime = 0;
+    int buffer = output.onVsync(callbackManager, env, captureTime);
+    if(buffer != -1){
+        // the buffer is drawn in this display frame
+        latency.record(LatencyMonitor::DISPLAY, captureTime);
+    }
+    return buffer;
 }
 
 Vec4d Calibrator::getCalibration(){
@@ -48,9 +91,58 @@ Vec4d Calibrator::getCalibration(){
 void Calibrator::setCalibration(double* arr){
     lock_guard<mutex> lock (flagMutex);
     calibration_result = Vec4d(arr[0], arr[1], arr[2], arr[3]);
+    updateMapping();
+    changeGate.invalidate();
     LOGD("Calibration loaded = %f %f %f %f", calibration_result[0], calibration_result[1],calibration_result[2],calibration_result[3]);
 }
 
+void Calibrator::setLensParameters (LensParameters lensParameters)
+{
+    {
+        lock_guard<mutex> lock (flagMutex);
+        CamListener::setLensParameters(lensParameters);
+        depthSampler.setLens(cameraMatrix);
+    }
+    lock_guard<mutex> lock (outputMutex);
+    undistortedPreview.create(cameraMatrix, distortionCoefficients, Size(camera.width, camera.height));
+}
+
+void Calibrator::setUndistortedPreview(bool enabled)
+{
+    lock_guard<mutex> lock (outputMutex);
+    undistorting = enabled;
+    LOGD("Undistorted preview: %s", enabled ? "ON" : "OFF");
+}
+
+void Calibrator::setPrediction(bool enabled)
+{
+    lock_guard<mutex> lock (flagMutex);
+    prediction = enabled;
+    changeGate.invalidate();
+    predictor.reset();
+    LOGD("Latency compensation: %s", enabled ? "ON" : "OFF");
+}
+
+void Calibrator::setPyramid(bool enabled)
+{
+    lock_guard<mutex> lock (flagMutex);
+    pyramidEnabled = enabled;
+    changeGate.invalidate();
+    LOGD("Pyramid detection: %s", enabled ? "ON" : "OFF");
+}
+
+void Calibrator::learnBackground()
+{
+    lock_guard<mutex> lock (flagMutex);
+    staticMask.reset();
+    changeGate.invalidate();
+}
+
+void Calibrator::onFrameShown(int64_t captureTime)
+{
+    latency.record(LatencyMonitor::DISPLAY, captureTime);
+}
+
 void Calibrator::setProjector(int width, int height, double v_fov, double h_fov)
 {
     projector.width = width;
@@ -58,126 +150,559 @@ void Calibrator::setProjector(int width, int height, double v_fov, double h_fov)
     projector.vertical_fov = v_fov * deg2rad;
     projector.horizontal_fov = h_fov * deg2rad;
     if(camera.width != 0){
-        x_scale = sin(camera.vertical_fov/2) / sin(projector.vertical_fov/2);
-        y_scale = sin(camera.horizontal_fov/2) / sin(projector.horizontal_fov/2);
-        x_offset = (double)projector.width * (x_scale -1) / 2 ;
-        y_offset = (double)projector.height * (y_scale -1) / 2;
+        updateScale();
+        updateMapping();
+        updateConstellation();
     }
     LOGD("Projector setted: w,h  %d , %d \t fov = %.2f , %.2f", width, height,v_fov,h_fov);
 }
 
-void Calibrator::onNewData (const DepthData *data)
+int Calibrator::requiredStreams()
 {
     lock_guard<mutex> lock (flagMutex);
-    updateMaps(data);
-
-    // Only show depth map and return, no need for retro finding
-    if(currentMode == DEPTH){
-        vector<Mat> channels(3);
-        split(xyzMap, channels);
-        channels[2].at<float>(0,0) = MAX_RANGE;
-        normalize(channels[2], channels[2], 0, 255, NORM_MINMAX, CV_8UC1);
-        applyColorMap(channels[2], outputImage, COLORMAP_JET);
-        callbackManager.sendImageToJavaSide(outputImage);
+    // Depth preview needs only z, the other modes need gray value for retro finding
+    return currentMode == DEPTH ? DEPTH_IMAGE : DEPTH_DATA;
+}
+
+bool Calibrator::needsTileSums()
+{
+    lock_guard<mutex> lock (flagMutex);
+    return currentMode == TEST; // the change gate runs in TEST mode only
+}
+
+void Calibrator::detectFrame(Frame &frame)
+{
+    latency.record(LatencyMonitor::INGEST, frame.timestamp);
+    int64_t start = LatencyMonitor::now();
+    frame.mode = currentMode;
+    frame.reused = false;
+    frame.centers.clear();
+    frame.capturedPoints = frame.addedPoints = frame.rejectedPoints = 0;
+
+    // Depth map is only shown, no need for retro finding
+    if(currentMode == DEPTH) return;
+
+    if(!frame.has(Frame::GRAY)){
+        frame.mode = UNKNOWN; // a frame of the previous stream after a mode change
+        return;
+    }
+
+    if(currentMode == SCAN){
+        scanFrame(frame);
+        return;
+    }
+
+    // Stationary markers, the blobs on the display are still valid
+    if(currentMode == TEST && frame.has(Frame::TILES) && changeGate.unchanged(frame.tileSums)){
+        frame.reused = true;
+        frame.centers = lastCenters;
         return;
     }
 
     // Find retro blobs
-    threshold(grayImage, grayBin, RETRO_THRESHOLD, 255, CV_THRESH_BINARY);
-    grayBin.convertTo(grayBin, CV_8UC1);
-    findContours(grayBin, retro_contours, CV_RETR_EXTERNAL, CV_CHAIN_APPROX_SIMPLE, Point(0, 0));
+    int retro = retroThreshold.update(frame.grayHistogram, Frame::HIST_BINS, Frame::HIST_SHIFT,
+                                      Frame::histogramSamples(camera.width, camera.height));
+    frame.threshold = retro;
+    int step = frame.level >= FrameScheduler::DECIMATED ? 2 : 1; // shed by the scheduler
+    if(frame.flipped != maskFlip){
+        maskFlip = frame.flipped;
+        staticMask.reset(); // learned pixels are mirrored
+    }
+    segmenter.setSuppression(staticMask.bits(), staticMask.words());
+    pyramid.setSuppression(staticMask.bits(), staticMask.words());
+    // static mask is learned and updated from the mask of the whole frame
+    if(pyramidEnabled){
+        pyramid.detect(frame.grayImage, retro, blobs, step);
+        if(step == 1) staticMask.update(pyramid.packedMask(), frame.grayImage.rows, pyramid.packedWords());
+    }
+    else{
+        segmenter.segment(frame.grayImage, retro, blobs, step);
+        if(step == 1) staticMask.update(segmenter.packedMask(), frame.grayImage.rows, segmenter.packedWords());
+    }
 
-    if(currentMode == GRAY){
-        normalize(grayImage, outputImage, 0, 255, NORM_MINMAX, CV_8UC1);
-        cvtColor(outputImage, outputImage, COLOR_GRAY2BGR);
-        for( int i = 0; i< (int)retro_contours.size(); i++)
-        {
-            drawContours( outputImage, retro_contours, i, Scalar(255,0,255),-1,8);
+    // the preview shows the pixels the segmentation kept, a learned static reflection is not painted
+    frame.retroWords = 0;
+    if(currentMode == GRAY && step == 1){
+        frame.retroBits = pyramidEnabled ? pyramid.packedMask() : segmenter.packedMask();
+        frame.retroWords = pyramidEnabled ? pyramid.packedWords() : segmenter.packedWords();
+        const uint32_t *suppressed = staticMask.bits();
+        if(suppressed != nullptr && staticMask.words() == frame.retroWords){
+            for(size_t i = 0; i < frame.retroBits.size(); i++) frame.retroBits[i] &= ~suppressed[i];
         }
-        callbackManager.sendImageToJavaSide(outputImage);
     }
-    else if (currentMode == CALIBRATION){
-        // Do nothing
+
+    if(exposureController.wantsStats()){
+        // Brightest blob drives the exposure
+        int peak = 0, peakArea = 0;
+        for(auto &blob : blobs){
+            if(blob.peak > peak){
+                peak = blob.peak;
+                peakArea = blob.area;
+            }
+        }
+        exposureController.onBlobStats(peak, peakArea);
+    }
+
+    candidate.blobs = (int)blobs.size();
+    if(blobs.size() == 1)
+    {
+        Rect &brect = blobs[0].bbox;
+        candidate.area = blobs[0].area;
+        candidate.point.uv = blobs[0].centroid;
+        DepthSampler::Sample sample = depthSampler.estimate(frame, brect);
+        candidate.confidence = sample.count > 0 ? sample.confidence : 0;
+        candidate.point.xyz = sample.xyz*100;
+        candidate.point.target = Point2f(projector.width / 2, projector.height / 2);
+    }
+
+    if(currentMode == CALIBRATION && constellationEnabled){
+        identifyMarkers(frame);
+    }
+
+    // the pose is not tracked while a point is averaged, it is committed when the point is saved
+    if(currentMode == CALIBRATION && autoCapturing && !averager.active()){
+        if(autoCapture.update(candidateValid(), candidate.point.uv, candidate.point.xyz.z)){
+            averagingBoard = false;
+            autoAveraging = true;
+            averager.start(1);
+        }
     }
-    else if(currentMode == TEST){
+
+    if(currentMode == CALIBRATION && averager.active()){
+        averagePoints(frame);
+    }
+
+    if(currentMode == TEST){
+        // depth is sampled around the blob in the camera image, the undistorted center is only used for mapping
+        vector<DepthSampler::Sample> depths(blobs.size());
+        ThreadPool::shared().parallelFor(0, (int)blobs.size(), 1, [&](int from, int to){
+            for(int i = from; i < to; i++){
+                depths[i] = depthSampler.estimate(frame, blobs[i].bbox);
+            }
+        });
+
         vector<Point2f> distorted, undistorted;
-        blobCenters.clear();
-        for( int i = 0; i< (int)retro_contours.size(); i++)
+        for(int i = 0; i < (int)blobs.size(); i++)
         {
-            Rect brect = boundingRect(retro_contours[i]);
-            Point2i raw = Point2i(brect.x + brect.width/2,  brect.y + brect.height/2 );
-            distorted.push_back(raw);
+            Rect &brect = blobs[i].bbox;
+            distorted.push_back(Point2f(brect.x + brect.width/2,  brect.y + brect.height/2));
         }
 
         if(distorted.size()){
             undistortPoints(distorted, undistorted, cameraMatrix, distortionCoefficients,cameraMatrix);
         }
 
-        for(Point2f undist : undistorted )
+        for(int i = 0; i < (int)undistorted.size(); i++)
         {
-            float depth = xyzMap.at<Point3f>(undist.y, undist.x).z*100;
-            Point2i corrected = convertCam2Pro(undist, depth);
+            if(depths[i].count == 0) continue; // no confident pixel around the blob
+            float depth = depths[i].xyz.z*100;
+            Point2i corrected = convertCam2Pro(undistorted[i], depth);
             if(corrected.x == -1) continue;
-            blobCenters.push_back(corrected.x);      // u (px)
-            blobCenters.push_back(corrected.y);     // v (px)
+            frame.centers.push_back(corrected.x);      // u (px)
+            frame.centers.push_back(corrected.y);     // v (px)
         }
 
-        callbackManager.onShapeDetected(blobCenters);
+        if(prediction){
+            // Displayed latency is the whole motion to photon delay, use publish latency until it is known
+            int64_t delay = latency.mean(LatencyMonitor::DISPLAY);
+            if(delay == 0) delay = latency.mean(LatencyMonitor::PUBLISH);
+            predictor.predict(frame.centers, frame.timestamp, delay, Size(projector.width, projector.height));
+        }
+        latency.record(LatencyMonitor::DETECT, frame.timestamp);
+        lastCenters = frame.centers;
+        if(frame.has(Frame::TILES)) changeGate.accept(frame.tileSums, LatencyMonitor::now() - start);
+    }
+}
+
+// Byte mask of the retro pixels of a GRAY frame. A decimated detection has no full resolution
+// mask, then the pixels above the threshold are shown.
+static Mat retroMask(const Frame &frame)
+{
+    if(frame.retroWords == 0) return frame.grayImage > frame.threshold;
+
+    Mat mask(frame.grayImage.size(), CV_8UC1);
+    for(int y = 0; y < mask.rows; y++)
+    {
+        const uint32_t *bits = &frame.retroBits[y * frame.retroWords];
+        uint8_t *out = mask.ptr<uint8_t>(y);
+        for(int x = 0; x < mask.cols; x++) out[x] = (bits[x >> 5] >> (x & 31)) & 1 ? 255 : 0;
+    }
+    return mask;
+}
+
+// Runs on the publish stage, only the results stored in the frame are used
+void Calibrator::publishFrame(Frame &frame)
+{
+    if((frame.mode == DEPTH || frame.mode == GRAY) && !previewDue(frame)){
+        return;
     }
 
+    if(frame.mode == DEPTH){
+        if(!frame.has(Frame::XYZ) && !frame.has(Frame::DEPTH)) return; // ingestion failed, no map to show
+        Mat z;
+        frame.depth(z);
+        z.at<float>(0,0) = MAX_RANGE;
+        normalize(z, z, 0, 255, NORM_MINMAX, CV_8UC1);
+        applyColorMap(z, outputImage, COLORMAP_JET);
+        callbackManager.sendImageToJavaSide(outputImage);
+    }
+    else if(frame.mode == GRAY && undistorting && undistortedPreview.ready()){
+        undistortedPreview.render(frame.grayImage, retroMask(frame), outputImage);
+        callbackManager.sendArgbToJavaSide(outputImage);
+    }
+    else if(frame.mode == GRAY){
+        normalize(frame.grayImage, outputImage, 0, 255, NORM_MINMAX, CV_8UC1);
+        cvtColor(outputImage, outputImage, COLOR_GRAY2BGR);
+        outputImage.setTo(Scalar(255,0,255), retroMask(frame));
+        callbackManager.sendImageToJavaSide(outputImage);
+    }
+    else if (frame.mode == CALIBRATION || frame.mode == SCAN){
+        output.publish(callbackManager, vector<int>(), frame.timestamp); // calibration pattern
+        if(frame.addedPoints > 0 || frame.rejectedPoints > 0){
+            callbackManager.sendPointToJavaSide(frame.capturedPoints, frame.addedPoints, frame.rejectedPoints,
+                                                frame.capturedDepth, frame.neededDepth);
+        }
+    }
+    else if(frame.mode == TEST && !frame.reused){
+        output.publish(callbackManager, frame.centers, frame.timestamp);
+    }
+    else{
+        return; // reused TEST result, the overlay is already up to date
+    }
+    latency.record(LatencyMonitor::PUBLISH, frame.timestamp);
 }
 
 bool Calibrator::saveCamPoint()
 {
     lock_guard<mutex> lock (flagMutex);
-    if(retro_contours.size() == 1)
+    if(constellationEnabled)
     {
-        double area = contourArea(retro_contours[0]);
-        if( area > MAX_RETRO_AREA){
-            LOGD("Retro area(%f) is above maximum(%f). Pair cannot be added.",area, MAX_RETRO_AREA);
+        if((int)markerPoints.size() < MIN_MARKERS){
+            LOGD("%d markers of the constellation are found, %d needed", (int)markerPoints.size(), MIN_MARKERS);
             return false;
         }
+        averagingBoard = true;
+        autoAveraging = false;
+        averager.start((int)targets.size());
+        LOGD("%d markers of the constellation are averaged", (int)markerPoints.size());
+        return true;
+    }
 
-        CamPoint cp;
-        Rect brect = boundingRect(retro_contours[0]);
-        cp.uv = Point2i(brect.x + brect.width/2,  brect.y + brect.height/2 );
-        if(confMap.at<uint8_t>(cp.uv.y, cp.uv.x) < MIN_CONFIDENCE){
-            LOGD("Confidence value of retro center is below minimum");
+    if(candidate.blobs == 1)
+    {
+        if( candidate.area > MAX_RETRO_AREA){
+            LOGD("Retro area(%d) is above maximum(%d). Pair cannot be added.",candidate.area, MAX_RETRO_AREA);
             return false;
         }
 
-        cp.xyz = xyzMap.at<Point3f>(cp.uv.y, cp.uv.x)*100;
-        cam_points.push_back(cp);
-        LOGD("Cam point added : (u,v)=(%d,%d)\t(x,y,z)=(%.2f\t%.2f\t%.2f)",
-             cp.uv.x, cp.uv.y, cp.xyz.x, cp.xyz.y, cp.xyz.z);
-        LOGD("There are %d cam points saved", (int)cam_points.size());
+        if(candidate.confidence < MIN_CONFIDENCE){
+            LOGD("Confidence around the retro is below minimum");
+            return false;
+        }
 
+        averagingBoard = false;
+        autoAveraging = false;
+        averager.start(1);
         return true;
     }
     else
     {
-        LOGD("None or multiple retro found. Pair cannot be added. size=%d", (int)retro_contours.size());
+        LOGD("None or multiple retro found. Pair cannot be added. size=%d", candidate.blobs);
         return false;
     }
 }
 
-void Calibrator::undistortCamPoints()
+bool Calibrator::candidateValid() const
 {
-    if(cam_points.rbegin()->uv_corrected.x != 0){
-        return; // All points are corrected already
+    return candidate.blobs == 1 && candidate.area <= MAX_RETRO_AREA && candidate.confidence >= MIN_CONFIDENCE;
+}
+
+// Adds the points of the frame to the running averages, the points which held still are
+// saved when the window is complete. The saved and the rejected points are reported to java,
+// markers of the board which were never seen are not rejections. flagMutex should be locked by the caller
+void Calibrator::averagePoints(Frame &frame)
+{
+    if(averagingBoard){
+        for(int i = 0; i < (int)markerPoints.size(); i++){
+            averager.add(markerSlots[i], markerPoints[i].uv, markerPoints[i].xyz);
+        }
+    }
+    else if(candidateValid()){
+        averager.add(0, candidate.point.uv, candidate.point.xyz);
     }
+    if(!averager.endFrame()) return;
+
+    int added = 0, rejected = 0;
+    for(int slot = 0; slot < averager.size(); slot++)
+    {
+        PointAverager::Point mean;
+        if(!averager.result(slot, mean)){
+            if(!averagingBoard || averager.samples(slot) > 0) rejected++;
+            continue;
+        }
+        CamPoint cp;
+        cp.uv = mean.uv;
+        cp.xyz = mean.xyz;
+        cp.variance = mean.variance;
+        cp.target = averagingBoard ? targets[slot] : Point2f(projector.width / 2, projector.height / 2);
+        addCamPoint(cp);
+        frame.capturedDepth = (int)lround(cp.xyz.z);
+        added++;
+    }
+    frame.capturedPoints = (int)cam_points.size();
+    frame.addedPoints = added;
+    frame.rejectedPoints = rejected;
+    frame.neededDepth = autoCapture.neededDepth();
+    if(autoAveraging){
+        autoCapture.finish(added > 0);
+        autoAveraging = false;
+    }
+}
+
+// flagMutex should be locked by the caller
+void Calibrator::addCamPoint(const CamPoint &cp)
+{
+    autoCapture.add((int)cam_points.size(), cp.xyz.z);
+    cam_points.push_back(cp);
+    LOGD("Cam point added : (u,v)=(%.1f,%.1f)\t(x,y,z)=(%.2f\t%.2f\t%.2f)\tvar(u,v,z)=(%.3f\t%.3f\t%.3f)",
+         cp.uv.x, cp.uv.y, cp.xyz.x, cp.xyz.y, cp.xyz.z, cp.variance.x, cp.variance.y, cp.variance.z);
+    LOGD("There are %d cam points saved", (int)cam_points.size());
+}
+
+void Calibrator::setAutoCapture(bool enabled)
+{
+    lock_guard<mutex> lock (flagMutex);
+    autoCapturing = enabled;
+    LOGD("Auto capture: %s", enabled ? "ON" : "OFF");
+}
+
+void Calibrator::setConstellation(bool enabled)
+{
+    lock_guard<mutex> lock (flagMutex);
+    constellationEnabled = enabled;
+    markerPoints.clear();
+    if(currentMode == CALIBRATION) output.setPattern(calibrationPattern());
+    LOGD("Marker constellation: %s", enabled ? "ON" : "OFF");
+}
+
+// Crosshairs at the projector targets, and the layout in camera pixels for the identification
+void Calibrator::updateConstellation()
+{
+    targets.clear();
+    constellationPattern = Mat::zeros(projector.height, projector.width, CV_8UC1);
+    vector<Point2f> layout;
+    int half = pattern.cols / 2;
+    for(const Point2f &offset : CONSTELLATION)
+    {
+        Point2f target(projector.width / 2 + offset.x, projector.height / 2 + offset.y);
+        targets.push_back(target);
+        Point c(cvRound(target.x), cvRound(target.y));
+        rectangle(constellationPattern, c - Point(half, half), c + Point(half, half), Scalar(255));
+        line(constellationPattern, Point(c.x - half, c.y), Point(c.x + half, c.y), Scalar(255));
+        line(constellationPattern, Point(c.x, c.y - half), Point(c.x, c.y + half), Scalar(255));
+        // inverse of the scaling in calibrate, the shift is common to the markers of a flat board
+        layout.push_back(Point2f((float)((target.x + x_offset) * camera.width / (projector.width * x_scale)),
+                                 (float)((target.y + y_offset) * camera.height / (projector.height * y_scale))));
+    }
+    constellation.setLayout(layout);
+}
+
+// flagMutex should be locked by the caller
+void Calibrator::identifyMarkers(const Frame &frame)
+{
+    markerPoints.clear();
+    markerSlots.clear();
+    vector<int> small; // blobs which can be a marker
+    vector<Point2f> centroids;
+    for(int i = 0; i < (int)blobs.size(); i++){
+        if(blobs[i].area > MAX_RETRO_AREA) continue;
+        small.push_back(i);
+        centroids.push_back(blobs[i].centroid);
+    }
+    vector<int> markers;
+    if(constellation.identify(centroids, markers) < MIN_MARKERS) return;
+
+    for(int k = 0; k < (int)markers.size(); k++)
+    {
+        if(markers[k] == -1) continue;
+        Rect &brect = blobs[small[markers[k]]].bbox;
+        DepthSampler::Sample sample = depthSampler.estimate(frame, brect);
+        if(sample.count == 0 || sample.confidence < MIN_CONFIDENCE) continue;
+        CamPoint cp;
+        cp.uv = blobs[small[markers[k]]].centroid;
+        cp.xyz = sample.xyz*100;
+        cp.target = targets[k];
+        markerPoints.push_back(cp);
+        markerSlots.push_back(k);
+    }
+}
+
+// flagMutex should be locked by the caller
+void Calibrator::startScan()
+{
+    // size of a camera pixel on the projector, as calibrate scales the camera points
+    Point2f footprint((float)projector.width / camera.width, (float)projector.height / camera.height);
+    if(x_scale != 0 && y_scale != 0){
+        footprint = Point2f(footprint.x * x_scale, footprint.y * y_scale);
+    }
+    structuredLight.create(Size(projector.width, projector.height), Size(camera.width, camera.height), footprint);
+    if(!structuredLight.ready()){
+        LOGD("Scan needs the camera and the projector");
+        return;
+    }
+    structuredLight.start();
+    scanPattern = scanFrames = 0;
+    scanStart = LatencyMonitor::now();
+    Mat scanImage;
+    structuredLight.render(scanPattern, scanImage);
+    output.setPattern(scanImage);
+    LOGD("Scan started with %d patterns", structuredLight.patterns());
+}
+
+// Every pattern is held until SCAN_FRAMES frames are captured after it settles.
+// flagMutex should be locked by the caller
+void Calibrator::scanFrame(Frame &frame)
+{
+    if(!structuredLight.ready() || scanPattern >= structuredLight.patterns()) return;
+    if(++scanFrames <= SCAN_SETTLE_FRAMES) return;
+    structuredLight.add(scanPattern, frame.grayImage);
+    if(scanFrames < SCAN_SETTLE_FRAMES + SCAN_FRAMES) return;
+
+    structuredLight.endPattern(scanPattern);
+    scanFrames = 0;
+    Mat scanImage;
+    if(++scanPattern < structuredLight.patterns()){
+        structuredLight.render(scanPattern, scanImage);
+        output.setPattern(scanImage);
+        return;
+    }
+    output.setPattern(scanImage); // projector border only
+
+    Mat coordinates;
+    int decoded = structuredLight.decode(coordinates);
+    int points = (int)cam_points.size();
+    addScanPoints(frame, coordinates);
+    LOGD("Scan is done in %.2f s, %d pixels decoded, %d cam points added",
+         (LatencyMonitor::now() - scanStart) / 1000000.0, decoded, (int)cam_points.size() - points);
+    if((int)cam_points.size() == points) return;
+
+    frame.capturedPoints = (int)cam_points.size();
+    frame.addedPoints = (int)cam_points.size() - points;
+    frame.capturedDepth = (int)lround(cam_points.back().xyz.z);
+    frame.neededDepth = autoCapture.neededDepth();
+}
+
+// Decoded pixels with a confident depth on a SCAN_STEP grid are merged into one cam point per depth
+// bucket: the mean of their undistorted pixels, depths and projector coordinates, with the spread of
+// their shifts as its variance. Hundreds of wall pixels would otherwise outweigh the marker points
+// at other depths in the fit. flagMutex should be locked by the caller
+void Calibrator::addScanPoints(const Frame &frame, const Mat &coordinates)
+{
+    vector<CamPoint> pixels;
+    vector<Point2f> distorted, undistorted;
+    for(int y = SCAN_STEP / 2; y < coordinates.rows; y += SCAN_STEP)
+    {
+        const Vec2f *target = coordinates.ptr<Vec2f>(y);
+        const uint8_t *conf = frame.confMap.ptr<uint8_t>(y);
+        for(int x = SCAN_STEP / 2; x < coordinates.cols; x += SCAN_STEP)
+        {
+            if(target[x][0] < 0 || conf[x] < MIN_CONFIDENCE) continue;
+            float z = frame.depthAt(y, x);
+            if(z <= 0) continue;
+            CamPoint cp;
+            cp.uv = Point2f((float)x, (float)y);
+            cp.xyz = depthSampler.pointAt(frame, Point(x, y), z)*100;
+            cp.target = Point2f(target[x][0], target[x][1]);
+            if(autoCapture.bucketOf(cp.xyz.z) == -1) continue;
+            pixels.push_back(cp);
+            distorted.push_back(cp.uv);
+        }
+    }
+    if(pixels.empty()) return;
+    undistortPoints(distorted, undistorted, cameraMatrix, distortionCoefficients, cameraMatrix);
+    updateScale();
+    double x_ratio = projector.width * x_scale / camera.width;
+    double y_ratio = projector.height * y_scale / camera.height;
+
+    vector<int> buckets; // reached by the scan, in the order of the pixels
+    for(const CamPoint &cp : pixels){
+        int bucket = autoCapture.bucketOf(cp.xyz.z);
+        if(find(buckets.begin(), buckets.end(), bucket) == buckets.end()) buckets.push_back(bucket);
+    }
+    for(int bucket : buckets)
+    {
+        vector<ShiftFit::Sample> samples;
+        CamPoint merged;
+        merged.uv = merged.uv_corrected = merged.target = Point2f(0, 0);
+        merged.xyz = Point3f(0, 0, 0);
+        for(int i = 0; i < (int)pixels.size(); i++)
+        {
+            CamPoint &cp = pixels[i];
+            if(autoCapture.bucketOf(cp.xyz.z) != bucket) continue;
+            cp.uv_corrected = undistorted[i];
+            samples.push_back({(double)cp.xyz.z, shiftOf(cp), Point2d(0, 0)});
+            merged.uv += cp.uv;
+            merged.uv_corrected += cp.uv_corrected;
+            merged.target += cp.target;
+            merged.xyz += cp.xyz;
+        }
+        int n = (int)samples.size();
+        float inverse = 1.0f / n;
+        merged.uv *= inverse;
+        merged.uv_corrected *= inverse;
+        merged.target *= inverse;
+        merged.xyz *= inverse;
+        // the shift is linear in the pixel and the target, the shift of the means is their mean shift
+        ShiftFit::Sample shift = ShiftFit::merge(samples);
+        float depthVariance = 0;
+        for(const ShiftFit::Sample &s : samples) depthVariance += (float)((s.depth - shift.depth) * (s.depth - shift.depth));
+        merged.variance = Point3f((float)(shift.variance.x / (x_ratio * x_ratio)), (float)(shift.variance.y / (y_ratio * y_ratio)),
+                                  n > 1 ? depthVariance / (n - 1) : 0);
+        autoCapture.add((int)cam_points.size(), merged.xyz.z);
+        cam_points.push_back(merged);
+        LOGD("Scan point: %d pixels at %.1f cm, shift (%.1f, %.1f) spread (%.2f, %.2f) pro. pixel",
+             n, merged.xyz.z, shift.shift.x, shift.shift.y, sqrt(shift.variance.x), sqrt(shift.variance.y));
+    }
+}
+
+void Calibrator::undistortCamPoints()
+{
+    // scan points are corrected pixel by pixel when they are merged
+    vector<int> indices;
     vector<Point2f> distorted;
     vector<Point2f> undistorted;
-    for(auto cp : cam_points){
-        distorted.push_back(cp.uv);
+    for(int i = 0; i < (int)cam_points.size(); i++){
+        if(cam_points[i].uv_corrected.x != 0) continue;
+        indices.push_back(i);
+        distorted.push_back(cam_points[i].uv);
+    }
+    if(distorted.empty()){
+        return; // All points are corrected already
     }
     undistortPoints(distorted, undistorted, cameraMatrix, distortionCoefficients,cameraMatrix);
-    for(int i = 0; i < (int)cam_points.size(); i++){
-        cam_points[i].uv_corrected = undistorted[i];
+    for(int i = 0; i < (int)indices.size(); i++){
+        cam_points[indices[i]].uv_corrected = undistorted[i];
     }
     LOGD("%d cam points are undistorted", (int)undistorted.size());
 }
 
+//scale = sin(camFov/2) / sin(projFov/2)
+void Calibrator::updateScale()
+{
+    x_scale = sin(camera.vertical_fov/2) / sin(projector.vertical_fov/2);
+    y_scale = sin(camera.horizontal_fov/2) / sin(projector.horizontal_fov/2);
+    x_offset = (double)projector.width * (x_scale -1) / 2 ;
+    y_offset = (double)projector.height * (y_scale -1) / 2;
+}
+
+// where the retro is seen minus where it is projected, the center of the projector for a single one
+Point2d Calibrator::shiftOf(const CamPoint &cp) const
+{
+    double cam_x = cp.uv_corrected.x * projector.width * x_scale / camera.width - x_offset;
+    double cam_y = cp.uv_corrected.y * projector.height * y_scale / camera.height - y_offset;
+    return Point2d(cam_x - cp.target.x, cam_y - cp.target.y);
+}
+
 // x_shift = cx*e^(ax*z)
 // y_shift = cy*e^(ay*z)
 // z -> in x axis
@@ -185,34 +710,33 @@ void Calibrator::undistortCamPoints()
 // calibration_result = { cx, ax, cy, ay }
 void Calibrator::calibrate()
 {
+    lock_guard<mutex> lock (flagMutex); // points are added on the detect stage by auto capture
+    if(cam_points.empty()){
+        LOGD("There is no cam point to calibrate with");
+        return;
+    }
+    int64_t start = LatencyMonitor::now();
     undistortCamPoints();
-    //scale = sin(camFov/2) / sin(projFov/2)
-    x_scale = sin(camera.vertical_fov/2) / sin(projector.vertical_fov/2);
-    y_scale = sin(camera.horizontal_fov/2) / sin(projector.horizontal_fov/2);
-    x_offset = (double)projector.width * (x_scale -1) / 2 ;
-    y_offset = (double)projector.height * (y_scale -1) / 2;
+    updateScale();
 
-    vector<double> x_shift;
-    vector<double> y_shift;
-    vector<double> depth;
+    vector<ShiftFit::Sample> samples; // variances of the shifts in pro. pixel^2
+    double x_ratio = projector.width * x_scale / camera.width;
+    double y_ratio = projector.height * y_scale / camera.height;
     /*ofstream file;
     file.open(dataFolder + "/shift.csv");
     file << "z,x_shift(xp),y_shift(xp)\n";*/
     for(auto cp : cam_points)
     {
-        double cam_x = cp.uv_corrected.x * projector.width * x_scale / camera.width - x_offset;
-        double cam_y = cp.uv_corrected.y * projector.height * y_scale / camera.height - y_offset;
-
-        x_shift.push_back(cam_x - projector.width / 2); // /2 since retro will be center of the projector
-        y_shift.push_back(cam_y - projector.height / 2);
-        depth.push_back((double)cp.xyz.z);
+        samples.push_back({(double)cp.xyz.z, shiftOf(cp),
+                           Point2d(max((double)cp.variance.x, MIN_UV_VARIANCE) * x_ratio * x_ratio,
+                                   max((double)cp.variance.y, MIN_UV_VARIANCE) * y_ratio * y_ratio)});
         //file << cp.xyz.z << "," << cam_x - projector.width / 2 << "," << cam_y - projector.height / 2 << endl;
     }
     //file.close();
 
-    auto coeff_x = fitExponential(depth, x_shift);
-    auto coeff_y = fitExponential(depth, y_shift);
-    calibration_result = Vec4d(coeff_x.first, coeff_x.second, coeff_y.first, coeff_y.second);
+    calibration_result = ShiftFit::fit(samples);
+    updateMapping();
+    LOGD("Calibrated with %d cam points in %.2f ms", (int)cam_points.size(), (LatencyMonitor::now() - start) / 1000.0);
 
     /*file.open(dataFolder + "/calibration.txt");
     file << "{ ax, bx, ay, by } = " << calibration_result << endl;
@@ -224,51 +748,6 @@ void Calibrator::calibrate()
 
 }
 
-// y = c*e^(a*x)
-// x and y should not  be negative. (x will be depths, already positive, check only y)
-pair<double, double> Calibrator::fitExponential(const vector<double> &x, vector<double> &y){
-    int n = x.size();
-    double lny[n];
-    bool neg = false;
-    for (int i = 0; i < n; i++){
-        if(y[i] < 0 ){
-            neg = true;
-            y[i] *= -1;
-        }
-        lny[i]=log(y[i]);
-    }
-    double xsum = 0, x2sum = 0, ysum = 0, xysum = 0;
-    for (int i = 0; i < n; i++){
-        xsum += x[i];            //calculate sum(xi)
-        ysum += lny[i];          //calculate sum(yi)
-        x2sum += pow(x[i],2);    //calculate sum(x^2i)
-        xysum += (x[i]*lny[i]);  //calculate sum(xi*yi)
-    }
-
-    double a = ( n*xysum - xsum*ysum ) / ( n*x2sum - xsum*xsum );
-    double b = ( x2sum*ysum - xsum*xysum ) / ( x2sum*n - xsum*xsum );
-    double c = pow(2.71828, b);
-    if(neg){
-        c *= -1;
-    }
-
-    double y_fit[n];
-    double rss = 0; // residual sum of squares
-    double mean = accumulate(y.begin(), y.end(), 0) / n;
-    double var = 0;
-    for (int i = 0; i < n; i++){
-        y_fit[i] = c*pow(2.71828, a*x[i]);
-        rss += pow(y_fit[i] - y[i], 2);
-        var += pow(mean - y[i], 2);
-    }
-    double r2 = 1 - (rss / var);
-
-    LOGD("Line fitted to %d points. R2 = %.5f", n, r2);
-    LOGD("y = c*e^(a*x)  c = %.5f \t a = %.5f", c, a);
-
-    return {c,a};
-}
-
 // {a,b}  y = ax + b
 pair<double, double> Calibrator::fitLinear(const vector<double> &x, const vector<double> &y){
     int n = x.size();
@@ -284,7 +763,7 @@ pair<double, double> Calibrator::fitLinear(const vector<double> &x, const vector
     double a = ( n*xysum - xsum*ysum ) / ( n*x2sum - xsum*xsum );
     double b = ( x2sum*ysum - xsum*xysum ) / ( x2sum*n - xsum*xsum );
 
-    double y_fit[n];
+    vector<double> y_fit(n);
     double rss = 0; // residual sum of squares
     double mean = accumulate(y.begin(), y.end(), 0) / n;
     double var = 0;
@@ -306,11 +785,8 @@ Point2i Calibrator::convertCam2Pro(Point2i pp, float depth){
         return Point2i(-1,-1);
     }
 
-    Vec4d & coef = calibration_result;
-    double shiftx = coef[0] * exp(coef[1]*depth);
-    double shifty = coef[2] * exp(coef[3]*depth);
-    int cpx = (double)pp.x * projector.width* x_scale / camera.width - x_offset - shiftx;
-    int cpy = (double)pp.y * projector.height* y_scale / camera.height - y_offset - shifty;
+    Point2i cp = mapping.map(pp, depth);
+    int cpx = cp.x, cpy = cp.y;
 
     if(cpx > projector.width || cpx < 0 || cpy > projector.height || cpy < 0){
         LOGD("Point is outside of the projector view");
@@ -319,3 +795,12 @@ Point2i Calibrator::convertCam2Pro(Point2i pp, float depth){
     return Point2i(cpx,cpy);
 }
 
+
+// convertCam2Pro runs in fixed point, see ProjectorMapping
+void Calibrator::updateMapping()
+{
+    if(x_scale == 0 || y_scale == 0 || camera.width == 0 || camera.height == 0) return;
+    mapping.create(Point2d((double)projector.width * x_scale / camera.width, (double)projector.height * y_scale / camera.height),
+                   Point2d(x_offset, y_offset), calibration_result);
+    LOGD("Mapping tabulated, %.1f KB", mapping.tableBytes() / 1024.0);
+}
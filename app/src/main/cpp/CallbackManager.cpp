@@ -3,77 +3,152 @@
 //
 
 #include "CallbackManager.h"
+#include "PackKernels.h"
 #include "Util.h"
+#include "ThreadPool.h"
+#include <android/bitmap.h>
+
+static const int PREVIEW_GRAIN = 16; // rows per task
 
 CallbackManager::CallbackManager(){}
 
-CallbackManager::CallbackManager(JavaVM* vm, jobject& obj, jmethodID& amplitudeCallbackID, jmethodID& blobsCallbackID){
+CallbackManager::CallbackManager(JavaVM* vm, jobject& obj, jmethodID& amplitudeCallbackID, jmethodID& overlayCallbackID,
+                                 jmethodID& pointCallbackID){
     m_vm = vm;
     m_obj = obj;
     m_amplitudeCallbackID = amplitudeCallbackID;
-    m_blobsCallbackID =  blobsCallbackID;
+    m_overlayCallbackID =  overlayCallbackID;
+    m_pointCallbackID = pointCallbackID;
+}
+
+void CallbackManager::release(JNIEnv* env)
+{
+    if(m_obj != nullptr) env->DeleteGlobalRef(m_obj);
+    for(int i = 0; i < 2; i++){
+        if(m_overlay[i] != nullptr) env->DeleteGlobalRef(m_overlay[i]);
+        m_overlay[i] = nullptr;
+    }
+    m_obj = nullptr;
 }
 
 void CallbackManager::sendImageToJavaSide(const cv::Mat& image, bool flip)
 {
+    if(m_obj == nullptr) return; // java side is not registered
     jint fill[image.rows * image.cols];
+    jint *out = fill; // arrays of runtime size cannot be captured by the lambdas
+    const cv::Mat *source = &image;
+    cv::Mat norm;
+    PreviewFormat format;
     if(image.type() == 16) // CV_8UC3
     {
-        //  int color = (A & 0xff) << 24 | (R & 0xff) << 16 | (G & 0xff) << 8 | (B & 0xff);
-        int k = 0;
-        if(flip) k = image.rows * image.cols -1 ;
-
-        for (int i = 0; i < image.rows; i++)
-        {
-            const cv::Vec3b *ptr = image.ptr<cv::Vec3b>(i);
-            for (int j = 0; j < image.cols; j++)
-            {
-                cv::Vec3b p = ptr[j];
-                int color = (255 & 0xff) << 24 | (p[2] & 0xff) << 16 | (p[1] & 0xff) << 8 | (p[0] & 0xff);
-                fill[k] = color;
-
-                k = flip ? k-1 : k+1;
-            }
-        }
+        format = BGR_PREVIEW;
     }
     else if(image.type() <= 6) // 1 channel images
     {
-        cv::Mat norm;
         normalize(image, norm, 0, 255, cv::NORM_MINMAX, CV_8UC1);
-        int k = 0;
-        if(flip) k = image.rows * image.cols -1 ;
-        for (int i = 0; i < norm.rows; i++)
-        {
-            auto *ptr = norm.ptr<uint8_t>(i);
-            for (int j = 0; j < norm.cols; j++)
-            {
-                uint8_t p = ptr[j];
-                int color = (255 & 0xff) << 24 | (p & 0xff) << 16 | (p & 0xff) << 8 | (p & 0xff);
-                fill[k] = color;
-
-                k = flip ? k-1 : k+1;
-            }
-        }
+        source = &norm;
+        format = GRAY_PREVIEW;
     }
     else{
         LOGE("Image should have 1 channel or CV_8UC3");
         return;
     }
 
+    PackKernel kernel = PACK_KERNELS[format][flip];
+    ThreadPool::shared().parallelFor(0, source->rows, PREVIEW_GRAIN, [&](int from, int to)
+    {
+        for (int i = from; i < to; i++){
+            kernel(*source, i, out);
+        }
+    });
+
+    sendPixels(fill, image.rows * image.cols);
+}
+
+void CallbackManager::sendArgbToJavaSide(const cv::Mat& argb)
+{
+    if(m_obj == nullptr) return;
+    if(argb.type() != CV_32SC1 || !argb.isContinuous()){
+        LOGE("Packed image should be a continuous CV_32SC1");
+        return;
+    }
+    sendPixels(argb.ptr<jint>(0), argb.rows * argb.cols);
+}
+
+void CallbackManager::sendPixels(const jint* pixels, int count)
+{
     // attach to the JavaVM thread and get a JNI interface pointer
     JNIEnv *env;
     m_vm->AttachCurrentThread(&env, NULL);
-    jintArray intArray = env->NewIntArray(image.rows * image.cols);
-    env->SetIntArrayRegion(intArray, 0, image.rows * image.cols, fill);
+    jintArray intArray = env->NewIntArray(count);
+    env->SetIntArrayRegion(intArray, 0, count, pixels);
     env->CallVoidMethod(m_obj, m_amplitudeCallbackID, intArray);
     m_vm->DetachCurrentThread();
 }
 
-void CallbackManager::onShapeDetected(const std::vector<int> & arr){
+void CallbackManager::sendPointToJavaSide(int points, int added, int rejected, int depth, int neededDepth)
+{
+    if(m_obj == nullptr) return;
+    JNIEnv *env;
+    m_vm->AttachCurrentThread(&env, NULL);
+    env->CallVoidMethod(m_obj, m_pointCallbackID, (jint)points, (jint)added, (jint)rejected, (jint)depth, (jint)neededDepth);
+    m_vm->DetachCurrentThread();
+}
+
+void CallbackManager::setOverlayBitmaps(JNIEnv* env, jobject first, jobject second)
+{
+    for(int i = 0; i < 2; i++){
+        if(m_overlay[i] != nullptr) env->DeleteGlobalRef(m_overlay[i]);
+    }
+    m_overlay[0] = env->NewGlobalRef(first);
+    m_overlay[1] = env->NewGlobalRef(second);
+    m_backBuffer = 0;
+
+    AndroidBitmapInfo info;
+    if(AndroidBitmap_getInfo(env, first, &info) != ANDROID_BITMAP_RESULT_SUCCESS ||
+       info.format != ANDROID_BITMAP_FORMAT_RGBA_8888){
+        LOGE("Overlay bitmaps should be ARGB_8888");
+        m_overlaySize = cv::Size();
+        return;
+    }
+    m_overlaySize = cv::Size(info.width, info.height);
+}
+
+cv::Size CallbackManager::overlaySize()
+{
+    return m_overlaySize;
+}
+
+bool CallbackManager::presentOverlay(OverlayRenderer &renderer, const std::vector<int> & centers, int64_t captureTime)
+{
+    if(m_obj == nullptr) return false;
     JNIEnv *env;
     m_vm->AttachCurrentThread(&env, NULL);
-    jintArray intArray = env->NewIntArray(arr.size());
-    env->SetIntArrayRegion(intArray, 0, arr.size(), &arr[0]);
-    env->CallVoidMethod(m_obj, m_blobsCallbackID, intArray);
+    int buffer = renderOverlay(env, renderer, centers);
+    if(buffer != -1){
+        env->CallVoidMethod(m_obj, m_overlayCallbackID, (jint)buffer, (jlong)captureTime);
+    }
     m_vm->DetachCurrentThread();
+    return buffer != -1;
+}
+
+int CallbackManager::renderOverlay(JNIEnv* env, OverlayRenderer &renderer, const std::vector<int> & centers)
+{
+    if(m_overlay[0] == nullptr || m_overlaySize.area() == 0 || !renderer.ready()) return -1;
+
+    AndroidBitmapInfo info;
+    void* pixels;
+    jobject bitmap = m_overlay[m_backBuffer];
+    if(AndroidBitmap_getInfo(env, bitmap, &info) != ANDROID_BITMAP_RESULT_SUCCESS ||
+       AndroidBitmap_lockPixels(env, bitmap, &pixels) != ANDROID_BITMAP_RESULT_SUCCESS){
+        LOGE("Overlay bitmap cannot be locked");
+        return -1;
+    }
+    cv::Mat target(info.height, info.width, CV_8UC4, pixels, info.stride);
+    renderer.render(m_backBuffer, target, centers);
+    AndroidBitmap_unlockPixels(env, bitmap); // also notifies the bitmap that its pixels are changed
+
+    int buffer = m_backBuffer;
+    m_backBuffer = 1 - m_backBuffer;
+    return buffer;
 }
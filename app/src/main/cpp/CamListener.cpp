@@ -4,14 +4,32 @@
 
 #include "CamListener.h"
 #include "Util.h"
+#include "LatencyMonitor.h"
+#include "ThreadPool.h"
+#include "IngestKernels.h"
 
-CamListener::CamListener(){}
+CamListener::CamListener()
+{
+    ingestSlot = 0;
+    for(int i = 1; i < SLOT_COUNT; i++){
+        freeSlots.push(i);
+    }
+}
+
+CamListener::~CamListener()
+{
+    stopPipeline();
+}
 
 void CamListener::setCamera(int width, int height, double v_fov, double h_fov)
 {
-    grayImage.create (Size (width,height), CV_16UC1);
-    xyzMap.create(Size (width,height), CV_32FC3);
-    confMap.create(Size (width,height), CV_8UC1);
+    for(Frame &slot : slots){
+        slot.create(width, height, compact);
+    }
+    {
+        lock_guard<mutex> lock (ingestMutex);
+        temporalFilter.create(width, height);
+    }
 
     camera.width = width;
     camera.height = height;
@@ -32,6 +50,55 @@ void CamListener::toggleFlip()
     else setFlip(true);
 }
 
+void CamListener::setTemporalFilter(bool enabled)
+{
+    if(enabled && !filtering) filterReset = true; // history of the previous run is outdated
+    filtering = enabled;
+    LOGD("Temporal filter: %s", enabled ? "ON" : "OFF");
+}
+
+void CamListener::setCompactFrames(bool enabled)
+{
+    compact = enabled; // slots are converted when they are ingested next
+    LOGD("Compact frames: %s \t %d bytes per pixel", enabled ? "ON" : "OFF", Frame::bytesPerPixel(enabled));
+}
+
+void CamListener::setCallbackManager(const CallbackManager &manager)
+{
+    lock_guard<mutex> lock (outputMutex);
+    callbackManager = manager;
+}
+
+void CamListener::startPipeline()
+{
+    if(running) return;
+    running = true;
+    occupancyStart = LatencyMonitor::now();
+    detectThread = thread(&CamListener::runDetect, this);
+    publishThread = thread(&CamListener::runPublish, this);
+}
+
+void CamListener::stopPipeline()
+{
+    if(!running) return;
+    running = false;
+    detectSignal.notify();
+    publishSignal.notify();
+    detectThread.join();
+    publishThread.join();
+}
+
+void CamListener::setFrameRate(int fps)
+{
+    scheduler.setFrameRate(fps);
+}
+
+void CamListener::waitIdle()
+{
+    while(running && inFlight > 0){
+        this_thread::sleep_for(chrono::milliseconds(1));
+    }
+}
 
 void CamListener::setLensParameters (LensParameters lensParameters)
 {
@@ -62,43 +129,335 @@ void CamListener::setLensParameters (LensParameters lensParameters)
 }
 
 
+int CamListener::requiredStreams()
+{
+    return DEPTH_DATA;
+}
+
+bool CamListener::needsTileSums()
+{
+    return true;
+}
+
 void CamListener::onNewData (const DepthData *data)
 {
-    lock_guard<mutex> lock (flagMutex);
-    updateMaps(data);
+    lock_guard<mutex> lock (ingestMutex);
+    if(!acquireSlot()) return;
+    int64_t start = LatencyMonitor::now();
+    updateMaps(slots[ingestSlot], data);
+    logIngest(DEPTH_DATA, depthDataStats, data->points.size() * sizeof(DepthPoint), start);
+    handOver();
+}
+
+void CamListener::onNewData (const DepthImage *data)
+{
+    lock_guard<mutex> lock (ingestMutex);
+    if(!acquireSlot()) return;
+    int64_t start = LatencyMonitor::now();
+    updateMaps(slots[ingestSlot], data);
+    logIngest(DEPTH_IMAGE, depthImageStats, data->cdData.size() * sizeof(uint16_t), start);
+    handOver();
+}
+
+// ingestMutex should be locked by the caller. Returns false if all slots are in the pipeline,
+// the frame is dropped before it costs anything.
+bool CamListener::acquireSlot()
+{
+    if(ingestSlot != -1 || freeSlots.pop(ingestSlot)) return true;
+    dropped++;
+    return false;
+}
+
+// ingestMutex should be locked by the caller
+void CamListener::handOver()
+{
+    Frame &target = slots[ingestSlot];
+    inFlight++;
+    if(!running){
+        detect(target);
+        publish(target);
+        inFlight--;
+        return;
+    }
+
+    detectQueue.push(ingestSlot); // never full, there are only SLOT_COUNT slots
+    detectSignal.notify();
+    ingestSlot = -1;
+    freeSlots.pop(ingestSlot);
+}
+
+void CamListener::StageSignal::notify()
+{
+    {
+        lock_guard<mutex> lock (signalMutex); // the waiting stage cannot miss it between its check and wait
+    }
+    condition.notify_one();
+}
+
+// Returns false when the pipeline is stopped
+bool CamListener::waitFor(SpscQueue<SLOT_COUNT> &queue, StageSignal &signal, int &slot)
+{
+    while(!queue.pop(slot))
+    {
+        unique_lock<mutex> lock (signal.signalMutex);
+        if(!running) return false;
+        signal.condition.wait(lock, [&]{ return !queue.empty() || !running; });
+    }
+    return true;
+}
+
+void CamListener::runDetect()
+{
+    int slot;
+    while(waitFor(detectQueue, detectSignal, slot))
+    {
+        Frame &target = slots[slot];
+        target.level = scheduler.level();
+        skipNext = target.level >= FrameScheduler::SKIP_FRAMES && !skipNext;
+        // a newer frame is waiting, skip to it instead of adding a frame period to the latency
+        target.stale = !detectQueue.empty() || skipNext;
+        if(target.stale) target.detectCost = 0;
+        else detect(target);
+
+        publishQueue.push(slot);
+        publishSignal.notify();
+    }
+}
+
+void CamListener::runPublish()
+{
+    int slot;
+    while(waitFor(publishQueue, publishSignal, slot))
+    {
+        publish(slots[slot]);
+        freeSlots.push(slot);
+        inFlight--;
+    }
+}
+
+void CamListener::detect(Frame &target)
+{
+    if(!running) target.level = scheduler.level();
+    int64_t start = LatencyMonitor::now();
+    {
+        lock_guard<mutex> lock (flagMutex);
+        detectFrame(target);
+    }
+    target.detectCost = LatencyMonitor::now() - start;
+}
+
+void CamListener::publish(Frame &target)
+{
+    int64_t start = LatencyMonitor::now();
+    if(!target.stale){
+        lock_guard<mutex> lock (outputMutex);
+        publishFrame(target);
+    }
+    target.publishCost = LatencyMonitor::now() - start;
+    recordCost(target);
+}
+
+void CamListener::detectFrame(Frame &frame)
+{
+    frame.mode = 0; // nothing to detect in here
+}
+
+bool CamListener::previewDue(const Frame &frame)
+{
+    if(frame.level < FrameScheduler::NO_PREVIEW) return true;
+    return ++previewCount % PREVIEW_DIVISOR == 0;
+}
+
+void CamListener::publishFrame(Frame &frame)
+{
+    if(!previewDue(frame)) return;
     // process images in here ...
 
     // for example
-    vector<Mat> channels(3);
-    split(xyzMap, channels);
-    applyColorMap(channels[2], outputImage, COLORMAP_JET);
+    if(!frame.has(Frame::XYZ) && !frame.has(Frame::DEPTH)) return;
+    Mat z;
+    frame.depth(z);
+    applyColorMap(z, outputImage, COLORMAP_JET);
     callbackManager.sendImageToJavaSide(outputImage, flip);
 }
 
+CamListener::FrameStats CamListener::takeFrameStats()
+{
+    lock_guard<mutex> lock (statsMutex);
+    FrameStats stats = frameStats;
+    if(stats.frames > 0){
+        stats.meanCost = totalCost / stats.frames;
+    }
+    frameStats = FrameStats();
+    totalCost = 0;
+    return stats;
+}
+
+void CamListener::recordCost(const Frame &target)
+{
+    lock_guard<mutex> lock (statsMutex);
+    busy[0] += target.ingestCost;
+    busy[1] += target.detectCost;
+    busy[2] += target.publishCost;
+
+    if(target.stale){
+        staleFrames++;
+    }
+    else{
+        // stages overlap in the pipeline, the slowest one sets the frame rate
+        int64_t cost = running ? max(target.ingestCost, max(target.detectCost, target.publishCost))
+                               : target.ingestCost + target.detectCost + target.publishCost;
+        frameStats.frames++;
+        frameStats.maxCost = max(frameStats.maxCost, cost);
+        totalCost += cost;
+        int64_t costs[FrameScheduler::STAGE_COUNT] = {target.ingestCost, target.detectCost, target.publishCost};
+        scheduler.onFrame(costs, running);
+    }
+
+    if(++occupancyFrames == STATS_INTERVAL) logOccupancy();
+}
+
+// statsMutex should be locked by the caller
+void CamListener::logOccupancy()
+{
+    int64_t now = LatencyMonitor::now();
+    double wall = (double)(now - occupancyStart);
+    if(running && wall > 0){
+        LOGD("Pipeline occupancy: ingest %.0f%% \t detect %.0f%% \t publish %.0f%% \t %d stale",
+             busy[0] * 100 / wall, busy[1] * 100 / wall, busy[2] * 100 / wall, staleFrames);
+    }
+    FrameScheduler::Metrics metrics = scheduler.takeMetrics();
+    if(metrics.overruns > 0 || metrics.degraded > 0 || metrics.restored > 0 || scheduler.level() != FrameScheduler::FULL){
+        LOGD("Scheduler: %d overruns \t %d degraded \t %d restored \t frames full/no preview/decimated/skip = %d/%d/%d/%d",
+             metrics.overruns, metrics.degraded, metrics.restored, metrics.frames[FrameScheduler::FULL],
+             metrics.frames[FrameScheduler::NO_PREVIEW], metrics.frames[FrameScheduler::DECIMATED],
+             metrics.frames[FrameScheduler::SKIP_FRAMES]);
+    }
+    busy[0] = busy[1] = busy[2] = 0;
+    staleFrames = occupancyFrames = 0;
+    occupancyStart = now;
+}
+
+void CamListener::logIngest(Stream stream, IngestStats &stats, int64_t bytes, int64_t start)
+{
+    stats.frames++;
+    stats.bytes += bytes;
+    Frame &target = slots[ingestSlot];
+    target.ingestCost = LatencyMonitor::now() - start;
+    stats.micros += target.ingestCost;
+    if(stats.frames == STATS_INTERVAL){
+        LOGD("Ingest %s: %.1f KB/frame \t %.2f ms/frame \t %d dropped", stream == DEPTH_DATA ? "depth data" : "depth image",
+             stats.bytes / 1024.0 / stats.frames, stats.micros / 1000.0 / stats.frames, dropped);
+        stats = IngestStats();
+        dropped = 0;
+    }
+}
+
+static const int INGEST_GRAIN = 16; // rows per task
+
 // not use this flip, it messes the lens params, flip the image while sending to java side
-void CamListener::updateMaps(const DepthData* data)
+void CamListener::updateMaps(Frame &target, const DepthData* data)
 {
-    int k;
-    if(flip) k = camera.height * camera.width -1 ;
-    else k = 0;
+    target.timestamp = data->timeStamp.count();
+    int width = camera.width, last = camera.height * camera.width -1;
+    if((int)data->points.size() <= last){
+        LOGE("Depth data has %d points, %d expected", (int)data->points.size(), last + 1);
+        target.content = 0;
+        return;
+    }
+    bool packed = compact; // read once, like flip
+    if(target.compact() != packed) target.setCompact(packed);
+    bool tiles = needsTileSums();
+    target.content = (packed ? Frame::DEPTH : Frame::XYZ) | Frame::CONFIDENCE | Frame::GRAY | (tiles ? Frame::TILES : 0);
+    int *hist = target.grayHistogram;
+    fill(hist, hist + Frame::HIST_BINS, 0);
+    mutex histMutex;
+
+    bool flipped = flip; // read once, it can be toggled during ingestion
+    target.flipped = flipped;
+    bool filtered = startFilter(flipped);
+    PointKernel kernel = POINT_KERNELS[flipped][packed][tiles];
+    const DepthPoint *points = data->points.data();
 
-    for (int y = 0; y < camera.height ; y++)
+    // one task per row of tiles, so the tile sums of a task are not shared
+    ThreadPool::shared().parallelFor(0, target.tileSums.rows, 1, [&](int from, int to)
     {
-        Vec3f *xyzptr = xyzMap.ptr<Vec3f>(y);
-        uint8_t *confptr = confMap.ptr<uint8_t>(y);
-        uint16_t *grayptr= grayImage.ptr<uint16_t> (y);
+        int local[HIST_LANES * Frame::HIST_BINS] = {0};
+        vector<int> columns (2 * width);
+        for (int ty = from; ty < to; ty++)
+        {
+            fill(columns.begin(), columns.end(), 0);
+
+            for (int y = ty * Frame::TILE; y < min((ty + 1) * Frame::TILE, camera.height); y++)
+            {
+                IngestRow row;
+                row.xyz = packed ? nullptr : target.xyzMap.ptr<Vec3f>(y);
+                row.depth = packed ? target.depthMap.ptr<uint16_t>(y) : nullptr;
+                row.conf = target.confMap.ptr<uint8_t>(y);
+                row.gray = target.grayImage.ptr<uint16_t> (y);
+                row.hist = Frame::histogramRow(y) ? local : nullptr;
+                row.columns = columns.data();
+                row.rowWeight = Frame::tileWeight(y);
+                kernel(points + (flipped ? last - y * width : y * width), width, row);
+
+                if(filtered && packed) temporalFilter.filterRow(y, row.depth, row.conf, width);
+                else if(filtered) temporalFilter.filterRow(y, row.xyz, row.conf, width);
+            }
+            if(tiles) reduceTiles(columns.data(), width, target.tileSums.ptr<int>(ty));
+        }
 
-        for (int x = 0; x < camera.width ; x++)
+        lock_guard<mutex> lock (histMutex);
+        mergeHistogram(local, hist);
+    });
+}
+
+// Depth image carries only depth and confidence, gray image is left untouched
+void CamListener::updateMaps(Frame &target, const DepthImage* data)
+{
+    target.timestamp = data->timestamp;
+    int width = camera.width, last = camera.height * camera.width -1;
+    if((int)data->cdData.size() <= last){
+        LOGE("Depth image has %d pixels, %d expected", (int)data->cdData.size(), last + 1);
+        target.content = 0;
+        return;
+    }
+    bool packed = compact;
+    if(target.compact() != packed) target.setCompact(packed);
+    target.content = (packed ? Frame::DEPTH : Frame::XYZ) | Frame::CONFIDENCE;
+
+    bool flipped = flip; // read once, it can be toggled during ingestion
+    target.flipped = flipped;
+    bool filtered = startFilter(flipped);
+    Depth16Kernel kernel = DEPTH16_KERNELS[flipped][packed];
+    const uint16_t *cd = data->cdData.data();
+
+    ThreadPool::shared().parallelFor(0, camera.height, INGEST_GRAIN, [&](int from, int to)
+    {
+        for (int y = from; y < to ; y++)
         {
-            auto curPoint = data->points.at (k);
-            xyzptr[x][0] = curPoint.x;
-            xyzptr[x][1] = curPoint.y;
-            xyzptr[x][2] = curPoint.z;
-            confptr[x] = curPoint.depthConfidence;
-            grayptr[x] = curPoint.grayValue;
-
-            k = flip ? k-1 : k+1;
+            IngestRow row = {};
+            row.xyz = packed ? nullptr : target.xyzMap.ptr<Vec3f>(y);
+            row.depth = packed ? target.depthMap.ptr<uint16_t>(y) : nullptr;
+            row.conf = target.confMap.ptr<uint8_t>(y);
+            kernel(cd + (flipped ? last - y * width : y * width), width, row);
+
+            // x and y are zero in depth images, only z is filtered
+            if(filtered && packed) temporalFilter.filterRow(y, row.depth, row.conf, width);
+            else if(filtered) temporalFilter.filterRow(y, row.xyz, row.conf, width);
         }
+    });
+}
 
+// Called by both ingestion paths with ingestMutex locked, they share one history
+bool CamListener::startFilter(bool flipped)
+{
+    bool filtered = filtering;
+    if(flipped != filteredFlip){
+        filteredFlip = flipped;
+        filterReset = true; // pixels of the history are mirrored
+    }
+    if(filtered && filterReset.exchange(false)){
+        temporalFilter.reset();
     }
+    return filtered;
 }
@@ -0,0 +1,56 @@
+#include "ChangeGate.h"
+#include "Frame.h"
+#include "Util.h"
+
+ChangeGate::ChangeGate(){}
+
+void ChangeGate::invalidate()
+{
+    reference.release();
+}
+
+bool ChangeGate::unchanged(const Mat &tileSums)
+{
+    bool same = !reference.empty() && reference.size() == tileSums.size() && sinceRefresh < REFRESH_FRAMES;
+    // the moments weight a pixel by up to TILE - 1, on average by about TILE / 2
+    int tolerance = MAX_MEAN_CHANGE * Frame::TILE * Frame::TILE;
+    int tolerances[Frame::TILE_CHANNELS] = {tolerance, tolerance * Frame::TILE / 2, tolerance * Frame::TILE / 2};
+    int channels = tileSums.cols * Frame::TILE_CHANNELS;
+    for(int y = 0; same && y < tileSums.rows; y++)
+    {
+        const int *cur = tileSums.ptr<int>(y), *ref = reference.ptr<int>(y);
+        for(int i = 0; i < channels; i++){
+            if(abs(cur[i] - ref[i]) > tolerances[i % Frame::TILE_CHANNELS]){
+                same = false;
+                break;
+            }
+        }
+    }
+    if(same){
+        sinceRefresh++;
+        count(true);
+    }
+    return same;
+}
+
+void ChangeGate::accept(const Mat &tileSums, int64_t cost)
+{
+    tileSums.copyTo(reference);
+    sinceRefresh = 0;
+    processedCost += cost;
+    count(false);
+}
+
+void ChangeGate::count(bool reused)
+{
+    frames++;
+    if(reused) reusedFrames++;
+    if(frames < REPORT_INTERVAL) return;
+
+    int processed = frames - reusedFrames;
+    double saved = processed > 0 ? (double)processedCost / processed * reusedFrames : 0;
+    LOGD("Change gate: %d of %d frames reused (%.0f%%) \t ~%.1f ms CPU saved", reusedFrames, frames,
+         reusedFrames * 100.0 / frames, saved / 1000.0);
+    frames = reusedFrames = 0;
+    processedCost = 0;
+}
@@ -0,0 +1,83 @@
+#include "DepthSampler.h"
+
+DepthSampler::DepthSampler(){}
+
+void DepthSampler::setLens(const Mat &cameraMatrix)
+{
+    fx = (float)cameraMatrix.at<double>(0, 0);
+    fy = (float)cameraMatrix.at<double>(1, 1);
+    cx = (float)cameraMatrix.at<double>(0, 2);
+    cy = (float)cameraMatrix.at<double>(1, 2);
+}
+
+// The distortion is ignored for compact frames, only z of the point is used for the mapping
+Point3f DepthSampler::pointAt(const Frame &frame, Point pixel, float z) const
+{
+    if(frame.has(Frame::XYZ)) return frame.xyzMap.at<Point3f>(pixel.y, pixel.x);
+    if(fx == 0 || fy == 0) return Point3f(0, 0, z); // lens is not known yet
+    return Point3f((pixel.x - cx) / fx * z, (pixel.y - cy) / fy * z, z);
+}
+
+DepthSampler::Sample DepthSampler::estimate(const Frame &frame, const Rect &bbox) const
+{
+    Rect image(0, 0, frame.confMap.cols, frame.confMap.rows);
+    int inset = RING_GAP, outset = RING_GAP + RING_WIDTH;
+    Rect inner = Rect(bbox.x - inset, bbox.y - inset, bbox.width + 2*inset, bbox.height + 2*inset) & image;
+    Rect outer = Rect(bbox.x - outset, bbox.y - outset, bbox.width + 2*outset, bbox.height + 2*outset) & image;
+
+    int ring = outer.area() - inner.area();
+    int stride = max(1, (ring + MAX_SAMPLES - 1) / MAX_SAMPLES);
+
+    struct Pixel{ float z; int weight; Point position; };
+    vector<Pixel> pixels;
+    pixels.reserve(min(ring, MAX_SAMPLES) + 1);
+    bool packed = !frame.has(Frame::XYZ);
+    // the ring in row order is a run of segments, next and start index the ring pixels
+    int next = 0, start = 0;
+    for(int y = outer.y; y < outer.y + outer.height; y++)
+    {
+        const Vec3f *xyz = packed ? nullptr : frame.xyzMap.ptr<Vec3f>(y);
+        const uint16_t *millimeters = packed ? frame.depthMap.ptr<uint16_t>(y) : nullptr;
+        const uint8_t *conf = frame.confMap.ptr<uint8_t>(y);
+        bool insideRows = y >= inner.y && y < inner.y + inner.height;
+        Range segments[2] = {Range(outer.x, outer.x + outer.width), Range(0, 0)};
+        if(insideRows){
+            segments[0].end = inner.x; // left and right of the blob
+            segments[1] = Range(inner.x + inner.width, outer.x + outer.width);
+        }
+        for(const Range &segment : segments)
+        {
+            int end = start + segment.size();
+            for(; next < end; next += stride)
+            {
+                int x = segment.start + next - start;
+                float z = packed ? millimeters[x] * 0.001f : xyz[x][2];
+                if(conf[x] < MIN_SAMPLE_CONFIDENCE || z <= 0) continue;
+                pixels.push_back({z, conf[x], Point(x, y)});
+            }
+            start = end;
+        }
+    }
+
+    Sample sample;
+    if(pixels.empty()) return sample;
+
+    sort(pixels.begin(), pixels.end(), [](const Pixel &a, const Pixel &b){ return a.z < b.z; });
+    int total = 0;
+    for(const Pixel &p : pixels) total += p.weight;
+
+    // weighted median, the first pixel reaching half of the total weight
+    int half = (total + 1) / 2, cumulative = 0;
+    const Pixel *median = &pixels.back();
+    for(const Pixel &p : pixels){
+        cumulative += p.weight;
+        if(cumulative >= half){
+            median = &p;
+            break;
+        }
+    }
+    sample.xyz = pointAt(frame, median->position, median->z);
+    sample.confidence = total / (int)pixels.size();
+    sample.count = (int)pixels.size();
+    return sample;
+}
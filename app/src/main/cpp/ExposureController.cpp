@@ -0,0 +1,156 @@
+#include "ExposureController.h"
+#include "LatencyMonitor.h"
+#include "Util.h"
+#include <algorithm>
+#include <chrono>
+#include <cmath>
+
+ExposureController::ExposureController() : statsRequested(false) {}
+
+ExposureController::~ExposureController()
+{
+    stop();
+}
+
+void ExposureController::start(ICameraDevice* dev, uint32_t exposureTime)
+{
+    stop();
+    device = dev;
+
+    royale::Pair<uint32_t, uint32_t> limits;
+    if (device->getExposureLimits (limits) == CameraStatus::SUCCESS)
+    {
+        setLimits(limits.first, limits.second);
+    }
+    CameraStatus ret = device->registerExposureListener ((IExposureListener2*)this);
+    if (ret != CameraStatus::SUCCESS)
+    {
+        LOGE ("Failed to register exposure listener, CODE %d", (int) ret);
+    }
+
+    lock_guard<mutex> lock (statsMutex);
+    blobExposure = 0;
+    searchSteps = 0;
+    setExposure(exposureTime);
+    running = true;
+    hasStats = false;
+    statsRequested = true;
+    worker = thread(&ExposureController::run, this);
+    LOGD("Exposure control started, limits %u - %u", minExposure, maxExposure);
+}
+
+void ExposureController::stop()
+{
+    {
+        lock_guard<mutex> lock (statsMutex);
+        running = false;
+        statsRequested = false;
+    }
+    statsCond.notify_all();
+    if(worker.joinable()){
+        worker.join();
+    }
+    if(device){
+        device->unregisterExposureListener();
+        device = nullptr;
+    }
+}
+
+void ExposureController::onBlobStats(int peak, double area)
+{
+    unique_lock<mutex> lock (statsMutex, try_to_lock);
+    if(!lock.owns_lock()) return; // never wait in the data callback
+    latestPeak = peak;
+    latestArea = area;
+    hasStats = true;
+    statsRequested = false;
+}
+
+void ExposureController::onNewExposure (const uint32_t exposureTime, const royale::StreamId streamId)
+{
+    lock_guard<mutex> lock (statsMutex);
+    if(exposureTime == exposure || exposureTime == requested) return; // a change of the controller
+    LOGD("Exposure changed outside the controller: %u -> %u", exposure, exposureTime);
+    setExposure(exposureTime);
+}
+
+void ExposureController::setLimits(uint32_t minTime, uint32_t maxTime)
+{
+    minExposure = minTime;
+    maxExposure = maxTime;
+}
+
+void ExposureController::setExposure(uint32_t exposureTime)
+{
+    exposure = exposureTime;
+    if(blobExposure == 0) blobExposure = exposureTime; // the search starts from the initial exposure
+}
+
+uint32_t ExposureController::nextExposure(int peak)
+{
+    double next;
+    if(peak > 0)
+    {
+        blobExposure = exposure;
+        searchSteps = 0;
+        if(peak >= MIN_PEAK && peak <= MAX_PEAK) return exposure;
+        double ratio = (double)TARGET_PEAK / peak;
+        next = exposure * min(max(ratio, 1.0 / MAX_STEP), MAX_STEP);
+    }
+    else if(searchSteps < MAX_SEARCH_STEPS)
+    {
+        // markers may be too dark to pass the threshold
+        next = blobExposure * pow(SEARCH_STEP, ++searchSteps);
+    }
+    else
+    {
+        if(searchSteps == MAX_SEARCH_STEPS){
+            searchSteps++;
+            LOGD("Exposure search found no blob, back to %u", blobExposure);
+        }
+        next = blobExposure;
+    }
+    return (uint32_t)min(max(next, (double)minExposure), (double)maxExposure);
+}
+
+void ExposureController::run()
+{
+    unique_lock<mutex> lock (statsMutex);
+    while(running)
+    {
+        // requested after a change is applied, so the statistics are of the current exposure
+        hasStats = false;
+        statsRequested = true;
+        statsCond.wait_for(lock, chrono::milliseconds(CONTROL_INTERVAL_MS));
+        if(!running) break;
+        if(!hasStats || exposure == 0) continue;
+
+        int64_t now = LatencyMonitor::now() / 1000;
+        uint32_t next = nextExposure(latestPeak);
+        bool inRange = latestPeak >= MIN_PEAK && latestPeak <= MAX_PEAK;
+        if(inRange)
+        {
+            if(unstableSince != 0){
+                LOGD("Exposure converged in %d ms at %u (peak %d, area %.0f)",
+                     (int)(now - unstableSince), exposure, latestPeak, latestArea);
+                unstableSince = 0;
+            }
+            continue;
+        }
+        if(unstableSince == 0) unstableSince = now;
+        if(next == exposure) continue;
+
+        ICameraDevice* dev = device;
+        requested = next;
+        lock.unlock();
+        CameraStatus ret = dev->setExposureTime (next);
+        lock.lock();
+        if (ret != CameraStatus::SUCCESS)
+        {
+            LOGE ("Failed to set exposure time %u, CODE %d", next, (int) ret);
+            continue;
+        }
+        setExposure(next);
+        if(onExposureChanged) onExposureChanged(next);
+    }
+}
@@ -0,0 +1,128 @@
+#include "FrameScheduler.h"
+#include "Util.h"
+
+static const char* levelNames[] = {"full", "no preview", "decimated", "skip frames"};
+
+// Frames per processed frame of a pipelined stage, skipped frames are ingested only
+static int stride(int level, int stage)
+{
+    return level >= FrameScheduler::SKIP_FRAMES && stage != FrameScheduler::INGEST ? 2 : 1;
+}
+
+FrameScheduler::FrameScheduler(){}
+
+void FrameScheduler::setFrameRate(int fps)
+{
+    lock_guard<mutex> lock (schedulerMutex);
+    budget = fps > 0 ? 1000000 / fps : 0;
+    shed.clear();
+    if(currentLevel != FULL) changeLevel(FULL, 0);
+    overrunStreak = headroomStreak = levelFrames = 0;
+    LOGD("Frame budget: %.2f ms (%d fps)", budget / 1000.0, fps);
+}
+
+// Time a frame takes from the budget at the level, the stage which takes most is the bottleneck
+double FrameScheduler::load(const double costs[STAGE_COUNT], int level, bool pipelined, int &bottleneck) const
+{
+    double total = 0, slowest = -1;
+    for(int s = 0; s < STAGE_COUNT; s++)
+    {
+        double cost = pipelined ? costs[s] / stride(level, s) : costs[s];
+        total += cost;
+        if(cost > slowest){
+            slowest = cost;
+            bottleneck = s;
+        }
+    }
+    return pipelined ? slowest : total;
+}
+
+int FrameScheduler::relief(int stage, bool pipelined) const
+{
+    for(int level = currentLevel + 1; level < LEVEL_COUNT; level++)
+    {
+        if(level == NO_PREVIEW && stage == PUBLISH) return level;
+        if(level == DECIMATED && stage == DETECT) return level;
+        // skipped frames are not detected and published, without the pipeline nothing is skipped
+        if(level == SKIP_FRAMES && pipelined && stage != INGEST) return level;
+    }
+    return -1;
+}
+
+void FrameScheduler::onFrame(const int64_t costs[STAGE_COUNT], bool pipelined)
+{
+    lock_guard<mutex> lock (schedulerMutex);
+    metrics.frames[currentLevel]++;
+    if(budget == 0) return;
+
+    double frame[STAGE_COUNT];
+    levelFrames++;
+    for(int s = 0; s < STAGE_COUNT; s++){
+        frame[s] = (double)costs[s];
+        average[s] = levelFrames == 1 ? frame[s] : average[s] + SMOOTHING * (frame[s] - average[s]);
+    }
+    if(levelFrames == SETTLE_FRAMES && !shed.empty() && !shed.back().measured)
+    {
+        for(int s = 0; s < STAGE_COUNT; s++){
+            shed.back().ratio[s] = average[s] > 0 ? shedCost[s] / average[s] : 1;
+        }
+        shed.back().measured = true;
+    }
+
+    int bottleneck = INGEST;
+    double current = load(frame, currentLevel, pipelined, bottleneck);
+    if(current > budget * OVERRUN_RATIO)
+    {
+        metrics.overruns++;
+        headroomStreak = 0;
+        if(++overrunStreak < DEGRADE_FRAMES) return;
+        int level = relief(bottleneck, pipelined);
+        if(level == -1){
+            overrunStreak = 0; // nothing left to shed for this stage
+            return;
+        }
+        Shed previous;
+        previous.level = currentLevel;
+        shed.push_back(previous);
+        copy(average, average + STAGE_COUNT, shedCost);
+        metrics.degraded++;
+        changeLevel(level, current);
+        return;
+    }
+    overrunStreak = 0;
+
+    if(shed.empty() || !shed.back().measured){
+        headroomStreak = 0;
+        return;
+    }
+    double predicted[STAGE_COUNT];
+    for(int s = 0; s < STAGE_COUNT; s++){
+        predicted[s] = average[s] * shed.back().ratio[s];
+    }
+    int level = shed.back().level;
+    if(load(predicted, level, pipelined, bottleneck) >= budget * HEADROOM_RATIO){
+        headroomStreak = 0;
+    }
+    else if(++headroomStreak >= RESTORE_FRAMES){
+        shed.pop_back();
+        metrics.restored++;
+        changeLevel(level, current);
+    }
+}
+
+// schedulerMutex should be locked by the caller
+void FrameScheduler::changeLevel(int level, double load)
+{
+    LOGD("Scheduler: %s -> %s \t load %.2f ms \t budget %.2f ms", levelNames[currentLevel], levelNames[level],
+         load / 1000.0, budget / 1000.0);
+    currentLevel = level;
+    overrunStreak = headroomStreak = levelFrames = 0; // the cost of the new level is measured from scratch
+}
+
+FrameScheduler::Metrics FrameScheduler::takeMetrics()
+{
+    lock_guard<mutex> lock (schedulerMutex);
+    Metrics taken = metrics;
+    metrics = Metrics();
+    return taken;
+}
@@ -0,0 +1,96 @@
+#include "LatencyMonitor.h"
+#include "Util.h"
+#include <algorithm>
+#include <chrono>
+
+static const char* stageNames[] = {"ingest", "detect", "publish", "display"};
+
+LatencyMonitor::LatencyMonitor()
+{
+    reset();
+}
+
+void LatencyMonitor::reset()
+{
+    lock_guard<mutex> lock (sampleMutex);
+    for(int s = 0; s < STAGE_COUNT; s++){
+        counts[s] = 0;
+    }
+}
+
+int64_t LatencyMonitor::now()
+{
+    return chrono::duration_cast<chrono::microseconds>(
+            chrono::system_clock::now().time_since_epoch()).count();
+}
+
+void LatencyMonitor::record(Stage stage, int64_t captureTime)
+{
+    int64_t delay = now() - captureTime;
+    if(captureTime <= 0 || delay < 0) return; // clocks are not comparable
+    add(stage, delay);
+}
+
+// Every frame is ingested whatever the mode is, so the report does not depend on a single mode
+void LatencyMonitor::add(Stage stage, int64_t delay)
+{
+    lock_guard<mutex> lock (sampleMutex);
+    samples[stage][counts[stage] % WINDOW] = delay;
+    counts[stage]++;
+
+    if(stage == INGEST && counts[INGEST] % REPORT_INTERVAL == 0){
+        report();
+    }
+}
+
+int64_t LatencyMonitor::mean(Stage stage)
+{
+    lock_guard<mutex> lock (sampleMutex);
+    int n = min(counts[stage], WINDOW);
+    if(n == 0) return 0;
+
+    int64_t sum = 0;
+    for(int i = 0; i < n; i++){
+        sum += samples[stage][i];
+    }
+    return sum / n;
+}
+
+int64_t LatencyMonitor::percentile(Stage stage, int percent)
+{
+    lock_guard<mutex> lock (sampleMutex);
+    return percentileLocked(stage, percent);
+}
+
+int LatencyMonitor::samplesIn(Stage stage)
+{
+    lock_guard<mutex> lock (sampleMutex);
+    return min(counts[stage], WINDOW);
+}
+
+// sampleMutex should be locked by the caller
+int64_t LatencyMonitor::percentileLocked(Stage stage, int percent)
+{
+    int n = min(counts[stage], WINDOW);
+    if(n == 0) return 0;
+
+    int64_t sorted[WINDOW];
+    copy(samples[stage], samples[stage] + n, sorted);
+    int k = min(n - 1, n * percent / 100);
+    nth_element(sorted, sorted + k, sorted + n);
+    return sorted[k];
+}
+
+// sampleMutex should be locked by the caller
+void LatencyMonitor::report()
+{
+    for(int s = 0; s < STAGE_COUNT; s++)
+    {
+        Stage stage = (Stage)s;
+        if(counts[s] == 0) continue;
+
+        LOGD("Latency %-7s (ms) p50 = %.1f \t p90 = %.1f \t p99 = %.1f \t max = %.1f", stageNames[s],
+             percentileLocked(stage, 50) / 1000.0, percentileLocked(stage, 90) / 1000.0,
+             percentileLocked(stage, 99) / 1000.0, percentileLocked(stage, 100) / 1000.0);
+    }
+}
@@ -0,0 +1,150 @@
+#include "MarkerConstellation.h"
+#include "LatencyMonitor.h"
+#include "Util.h"
+
+MarkerConstellation::MarkerConstellation(){}
+
+// (u, v) of p in the frame with origin, axis at (1, 0) and its left normal at (0, 1)
+Point2f MarkerConstellation::basisCoordinates(Point2f origin, Point2f axis, Point2f p) const
+{
+    Point2f d = axis - origin, q = p - origin;
+    float length2 = d.x * d.x + d.y * d.y;
+    return Point2f((d.x * q.x + d.y * q.y) / length2, (d.x * q.y - d.y * q.x) / length2);
+}
+
+void MarkerConstellation::setLayout(const vector<Point2f> &points)
+{
+    layout = points;
+    table.clear();
+    int n = (int)layout.size();
+    votes.assign(n * n * 2, 0);
+    spacing = 0;
+    for(int i = 0; i < n; i++){
+        for(int j = i + 1; j < n; j++){
+            float distance = (float)norm(layout[j] - layout[i]);
+            if(spacing == 0 || distance < spacing) spacing = distance;
+        }
+    }
+    for(int i = 0; i < n; i++){
+        for(int j = 0; j < n; j++)
+        {
+            if(i == j) continue;
+            for(int k = 0; k < n; k++)
+            {
+                if(k == i || k == j) continue;
+                Point2f c = basisCoordinates(layout[i], layout[j], layout[k]);
+                int u = (int)floor(c.x / BIN);
+                for(int mirrored = 0; mirrored < 2; mirrored++){
+                    int v = (int)floor((mirrored ? -c.y : c.y) / BIN);
+                    table[key(u, v)].push_back({(i * n + j) * 2 + mirrored, k});
+                }
+            }
+        }
+    }
+    LOGD("Marker constellation: %d markers, %d hash cells", n, (int)table.size());
+}
+
+int MarkerConstellation::identify(const vector<Point2f> &blobs, vector<int> &markers)
+{
+    int64_t start = LatencyMonitor::now();
+    int n = (int)layout.size(), m = min((int)blobs.size(), MAX_BLOBS);
+    markers.assign(n, -1);
+    if(n < 3 || m < 3){
+        report(0, LatencyMonitor::now() - start);
+        return 0;
+    }
+
+    int best = 0;
+    float bestError = 0;
+    vector<int> candidate;
+    for(int a = 0; a < m; a++){
+        for(int b = 0; b < m; b++)
+        {
+            if(a == b) continue;
+            fill(votes.begin(), votes.end(), 0);
+            for(int c = 0; c < m; c++)
+            {
+                if(c == a || c == b) continue;
+                Point2f p = basisCoordinates(blobs[a], blobs[b], blobs[c]);
+                int u = (int)floor(p.x / BIN), v = (int)floor(p.y / BIN);
+                // neighbour cells too, a point near a cell border may be hashed on the other side
+                for(int du = -1; du <= 1; du++){
+                    for(int dv = -1; dv <= 1; dv++)
+                    {
+                        auto cell = table.find(key(u + du, v + dv));
+                        if(cell == table.end()) continue;
+                        for(const Entry &e : cell->second) votes[e.basis]++;
+                    }
+                }
+            }
+            // the bases which can beat the best one are verified, the pair itself is found too
+            for(int basis = 0; basis < (int)votes.size(); basis++)
+            {
+                if(votes[basis] == 0 || votes[basis] + 2 < best) continue;
+                float error;
+                int found = verify(blobs, a, b, basis, candidate, error);
+                if(found > best || (found == best && error < bestError)){
+                    best = found;
+                    bestError = error;
+                    markers = candidate;
+                }
+            }
+        }
+    }
+    report(best, LatencyMonitor::now() - start);
+    return best;
+}
+
+// Predicts every marker from the blob pair (a, b) taken as the layout basis, and assigns
+// the nearest blob within the tolerance to it
+int MarkerConstellation::verify(const vector<Point2f> &blobs, int a, int b, int basis, vector<int> &markers,
+                                float &error) const
+{
+    int n = (int)layout.size();
+    bool mirrored = basis & 1;
+    int i = basis / 2 / n, j = basis / 2 % n;
+    Point2f d = blobs[b] - blobs[a], normal(-d.y, d.x);
+    float scale = (float)(norm(d) / norm(layout[j] - layout[i])); // image pixels per layout unit
+    float tolerance2 = (TOLERANCE * spacing * scale) * (TOLERANCE * spacing * scale);
+
+    markers.assign(n, -1);
+    vector<bool> used(blobs.size(), false);
+    int found = 0;
+    error = 0;
+    for(int k = 0; k < n; k++)
+    {
+        Point2f c = basisCoordinates(layout[i], layout[j], layout[k]);
+        if(mirrored) c.y = -c.y;
+        Point2f predicted = blobs[a] + Point2f(d.x * c.x + normal.x * c.y, d.y * c.x + normal.y * c.y);
+        int nearest = -1;
+        float nearest2 = tolerance2;
+        for(int q = 0; q < (int)blobs.size(); q++)
+        {
+            Point2f e = blobs[q] - predicted;
+            float distance2 = e.x * e.x + e.y * e.y;
+            if(!used[q] && distance2 <= nearest2){
+                nearest = q;
+                nearest2 = distance2;
+            }
+        }
+        if(nearest == -1) continue;
+        markers[k] = nearest;
+        used[nearest] = true;
+        found++;
+        error += nearest2 / (scale * scale);
+    }
+    if(found > 0) error /= found;
+    return found;
+}
+
+void MarkerConstellation::report(int identified, int64_t cost)
+{
+    frames++;
+    markersFound += identified;
+    totalCost += cost;
+    if(frames < REPORT_INTERVAL) return;
+    LOGD("Marker constellation: %.1f of %d markers per frame \t %.3f ms per frame",
+         (double)markersFound / frames, (int)layout.size(), totalCost / 1000.0 / frames);
+    frames = markersFound = 0;
+    totalCost = 0;
+}
@@ -0,0 +1,84 @@
+#include "OutputStage.h"
+#include "CallbackManager.h"
+#include "LatencyMonitor.h"
+#include "Util.h"
+
+OutputStage::OutputStage(){}
+
+void OutputStage::setSize(Size display, Size projector)
+{
+    lock_guard<mutex> lock (outputMutex);
+    renderer.setSize(display, projector);
+    staticChanged = pending = true;
+}
+
+void OutputStage::setPattern(const Mat &pattern)
+{
+    lock_guard<mutex> lock (outputMutex);
+    renderer.setPattern(pattern);
+    staticChanged = pending = true;
+}
+
+void OutputStage::setCadence(int hz)
+{
+    lock_guard<mutex> lock (outputMutex);
+    cadence = hz;
+    LOGD("Output cadence: %d Hz (0 = vsync)", hz);
+}
+
+void OutputStage::publish(CallbackManager &callbackManager, const vector<int> &centers, int64_t captureTime)
+{
+    lock_guard<mutex> lock (outputMutex);
+    if(!staticChanged && centers == presented){
+        unchanged++;
+        pending = false;
+        return; // already on the display
+    }
+    if(pending) coalesced++; // previous result was never shown
+
+    latest = centers;
+    latestTime = captureTime;
+    pending = true;
+
+    if(cadence > 0)
+    {
+        int64_t now = LatencyMonitor::now();
+        if(now - lastPush < 1000000 / cadence) return;
+
+        if(callbackManager.presentOverlay(renderer, latest, latestTime)){
+            presented = latest;
+            pending = staticChanged = false;
+            lastPush = now;
+            countPublished();
+        }
+    }
+}
+
+int OutputStage::onVsync(CallbackManager &callbackManager, JNIEnv* env, int64_t &captureTime)
+{
+    lock_guard<mutex> lock (outputMutex);
+    if(!pending) return -1;
+    // With a cadence the processing thread pushes, but a result held back for the cadence stays
+    // pending if no later frame is published, e.g. while the change gate reuses frames
+    int64_t now = LatencyMonitor::now();
+    if(cadence > 0 && now - lastPush < 1000000 / cadence) return -1;
+
+    int buffer = callbackManager.renderOverlay(env, renderer, latest);
+    if(buffer == -1) return -1;
+
+    if(cadence > 0) lastPush = now;
+    presented = latest;
+    captureTime = latestTime;
+    pending = staticChanged = false;
+    countPublished();
+    return buffer;
+}
+
+// outputMutex should be locked by the caller
+void OutputStage::countPublished()
+{
+    if(++published < REPORT_INTERVAL) return;
+
+    LOGD("Output: %d published \t %d coalesced \t %d unchanged", published, coalesced, unchanged);
+    published = coalesced = unchanged = 0;
+}
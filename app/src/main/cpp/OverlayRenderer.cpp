@@ -0,0 +1,76 @@
+#include "OverlayRenderer.h"
+
+static const Scalar black(0, 0, 0, 255);
+static const Scalar white(255, 255, 255, 255);
+
+OverlayRenderer::OverlayRenderer()
+{
+    fullRedraw[0] = fullRedraw[1] = true;
+}
+
+void OverlayRenderer::setSize(Size display, Size projector)
+{
+    displaySize = display;
+    projectorSize = projector;
+    updateBackground();
+}
+
+void OverlayRenderer::setPattern(const Mat &p)
+{
+    pattern = p;
+    updateBackground();
+}
+
+void OverlayRenderer::updateBackground()
+{
+    if(displaySize.area() == 0) return;
+
+    background.create(displaySize, CV_8UC4);
+    background.setTo(black);
+    rectangle(background, Point(0, 0), Point(projectorSize.width, projectorSize.height), white, THICKNESS);
+
+    if(!pattern.empty())
+    {
+        // keep aspect ratio of the pattern, centered on the projector
+        double scale = min((double)projectorSize.width / pattern.cols, (double)projectorSize.height / pattern.rows);
+        Size fitted((int)(pattern.cols * scale), (int)(pattern.rows * scale));
+        Rect roi = Rect(Point((projectorSize.width - fitted.width) / 2, (projectorSize.height - fitted.height) / 2), fitted)
+                   & Rect(Point(0, 0), displaySize);
+        Mat resized, argb;
+        resize(pattern, resized, fitted, 0, 0, INTER_NEAREST);
+        cvtColor(resized, argb, COLOR_GRAY2RGBA);
+        argb(Rect(Point(0, 0), roi.size())).copyTo(background(roi));
+    }
+    fullRedraw[0] = fullRedraw[1] = true;
+}
+
+void OverlayRenderer::render(int buffer, Mat &target, const vector<int> &centers)
+{
+    Rect canvas(Point(0, 0), target.size());
+
+    if(fullRedraw[buffer] || target.size() != background.size())
+    {
+        background.copyTo(target);
+        fullRedraw[buffer] = false;
+    }
+    else
+    {
+        // erase the blobs drawn last time on this buffer
+        for(const Rect &r : drawn[buffer]){
+            background(r).copyTo(target(r));
+        }
+    }
+    drawn[buffer].clear();
+
+    int extent = OUTER_RADIUS + THICKNESS;
+    for(int i = 0; i + 1 < (int)centers.size(); i += 2)
+    {
+        Point c(centers[i], centers[i+1]);
+        Rect r = Rect(c.x - extent, c.y - extent, 2 * extent + 1, 2 * extent + 1) & canvas;
+        if(r.area() == 0) continue;
+
+        circle(target, c, OUTER_RADIUS, white, THICKNESS);
+        circle(target, c, INNER_RADIUS, white, THICKNESS);
+        drawn[buffer].push_back(r);
+    }
+}
@@ -0,0 +1,61 @@
+#include "PointAverager.h"
+#include "Util.h"
+
+void PointAverager::RunningStats::add(double value)
+{
+    count++;
+    double delta = value - mean;
+    mean += delta / count;
+    m2 += delta * (value - mean);
+}
+
+PointAverager::PointAverager()
+{
+    frames = WINDOW; // not active
+}
+
+void PointAverager::start(int count)
+{
+    slots.assign(count, Accumulator());
+    frames = 0;
+}
+
+void PointAverager::cancel()
+{
+    frames = WINDOW;
+}
+
+void PointAverager::add(int slot, Point2f uv, Point3f xyz)
+{
+    if(!active() || slot < 0 || slot >= (int)slots.size()) return;
+    Accumulator &a = slots[slot];
+    a.u.add(uv.x);
+    a.v.add(uv.y);
+    a.x.add(xyz.x);
+    a.y.add(xyz.y);
+    a.z.add(xyz.z);
+}
+
+bool PointAverager::endFrame()
+{
+    if(!active()) return false;
+    return ++frames == WINDOW;
+}
+
+bool PointAverager::result(int slot, Point &point) const
+{
+    const Accumulator &a = slots[slot];
+    if(a.z.count < MIN_SAMPLES){
+        LOGD("Point %d is seen in %d of %d frames, it is not saved", slot, a.z.count, WINDOW);
+        return false;
+    }
+    point.uv = Point2f((float)a.u.mean, (float)a.v.mean);
+    point.xyz = Point3f((float)a.x.mean, (float)a.y.mean, (float)a.z.mean);
+    point.variance = Point3f((float)a.u.variance(), (float)a.v.variance(), (float)a.z.variance());
+    if(point.variance.x + point.variance.y > MAX_UV_VARIANCE || point.variance.z > MAX_DEPTH_VARIANCE){
+        LOGD("Point %d moved during averaging, variance uv %.2f px^2 z %.2f cm^2, it is not saved",
+             slot, point.variance.x + point.variance.y, point.variance.z);
+        return false;
+    }
+    return true;
+}
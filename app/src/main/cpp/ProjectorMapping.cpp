@@ -0,0 +1,43 @@
+#include "ProjectorMapping.h"
+
+ProjectorMapping::ProjectorMapping(){}
+
+// Depth is rounded to 1 mm in the table, well below the noise of the sensor
+void ProjectorMapping::create(Point2d s, Point2d o, Vec4d coef)
+{
+    scale = s;
+    offset = o;
+    coefficients = coef;
+    const double one = 1 << SHIFT;
+    xScaleFixed = (int)lround(scale.x * one);
+    yScaleFixed = (int)lround(scale.y * one);
+    xOffsetFixed = (int)lround(offset.x * one);
+    yOffsetFixed = (int)lround(offset.y * one);
+
+    xShift.resize(DEPTHS);
+    yShift.resize(DEPTHS);
+    for(int mm = 0; mm < DEPTHS; mm++)
+    {
+        double depth = mm / 10.0; // in cm
+        double shiftx = coef[0] * exp(coef[1]*depth);
+        double shifty = coef[2] * exp(coef[3]*depth);
+        xShift[mm] = (int)lround(max(-MAX_SHIFT, min(MAX_SHIFT, shiftx)) * one);
+        yShift[mm] = (int)lround(max(-MAX_SHIFT, min(MAX_SHIFT, shifty)) * one);
+    }
+}
+
+Point2i ProjectorMapping::map(Point2i pp, float depth) const
+{
+    int mm = (int)(depth * 10 + 0.5f);
+    if(mm >= (int)xShift.size()) return mapFloat(pp, depth);
+    return Point2i((pp.x * xScaleFixed - xOffsetFixed - xShift[mm]) >> SHIFT,
+                   (pp.y * yScaleFixed - yOffsetFixed - yShift[mm]) >> SHIFT);
+}
+
+Point2i ProjectorMapping::mapFloat(Point2i pp, float depth) const
+{
+    const Vec4d &coef = coefficients;
+    double shiftx = coef[0] * exp(coef[1]*depth);
+    double shifty = coef[2] * exp(coef[3]*depth);
+    return Point2i((int)(pp.x * scale.x - offset.x - shiftx), (int)(pp.y * scale.y - offset.y - shifty));
+}
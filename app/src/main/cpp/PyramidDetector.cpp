@@ -0,0 +1,111 @@
+#include "PyramidDetector.h"
+#include "ThreadPool.h"
+
+static const int POOL_GRAIN = 8; // coarse rows per task
+
+PyramidDetector::PyramidDetector(){}
+
+void PyramidDetector::detect(const Mat &gray, int threshold, vector<Blob> &blobs, int step)
+{
+    maxPool(gray);
+    coarseSegmenter.segment(coarse, threshold, coarseBlobs);
+    findRegions(gray.size());
+
+    // pixels outside of the regions are below the threshold, the mask is zero there
+    maskWords = step == 1 ? (gray.cols + 31) / 32 : 0;
+    mask.assign(gray.rows * maskWords, 0);
+
+    blobs.clear();
+    for(const Rect &region : regions)
+    {
+        fineSegmenter.segment(gray(region), threshold, regionBlobs, step);
+        for(Blob &blob : regionBlobs){
+            blob.bbox += region.tl();
+            blob.centroid += Point2f((float)region.x, (float)region.y);
+            blobs.push_back(blob);
+        }
+        if(step == 1) copyMask(region);
+    }
+}
+
+// ORs the packed mask of the region into the mask of the frame, shifted to the region column
+void PyramidDetector::copyMask(const Rect &region)
+{
+    const vector<uint32_t> &source = fineSegmenter.packedMask();
+    int words = fineSegmenter.packedWords();
+    int shift = region.x & 31;
+    for(int y = 0; y < region.height; y++)
+    {
+        const uint32_t *in = &source[y * words];
+        uint32_t *out = &mask[(region.y + y) * maskWords + (region.x >> 5)];
+        for(int i = 0; i < words; i++)
+        {
+            out[i] |= in[i] << shift;
+            if(shift > 0 && (region.x >> 5) + i + 1 < maskWords) out[i+1] |= in[i] >> (32 - shift);
+        }
+    }
+}
+
+void PyramidDetector::setSuppression(const uint32_t *bits, int words)
+{
+    fineSegmenter.setSuppression(bits, words);
+}
+
+// coarse(y, x) = max of the FACTOR x FACTOR cell, cells at the border can be smaller.
+// The rows of a cell are reduced first, then FACTOR neighbours of the reduced row, both in
+// loops over whole rows without a division per pixel.
+void PyramidDetector::maxPool(const Mat &gray)
+{
+    int rows = (gray.rows + FACTOR - 1) / FACTOR, cols = (gray.cols + FACTOR - 1) / FACTOR;
+    coarse.create(rows, cols, CV_16UC1);
+
+    ThreadPool::shared().parallelFor(0, rows, POOL_GRAIN, [&](int from, int to)
+    {
+        vector<uint16_t> rowMax (cols * FACTOR, 0); // past the last column it stays 0
+        for(int cy = from; cy < to; cy++)
+        {
+            int y = cy * FACTOR, last = min(y + FACTOR, gray.rows);
+            const uint16_t *first = gray.ptr<uint16_t>(y);
+            copy(first, first + gray.cols, rowMax.begin());
+            for(y++; y < last; y++)
+            {
+                const uint16_t *in = gray.ptr<uint16_t>(y);
+                for(int x = 0; x < gray.cols; x++) rowMax[x] = max(rowMax[x], in[x]);
+            }
+
+            uint16_t *out = coarse.ptr<uint16_t>(cy);
+            const uint16_t *cells = rowMax.data();
+            for(int cx = 0; cx < cols; cx++) out[cx] = cells[cx * FACTOR];
+            for(int k = 1; k < FACTOR; k++){
+                for(int cx = 0; cx < cols; cx++) out[cx] = max(out[cx], cells[cx * FACTOR + k]);
+            }
+        }
+    });
+}
+
+// Full resolution rectangles of the coarse blobs, merged until none of them overlap
+void PyramidDetector::findRegions(Size size)
+{
+    Rect image(Point(0, 0), size);
+    regions.clear();
+    for(const Blob &blob : coarseBlobs){
+        Rect r = blob.bbox;
+        regions.push_back(Rect(r.x * FACTOR, r.y * FACTOR, r.width * FACTOR, r.height * FACTOR) & image);
+    }
+
+    bool merged = true;
+    while(merged)
+    {
+        merged = false;
+        for(int i = 0; i < (int)regions.size() && !merged; i++){
+            for(int j = i + 1; j < (int)regions.size(); j++){
+                if((regions[i] & regions[j]).area() > 0){
+                    regions[i] |= regions[j];
+                    regions.erase(regions.begin() + j);
+                    merged = true;
+                    break;
+                }
+            }
+        }
+    }
+}
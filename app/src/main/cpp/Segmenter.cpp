@@ -0,0 +1,278 @@
+#include "Segmenter.h"
+
+#if defined(__ARM_NEON) || defined(__ARM_NEON__)
+#include <arm_neon.h>
+#endif
+
+static int findRoot(vector<int> &parent, int i)
+{
+    while(parent[i] != i){
+        parent[i] = parent[parent[i]]; // path halving
+        i = parent[i];
+    }
+    return i;
+}
+
+// smaller index becomes the root, so labels do not depend on the order of the unions
+static void unite(vector<int> &parent, int a, int b)
+{
+    a = findRoot(parent, a);
+    b = findRoot(parent, b);
+    if(a < b) parent[b] = a;
+    else if(b < a) parent[a] = b;
+}
+
+// Unites the touching runs of two consecutive rows, 8-connected
+template <typename Unite>
+static void connectRows(const vector<Segmenter::Run> &prevRuns, int prevBegin, int prevEnd,
+                        const vector<Segmenter::Run> &curRuns, int curBegin, int curEnd, Unite unite)
+{
+    int i = prevBegin, j = curBegin;
+    while(i < prevEnd && j < curEnd)
+    {
+        const Segmenter::Run &a = prevRuns[i], &b = curRuns[j];
+        if(a.start <= b.end && b.start <= a.end){
+            unite(i, j);
+        }
+        if(a.end < b.end) i++;
+        else j++;
+    }
+}
+
+// Sets bit x of the row when row[x] > threshold
+static void packRow(const uint16_t *row, int cols, int threshold, uint32_t *bits)
+{
+    fill(bits, bits + (cols + 31) / 32, 0);
+    int x = 0;
+#if defined(__ARM_NEON) || defined(__ARM_NEON__)
+    // compare 8 pixels, narrow the lanes to bytes and fold them to one byte of the mask
+    static const uint8_t weights[8] = {1, 2, 4, 8, 16, 32, 64, 128};
+    uint16x8_t limit = vdupq_n_u16((uint16_t)min(threshold, 0xFFFF));
+    uint8x8_t weight = vld1_u8(weights);
+    uint8_t *bytes = (uint8_t*)bits; // little endian, byte b holds the pixels 8b .. 8b+7
+    for(; x + 8 <= cols; x += 8)
+    {
+        uint8x8_t b = vand_u8(vmovn_u16(vcgtq_u16(vld1q_u16(row + x), limit)), weight);
+        b = vpadd_u8(b, b);
+        b = vpadd_u8(b, b);
+        b = vpadd_u8(b, b);
+        bytes[x >> 3] = vget_lane_u8(b, 0);
+    }
+#endif
+    for(; x < cols; x++){
+        if(row[x] > threshold) bits[x >> 5] |= 1u << (x & 31);
+    }
+}
+
+static void packRow(const uint16_t *row, int cols, int step, int threshold, uint32_t *bits)
+{
+    fill(bits, bits + (cols + 31) / 32, 0);
+    for(int x = 0; x < cols; x++){
+        if(row[x * step] > threshold) bits[x >> 5] |= 1u << (x & 31);
+    }
+}
+
+// First x >= from whose bit equals value, cols if there is none. Empty words are skipped at once.
+static int nextBit(const uint32_t *bits, int from, int cols, bool value)
+{
+    int x = from;
+    while(x < cols)
+    {
+        uint32_t word = value ? bits[x >> 5] : ~bits[x >> 5];
+        word &= ~0u << (x & 31);
+        if(word != 0) return min(cols, (x & ~31) + __builtin_ctz(word));
+        x = (x & ~31) + 32;
+    }
+    return cols;
+}
+
+Segmenter::Segmenter(){}
+
+void Segmenter::setSuppression(const uint32_t *bits, int words)
+{
+    suppression = bits;
+    suppressionWords = words;
+}
+
+// Clears the bits of a decimated row whose full resolution pixel is suppressed.
+// row and column are the full resolution position of the first pixel.
+void Segmenter::suppressRow(uint32_t *bits, int cols, int step, int row, int column) const
+{
+    const uint32_t *s = suppression + row * suppressionWords;
+    if(step == 1)
+    {
+        // 32 suppressed bits starting from an arbitrary column
+        int shift = column & 31, first = column >> 5;
+        for(int i = 0; i < (cols + 31) / 32; i++)
+        {
+            int w = first + i;
+            uint32_t word = w < suppressionWords ? s[w] >> shift : 0;
+            if(shift != 0 && w + 1 < suppressionWords) word |= s[w + 1] << (32 - shift);
+            bits[i] &= ~word;
+        }
+        return;
+    }
+    for(int x = 0; x < cols; x++){
+        int c = column + x * step;
+        if((s[c >> 5] >> (c & 31)) & 1) bits[x >> 5] &= ~(1u << (x & 31));
+    }
+}
+
+// Runs are in the coordinates of the decimated image, every step-th row and column.
+// The rows are packed to the mask first, runs are read from the mask after suppression.
+// offset is the position of gray in the whole image.
+void Segmenter::extractRuns(const Mat &gray, int threshold, int step, Point offset, Stripe &stripe)
+{
+    stripe.runs.clear();
+    stripe.rowStart.clear();
+    int cols = (gray.cols + step - 1) / step;
+    for(int y = stripe.firstRow; y < stripe.lastRow; y++)
+    {
+        stripe.rowStart.push_back((int)stripe.runs.size());
+        const uint16_t *p = gray.ptr<uint16_t>(y * step);
+        uint32_t *bits = &mask[y * maskWords];
+        if(step == 1) packRow(p, cols, threshold, bits);
+        else packRow(p, cols, step, threshold, bits);
+        if(suppression != nullptr){
+            stripe.rowBits.assign(bits, bits + maskWords);
+            bits = stripe.rowBits.data();
+            suppressRow(bits, cols, step, offset.y + y * step, offset.x);
+        }
+
+        int x = nextBit(bits, 0, cols, true);
+        while(x < cols)
+        {
+            Run run;
+            run.row = y;
+            run.start = x;
+            run.end = nextBit(bits, x, cols, false);
+            run.peak = 0;
+            for(int i = run.start; i < run.end; i++){
+                run.peak = max(run.peak, (int)p[i * step]);
+            }
+            stripe.runs.push_back(run);
+            x = nextBit(bits, run.end, cols, true);
+        }
+    }
+    stripe.rowStart.push_back((int)stripe.runs.size());
+}
+
+void Segmenter::labelStripe(Stripe &stripe)
+{
+    vector<int> &local = stripe.parent;
+    local.resize(stripe.runs.size());
+    for(int i = 0; i < (int)local.size(); i++) local[i] = i;
+
+    int rows = stripe.lastRow - stripe.firstRow;
+    for(int r = 1; r < rows; r++){
+        connectRows(stripe.runs, stripe.rowStart[r-1], stripe.rowStart[r],
+                    stripe.runs, stripe.rowStart[r], stripe.rowStart[r+1],
+                    [&local](int a, int b){ unite(local, a, b); });
+    }
+}
+
+void Segmenter::segment(const Mat &gray, int threshold, vector<Blob> &blobs, int step)
+{
+    ThreadPool &pool = ThreadPool::shared();
+    int rows = (gray.rows + step - 1) / step;
+    maskWords = ((gray.cols + step - 1) / step + 31) / 32;
+    mask.resize(rows * maskWords);
+    int count = max(1, min(stripeCount > 0 ? stripeCount : pool.size(), rows / MIN_STRIPE_ROWS));
+    int rowsPerStripe = (rows + count - 1) / count;
+    stripes.resize(count);
+    for(int s = 0; s < count; s++){
+        stripes[s].firstRow = min(s * rowsPerStripe, rows);
+        stripes[s].lastRow = min((s + 1) * rowsPerStripe, rows);
+    }
+
+    Size whole;
+    Point origin; // of gray in the whole image
+    gray.locateROI(whole, origin);
+
+    pool.parallelFor(0, count, 1, [&](int from, int to){
+        for(int s = from; s < to; s++){
+            extractRuns(gray, threshold, step, origin, stripes[s]);
+            labelStripe(stripes[s]);
+        }
+    });
+
+    // global labels, then merge the components crossing the stripe borders
+    vector<int> offset(count + 1, 0);
+    for(int s = 0; s < count; s++){
+        offset[s+1] = offset[s] + (int)stripes[s].runs.size();
+    }
+    parent.resize(offset[count]);
+    for(int s = 0; s < count; s++){
+        for(int i = 0; i < (int)stripes[s].runs.size(); i++){
+            parent[offset[s] + i] = offset[s] + findRoot(stripes[s].parent, i);
+        }
+    }
+    for(int s = 1; s < count; s++)
+    {
+        Stripe &above = stripes[s-1], &below = stripes[s];
+        int aboveRows = above.lastRow - above.firstRow;
+        if(aboveRows == 0 || below.lastRow == below.firstRow) continue;
+        int oa = offset[s-1], ob = offset[s];
+        connectRows(above.runs, above.rowStart[aboveRows-1], above.rowStart[aboveRows],
+                    below.runs, below.rowStart[0], below.rowStart[1],
+                    [this, oa, ob](int a, int b){ unite(parent, oa + a, ob + b); });
+    }
+
+    // statistics per component, in the order of their first run
+    blobs.clear();
+    blobIndex.assign(parent.size(), -1);
+    vector<Point2d> sums;
+    for(int s = 0; s < count; s++)
+    {
+        for(int i = 0; i < (int)stripes[s].runs.size(); i++)
+        {
+            const Run &run = stripes[s].runs[i];
+            int root = findRoot(parent, offset[s] + i);
+            if(blobIndex[root] == -1){
+                blobIndex[root] = (int)blobs.size();
+                blobs.push_back(Blob());
+                blobs.back().bbox = Rect(run.start, run.row, run.end - run.start, 1);
+                sums.push_back(Point2d(0, 0));
+            }
+            Blob &blob = blobs[blobIndex[root]];
+            int length = run.end - run.start;
+            blob.bbox |= Rect(run.start, run.row, length, 1);
+            blob.area += length;
+            blob.peak = max(blob.peak, run.peak);
+            sums[blobIndex[root]] += Point2d((run.start + run.end - 1) * length / 2.0, (double)run.row * length);
+        }
+    }
+    for(int b = 0; b < (int)blobs.size(); b++){
+        blobs[b].centroid = Point2f((float)(sums[b].x / blobs[b].area), (float)(sums[b].y / blobs[b].area));
+    }
+    if(step == 1) return;
+
+    // back to full resolution, a decimated pixel stands for step x step pixels
+    Rect image(0, 0, gray.cols, gray.rows);
+    for(Blob &blob : blobs){
+        blob.bbox = Rect(blob.bbox.x * step, blob.bbox.y * step, blob.bbox.width * step, blob.bbox.height * step) & image;
+        blob.area *= step * step;
+        blob.centroid = Point2f(blob.centroid.x * step, blob.centroid.y * step);
+    }
+}
+
+void Segmenter::segmentSerial(const Mat &gray, int threshold, vector<Blob> &blobs)
+{
+    Mat mask, labels, stats, centroids;
+    mask = gray > threshold;
+    int count = connectedComponentsWithStats(mask, labels, stats, centroids, 8, CV_32S);
+
+    blobs.clear();
+    for(int i = 1; i < count; i++) // 0 is the background
+    {
+        Blob blob;
+        blob.bbox = Rect(stats.at<int>(i, CC_STAT_LEFT), stats.at<int>(i, CC_STAT_TOP),
+                         stats.at<int>(i, CC_STAT_WIDTH), stats.at<int>(i, CC_STAT_HEIGHT));
+        blob.area = stats.at<int>(i, CC_STAT_AREA);
+        blob.centroid = Point2f((float)centroids.at<double>(i, 0), (float)centroids.at<double>(i, 1));
+        double maxVal;
+        minMaxLoc(gray(blob.bbox), nullptr, &maxVal, nullptr, nullptr, labels(blob.bbox) == i);
+        blob.peak = (int)maxVal;
+        blobs.push_back(blob);
+    }
+}
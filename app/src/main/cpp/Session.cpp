@@ -0,0 +1,314 @@
+#include "Session.h"
+#include "Util.h"
+#include <royale/CameraManager.hpp>
+
+Session::Session()
+{
+    calibrator.startPipeline();
+}
+
+Session::~Session()
+{
+    if (capturing) stopCapture();
+    useCaseSelector.cancel();
+    calibrator.exposureController.stop();
+    calibrator.waitIdle();
+    calibrator.stopPipeline();
+}
+
+bool Session::open(int fd, int vid, int pid, uint16_t &cam_width, uint16_t &cam_height)
+{
+    // the camera manager will query for a connected camera
+    {
+        CameraManager manager;
+        auto camlist = manager.getConnectedCameraList (fd, vid, pid);
+        LOGI ("Detected %zu camera(s).", camlist.size());
+
+        if (!camlist.empty())
+        {
+            cameraDevice = manager.createCamera (camlist.at (0));
+        }
+    }
+    // the camera device is now available and CameraManager can be deallocated here
+
+    if (cameraDevice == nullptr)
+    {
+        LOGE ("Cannot create the camera device");
+        return false;
+    }
+
+    // IMPORTANT: call the initialize method before working with the camera device
+    CameraStatus ret = cameraDevice->initialize();
+    if (ret != CameraStatus::SUCCESS)
+    {
+        LOGE ("Cannot initialize the camera device, CODE %d", (int) ret);
+    }
+
+    royale::Vector<royale::String> opModes;
+    royale::String cameraName;
+    royale::String cameraId;
+
+    ret = cameraDevice->getUseCases (opModes);
+    if (ret != CameraStatus::SUCCESS)
+    {
+        LOGE ("Failed to get use cases, CODE %d", (int) ret);
+    }
+
+    ret = cameraDevice->getMaxSensorWidth (cam_width);
+    if (ret != CameraStatus::SUCCESS)
+    {
+        LOGE ("Failed to get max sensor width, CODE %d", (int) ret);
+    }
+
+    ret = cameraDevice->getMaxSensorHeight (cam_height);
+    if (ret != CameraStatus::SUCCESS)
+    {
+        LOGE ("Failed to get max sensor height, CODE %d", (int) ret);
+    }
+
+    ret = cameraDevice->getId (cameraId);
+    if (ret != CameraStatus::SUCCESS)
+    {
+        LOGE ("Failed to get camera ID, CODE %d", (int) ret);
+    }
+
+    ret = cameraDevice->getCameraName (cameraName);
+    if (ret != CameraStatus::SUCCESS)
+    {
+        LOGE ("Failed to get camera name, CODE %d", (int) ret);
+    }
+
+    // display some information about the connected camera
+    LOGI ("====================================");
+    LOGI ("        Camera information");
+    LOGI ("====================================");
+    LOGI ("Id:              %s", cameraId.c_str());
+    LOGI ("Type:            %s", cameraName.c_str());
+    LOGI ("Width:           %d", cam_width);
+    LOGI ("Height:          %d", cam_height);
+    LOGI ("Operation modes: %zu", opModes.size());
+
+    for (int i = 0; i < opModes.size(); i++)
+    {
+        LOGI ("    %s", opModes.at (i).c_str());
+    }
+
+    // Set camera and projector values for calibration
+    calibrator.setCamera(cam_width, cam_height, 62, 45);
+    calibrator.setProjector(1280, 720, 46.4, 24.2);    // TODO make it generic
+    if(!calibration.empty()){
+        calibrator.setCalibration(calibration.data());
+    }
+
+    LensParameters lensParams;
+    ret = cameraDevice->getLensParameters (lensParams);
+    if (ret != CameraStatus::SUCCESS)
+    {
+        LOGE ("Failed to get lens parameters, CODE %d", (int) ret);
+    }else{
+        calibrator.setLensParameters (lensParams);
+    }
+
+    // register the data listeners needed by the current mode
+    registeredStreams = 0;
+    selectStreams();
+
+    // set an operation mode
+    ret = cameraDevice->setUseCase (opModes[0]);
+    if (ret != CameraStatus::SUCCESS)
+    {
+        LOGE ("Failed to set use case, CODE %d", (int) ret);
+    }
+
+    //set exposure mode to manual
+    ret = cameraDevice->setExposureMode (ExposureMode::MANUAL);
+    if (ret != CameraStatus::SUCCESS)
+    {
+        LOGE ("Failed to set exposure mode, CODE %d", (int) ret);
+    }
+
+    //set exposure time (not working above 300)
+    ret = cameraDevice->setExposureTime(30);
+    if (ret != CameraStatus::SUCCESS)
+    {
+        LOGE ("Failed to set exposure time, CODE %d", (int) ret);
+    }
+
+    // keep retro markers in range from this initial exposure
+    calibrator.exposureController.onExposureChanged = [this](uint32_t time){
+        useCaseSelector.setExposureTime(time);
+    };
+    calibrator.exposureController.start(cameraDevice.get(), 30);
+    return true;
+}
+
+void Session::registerCallback(JNIEnv *env, jobject thiz)
+{
+    // save JavaVM globally; needed later to call Java method in the listener
+    JavaVM* m_vm;
+    env->GetJavaVM (&m_vm);
+
+    jobject m_obj = env->NewGlobalRef (thiz);
+
+    // save refs for callback
+    jclass g_class = env->GetObjectClass (m_obj);
+    if (g_class == NULL)
+    {
+        LOGE ("Failed to find class");
+    }
+
+    // save method ID to call the method later in the listener
+    jmethodID m_amplitudeCallbackID = env->GetMethodID (g_class, "amplitudeCallback", "([I)V");
+    jmethodID m_overlayCallbackID = env->GetMethodID (g_class, "overlayCallback", "(IJ)V");
+    jmethodID m_pointCallbackID = env->GetMethodID (g_class, "pointCallback", "(IIIII)V");
+
+    calibrator.setCallbackManager(CallbackManager(m_vm, m_obj, m_amplitudeCallbackID, m_overlayCallbackID, m_pointCallbackID));
+}
+
+void Session::release(JNIEnv *env)
+{
+    if (capturing) stopCapture();
+    calibrator.waitIdle();
+    calibrator.callbackManager.release(env);
+}
+
+bool Session::startCapture()
+{
+    if (cameraDevice == nullptr)
+    {
+        LOGE("There is no camera device to  start");
+        return false;
+    }
+    auto ret = cameraDevice->startCapture();
+    if (ret != CameraStatus::SUCCESS)
+    {
+        LOGE("Failed to start capture, CODE %d", (int) ret);
+        return false;
+    }
+    LOGI("Capture started.");
+    capturing = true;
+    if (currentMode != 0)
+    {
+        useCaseSelector.select(cameraDevice.get(), &calibrator, currentMode);
+    }
+    return true;
+}
+
+bool Session::stopCapture()
+{
+    if (cameraDevice == nullptr)
+    {
+        LOGE ("There is no camera device to  stop");
+        return false;
+    }
+    useCaseSelector.cancel();
+    capturing = false;
+    auto ret = cameraDevice->stopCapture();
+    if (ret != CameraStatus::SUCCESS)
+    {
+        LOGE ("Failed to stop capture, CODE %d", (int) ret);
+        return false;
+    }
+    LOGI("Capture stopped.");
+    return true;
+}
+
+void Session::changeMode(int mode)
+{
+    calibrator.setMode(mode); // TODO chcek the setmode method, java and cpp side can be different
+    selectStreams();
+
+    // processing cost depends on the mode, so the use case is re-evaluated
+    currentMode = mode;
+    if (capturing)
+    {
+        useCaseSelector.select(cameraDevice.get(), &calibrator, currentMode);
+    }
+}
+
+void Session::loadCalibration(const double* arr)
+{
+    calibration.assign(arr, arr + 4);
+    calibrator.setCalibration(calibration.data());
+}
+
+// Registers only the royale streams which the current mode of the calibrator needs
+void Session::selectStreams()
+{
+    if (cameraDevice == nullptr) return;
+
+    int streams = calibrator.requiredStreams();
+    if (streams == registeredStreams) return;
+
+    CameraStatus ret;
+    if ((registeredStreams & CamListener::DEPTH_DATA) && !(streams & CamListener::DEPTH_DATA))
+    {
+        cameraDevice->unregisterDataListener();
+    }
+    if ((registeredStreams & CamListener::DEPTH_IMAGE) && !(streams & CamListener::DEPTH_IMAGE))
+    {
+        cameraDevice->unregisterDepthImageListener();
+    }
+    if (!(registeredStreams & CamListener::DEPTH_DATA) && (streams & CamListener::DEPTH_DATA))
+    {
+        ret = cameraDevice->registerDataListener (&calibrator);
+        if (ret != CameraStatus::SUCCESS)
+        {
+            LOGE ("Failed to register data listener, CODE %d", (int) ret);
+        }
+    }
+    if (!(registeredStreams & CamListener::DEPTH_IMAGE) && (streams & CamListener::DEPTH_IMAGE))
+    {
+        ret = cameraDevice->registerDepthImageListener (&calibrator);
+        if (ret != CameraStatus::SUCCESS)
+        {
+            LOGE ("Failed to register depth image listener, CODE %d", (int) ret);
+        }
+    }
+    registeredStreams = streams;
+    LOGD("Registered streams: %s%s", (streams & CamListener::DEPTH_DATA) ? "depth data " : "",
+         (streams & CamListener::DEPTH_IMAGE) ? "depth image" : "");
+}
+
+mutex& SessionRegistry::registryMutex()
+{
+    static mutex m;
+    return m;
+}
+
+map<int, shared_ptr<Session>>& SessionRegistry::sessions()
+{
+    static map<int, shared_ptr<Session>> s;
+    return s;
+}
+
+int SessionRegistry::create()
+{
+    static int nextHandle = 1;
+    lock_guard<mutex> lock (registryMutex());
+    int handle = nextHandle++;
+    sessions()[handle] = make_shared<Session>();
+    LOGD("Session %d created, %d session(s) open", handle, (int)sessions().size());
+    return handle;
+}
+
+shared_ptr<Session> SessionRegistry::get(int handle)
+{
+    lock_guard<mutex> lock (registryMutex());
+    auto it = sessions().find(handle);
+    return it == sessions().end() ? nullptr : it->second;
+}
+
+void SessionRegistry::destroy(JNIEnv *env, int handle)
+{
+    shared_ptr<Session> session;
+    {
+        lock_guard<mutex> lock (registryMutex());
+        auto it = sessions().find(handle);
+        if(it == sessions().end()) return;
+        session = move(it->second);
+        sessions().erase(it);
+    }
+    session->release(env);
+    LOGD("Session %d destroyed", handle);
+}
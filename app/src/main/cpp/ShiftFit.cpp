@@ -0,0 +1,94 @@
+#include "ShiftFit.h"
+#include "Util.h"
+
+ShiftFit::Sample ShiftFit::merge(const vector<Sample> &samples)
+{
+    Sample merged = {0, Point2d(0, 0), Point2d(0, 0)};
+    int n = (int)samples.size();
+    if(n == 0) return merged;
+    for(const Sample &s : samples){
+        merged.depth += s.depth;
+        merged.shift += s.shift;
+    }
+    merged.depth /= n;
+    merged.shift *= 1.0 / n;
+    if(n < 2) return merged;
+    for(const Sample &s : samples){
+        Point2d d = s.shift - merged.shift;
+        merged.variance += Point2d(d.x * d.x, d.y * d.y);
+    }
+    merged.variance *= 1.0 / (n - 1);
+    return merged;
+}
+
+Vec4d ShiftFit::fit(const vector<Sample> &samples)
+{
+    vector<double> depth, x_shift, y_shift, x_variance, y_variance;
+    for(const Sample &s : samples){
+        depth.push_back(s.depth);
+        x_shift.push_back(s.shift.x);
+        y_shift.push_back(s.shift.y);
+        x_variance.push_back(s.variance.x);
+        y_variance.push_back(s.variance.y);
+    }
+    auto coeff_x = fitExponential(depth, x_shift, x_variance);
+    auto coeff_y = fitExponential(depth, y_shift, y_variance);
+    return Vec4d(coeff_x.first, coeff_x.second, coeff_y.first, coeff_y.second);
+}
+
+// y = c*e^(a*x)
+// x will be depths, already positive. y takes the sign of most points, the others are left out.
+// Weighted by the inverse variance of ln(y), var(y)/y^2, so the noisy points pull the fit less
+pair<double, double> ShiftFit::fitExponential(const vector<double> &x, const vector<double> &y,
+                                              const vector<double> &variance)
+{
+    int n = (int)x.size(), positive = 0, negative = 0;
+    for(int i = 0; i < n; i++){
+        if(y[i] > 0) positive++;
+        if(y[i] < 0) negative++;
+    }
+    double sign = positive >= negative ? 1 : -1;
+    int used = max(positive, negative);
+    if(used < 2){
+        LOGD("%d points have the same sign of the shift, 2 needed", used);
+        return {0, 0};
+    }
+    if(used < n) LOGD("%d of %d points have the other sign of the shift, they are left out", n - used, n);
+
+    vector<double> lny(n), w(n);
+    for(int i = 0; i < n; i++){
+        if(sign * y[i] <= 0) continue;
+        lny[i] = log(sign * y[i]);
+        w[i] = y[i] * y[i] / variance[i];
+    }
+    double wsum = 0, xsum = 0, x2sum = 0, ysum = 0, xysum = 0;
+    for (int i = 0; i < n; i++){
+        wsum += w[i];                  //calculate sum(wi)
+        xsum += w[i]*x[i];             //calculate sum(wi*xi)
+        ysum += w[i]*lny[i];           //calculate sum(wi*yi)
+        x2sum += w[i]*pow(x[i],2);     //calculate sum(wi*x^2i)
+        xysum += w[i]*(x[i]*lny[i]);   //calculate sum(wi*xi*yi)
+    }
+
+    double a = ( wsum*xysum - xsum*ysum ) / ( wsum*x2sum - xsum*xsum );
+    double b = ( x2sum*ysum - xsum*xysum ) / ( x2sum*wsum - xsum*xsum );
+    double c = sign * exp(b);
+
+    double rss = 0; // residual sum of squares
+    double mean = 0, var = 0;
+    for (int i = 0; i < n; i++){
+        if(w[i] > 0) mean += y[i];
+    }
+    mean /= used;
+    for (int i = 0; i < n; i++){
+        if(w[i] == 0) continue;
+        rss += pow(c*exp(a*x[i]) - y[i], 2);
+        var += pow(mean - y[i], 2);
+    }
+    double r2 = 1 - (rss / var);
+
+    LOGD("Line fitted to %d points. R2 = %.5f", used, r2);
+    LOGD("y = c*e^(a*x)  c = %.5f \t a = %.5f", c, a);
+
+    return {c,a};
+}
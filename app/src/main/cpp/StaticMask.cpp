@@ -0,0 +1,88 @@
+#include "StaticMask.h"
+#include "Util.h"
+
+StaticMask::StaticMask(){}
+
+void StaticMask::reset()
+{
+    state = LEARNING;
+    frames = 0;
+    core.clear();
+    suppressed.clear();
+    LOGD("Static mask: learning");
+}
+
+void StaticMask::update(const vector<uint32_t> &frameMask, int r, int w)
+{
+    if(r != rows || w != rowWords){
+        rows = r;
+        rowWords = w;
+        reset();
+    }
+    int n = rows * rowWords;
+
+    if(state == LEARNING)
+    {
+        if(frames == 0) accumulator.assign(frameMask.begin(), frameMask.begin() + n);
+        else for(int i = 0; i < n; i++) accumulator[i] &= frameMask[i];
+
+        if(++frames < LEARN_FRAMES) return;
+        core = accumulator;
+        grow();
+        state = ACTIVE;
+        LOGD("Static mask: %d pixels learned, %d suppressed", count(core), count(suppressed));
+    }
+    else
+    {
+        for(int i = 0; i < n; i++) accumulator[i] &= ~frameMask[i];
+
+        if(++frames < UPDATE_FRAMES) return;
+        int before = count(core);
+        for(int i = 0; i < n; i++) core[i] &= ~accumulator[i];
+        int removed = before - count(core);
+        if(removed > 0){
+            grow();
+            LOGD("Static mask: %d pixels went dark and are removed, %d left", removed, before - removed);
+        }
+    }
+    frames = 0;
+    accumulator.assign(n, ~0u);
+}
+
+const uint32_t* StaticMask::bits() const
+{
+    return suppressed.empty() ? nullptr : suppressed.data();
+}
+
+// 3x3 dilation of the packed core
+void StaticMask::grow()
+{
+    vector<uint32_t> wide(core.size());
+    for(int y = 0; y < rows; y++)
+    {
+        const uint32_t *in = &core[y * rowWords];
+        uint32_t *out = &wide[y * rowWords];
+        for(int i = 0; i < rowWords; i++)
+        {
+            uint32_t prev = i > 0 ? in[i-1] : 0, next = i + 1 < rowWords ? in[i+1] : 0;
+            out[i] = in[i] | (in[i] << 1) | (prev >> 31) | (in[i] >> 1) | (next << 31);
+        }
+    }
+
+    suppressed.assign(core.size(), 0);
+    for(int y = 0; y < rows; y++){
+        for(int i = 0; i < rowWords; i++){
+            uint32_t w = wide[y * rowWords + i];
+            if(y > 0) w |= wide[(y-1) * rowWords + i];
+            if(y + 1 < rows) w |= wide[(y+1) * rowWords + i];
+            suppressed[y * rowWords + i] = w;
+        }
+    }
+}
+
+int StaticMask::count(const vector<uint32_t> &mask)
+{
+    int n = 0;
+    for(uint32_t w : mask) n += __builtin_popcount(w);
+    return n;
+}
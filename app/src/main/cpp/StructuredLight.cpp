@@ -0,0 +1,245 @@
+#include "StructuredLight.h"
+
+#if defined(__ARM_NEON) || defined(__ARM_NEON__)
+#include <arm_neon.h>
+#endif
+
+// Sets bit x of the row when row[x] > threshold[x]
+static void packRow(const uint16_t *row, const uint16_t *threshold, int cols, uint32_t *bits)
+{
+    fill(bits, bits + (cols + 31) / 32, 0);
+    int x = 0;
+#if defined(__ARM_NEON) || defined(__ARM_NEON__)
+    // compare 8 pixels, narrow the lanes to bytes and fold them to one byte of the plane
+    static const uint8_t weights[8] = {1, 2, 4, 8, 16, 32, 64, 128};
+    uint8x8_t weight = vld1_u8(weights);
+    uint8_t *bytes = (uint8_t*)bits; // little endian, byte b holds the pixels 8b .. 8b+7
+    for(; x + 8 <= cols; x += 8)
+    {
+        uint8x8_t b = vand_u8(vmovn_u16(vcgtq_u16(vld1q_u16(row + x), vld1q_u16(threshold + x))), weight);
+        b = vpadd_u8(b, b);
+        b = vpadd_u8(b, b);
+        b = vpadd_u8(b, b);
+        bytes[x >> 3] = vget_lane_u8(b, 0);
+    }
+#endif
+    for(; x < cols; x++){
+        if(row[x] > threshold[x]) bits[x >> 5] |= 1u << (x & 31);
+    }
+}
+
+static int bitsFor(int codes)
+{
+    int bits = 0;
+    while((1 << bits) < codes) bits++;
+    return bits;
+}
+
+StructuredLight::StructuredLight(){}
+
+void StructuredLight::create(Size projectorSize, Size cameraSize, Point2f footprint)
+{
+    projector = projectorSize;
+    camera = cameraSize;
+    words = (camera.width + 31) / 32;
+    int lengths[2] = {projector.width, projector.height};
+    float sizes[2] = {footprint.x, footprint.y};
+    int first = 2; // after the references
+    for(int i = 0; i < 2; i++)
+    {
+        Axis &a = axes[i];
+        // the sinusoid should be resolved by the camera
+        a.period = 2;
+        while(a.period < MIN_PERIOD * sizes[i]) a.period *= 2;
+        a.bits = bitsFor((lengths[i] + a.period / 2 - 1) / (a.period / 2));
+        a.first = first;
+        first += a.bits + PHASE_STEPS;
+    }
+}
+
+int StructuredLight::patterns() const
+{
+    if(camera.area() == 0) return 0;
+    return 2 + axes[0].bits + axes[1].bits + 2 * PHASE_STEPS;
+}
+
+StructuredLight::Kind StructuredLight::kindOf(int index, int &axis, int &step) const
+{
+    axis = step = 0;
+    if(index == 0) return WHITE;
+    if(index == 1) return BLACK;
+    axis = index < axes[1].first ? 0 : 1;
+    step = index - axes[axis].first;
+    if(step < axes[axis].bits) return GRAY_CODE;
+    step -= axes[axis].bits;
+    return PHASE;
+}
+
+void StructuredLight::render(int index, Mat &pattern) const
+{
+    pattern.create(projector, CV_8UC1);
+    int axis, step;
+    Kind kind = kindOf(index, axis, step);
+    if(kind == WHITE || kind == BLACK){
+        pattern.setTo(Scalar(kind == WHITE ? 255 : 0));
+        return;
+    }
+
+    // intensity along the axis, the other axis repeats it
+    const Axis &a = axes[axis];
+    int length = axis == 0 ? projector.width : projector.height;
+    vector<uint8_t> line(length);
+    for(int p = 0; p < length; p++)
+    {
+        if(kind == GRAY_CODE){
+            int code = p / (a.period / 2);
+            int gray = code ^ (code >> 1);
+            line[p] = (gray >> (a.bits - 1 - step)) & 1 ? 255 : 0;
+        }
+        else{
+            double phase = 2 * CV_PI * p / a.period - step * CV_PI / 2;
+            line[p] = saturate_cast<uint8_t>(127.5 * (1 + cos(phase)));
+        }
+    }
+    for(int y = 0; y < projector.height; y++)
+    {
+        uint8_t *row = pattern.ptr<uint8_t>(y);
+        if(axis == 0) copy(line.begin(), line.end(), row);
+        else fill(row, row + projector.width, line[y]);
+    }
+}
+
+void StructuredLight::start()
+{
+    sum = Mat::zeros(camera, CV_32SC1);
+    frames = 0;
+    for(Axis &a : axes)
+    {
+        a.planes.assign((size_t)a.bits * camera.height * words, 0);
+        a.cosSum = Mat::zeros(camera, CV_32SC1);
+        a.sinSum = Mat::zeros(camera, CV_32SC1);
+    }
+    contrast.assign((size_t)camera.height * words, 0);
+}
+
+void StructuredLight::add(int index, const Mat &gray)
+{
+    if(gray.size() != camera) return;
+    cv::add(sum, gray, sum, noArray(), CV_32S);
+    frames++;
+}
+
+void StructuredLight::endPattern(int index)
+{
+    if(frames == 0) return;
+    Mat mean;
+    sum.convertTo(mean, CV_16U, 1.0 / frames);
+    sum.setTo(Scalar(0));
+    frames = 0;
+
+    int axis, step;
+    Kind kind = kindOf(index, axis, step);
+    Axis &a = axes[axis];
+    if(kind == WHITE){
+        white = mean;
+    }
+    else if(kind == BLACK){
+        black = mean;
+        // middle of the references, white - black >= contrast as bits
+        addWeighted(white, 0.5, black, 0.5, 0, threshold, CV_16U);
+        Mat limit;
+        cv::add(black, Scalar(MIN_CONTRAST), limit, noArray(), CV_16U);
+        for(int y = 0; y < camera.height; y++){
+            packRow(white.ptr<uint16_t>(y), limit.ptr<uint16_t>(y), camera.width, &contrast[(size_t)y * words]);
+        }
+    }
+    else if(kind == GRAY_CODE){
+        uint32_t *plane = &a.planes[(size_t)step * camera.height * words];
+        for(int y = 0; y < camera.height; y++){
+            packRow(mean.ptr<uint16_t>(y), threshold.ptr<uint16_t>(y), camera.width, plane + (size_t)y * words);
+        }
+    }
+    else{
+        // shifts of 0, 90, 180, 270 degrees: I0 - I2 = 2B cos(phase), I1 - I3 = 2B sin(phase)
+        Mat &target = step % 2 == 0 ? a.cosSum : a.sinSum;
+        if(step < 2) cv::add(target, mean, target, noArray(), CV_32S);
+        else subtract(target, mean, target, noArray(), CV_32S);
+    }
+}
+
+int StructuredLight::decode(Mat &coordinates) const
+{
+    coordinates.create(camera, CV_32FC2);
+    coordinates.setTo(Scalar(-1, -1));
+    if(white.empty() || black.empty()) return 0;
+
+    // pixels decoded along x are checked along y
+    vector<uint32_t> valid(contrast);
+    decodeAxis(axes[0], projector.width, 0, valid.data(), coordinates);
+    decodeAxis(axes[1], projector.height, 1, valid.data(), coordinates);
+
+    int decoded = 0;
+    for(int y = 0; y < camera.height; y++){
+        Vec2f *row = coordinates.ptr<Vec2f>(y);
+        for(int x = 0; x < camera.width; x++){
+            if(!((valid[(size_t)y * words + (x >> 5)] >> (x & 31)) & 1)) row[x] = Vec2f(-1, -1);
+            else decoded++;
+        }
+    }
+    return decoded;
+}
+
+// Clears the valid bits of the pixels which cannot be decoded along the axis
+void StructuredLight::decodeAxis(const Axis &a, int length, int channel, uint32_t *valid, Mat &coordinates) const
+{
+    // Gray to binary for 32 pixels at once: b[k] = b[k-1] ^ g[k]
+    size_t planeSize = (size_t)camera.height * words;
+    vector<uint32_t> binary(a.planes.size());
+    for(int k = 0; k < a.bits; k++)
+    {
+        const uint32_t *gray = &a.planes[k * planeSize];
+        uint32_t *b = &binary[k * planeSize];
+        if(k == 0) copy(gray, gray + planeSize, b);
+        else{
+            const uint32_t *previous = b - planeSize;
+            for(size_t i = 0; i < planeSize; i++) b[i] = previous[i] ^ gray[i];
+        }
+    }
+
+    float half = a.period / 2.0f;
+    for(int y = 0; y < camera.height; y++)
+    {
+        const int *c = a.cosSum.ptr<int>(y);
+        const int *s = a.sinSum.ptr<int>(y);
+        const uint16_t *w = white.ptr<uint16_t>(y);
+        const uint16_t *bl = black.ptr<uint16_t>(y);
+        uint32_t *v = valid + (size_t)y * words;
+        Vec2f *out = coordinates.ptr<Vec2f>(y);
+        for(int x = 0; x < camera.width; x++)
+        {
+            uint32_t mask = 1u << (x & 31);
+            if(!(v[x >> 5] & mask)) continue;
+            // amplitude of the sinusoid is sqrt(c^2 + s^2) / 2, the contrast is twice of it at most
+            float modulation = MIN_MODULATION * (w[x] - bl[x]);
+            if((float)c[x] * c[x] + (float)s[x] * s[x] < 4 * modulation * modulation){
+                v[x >> 5] &= ~mask;
+                continue;
+            }
+            int code = 0;
+            for(int k = 0; k < a.bits; k++){
+                code = (code << 1) | ((binary[k * planeSize + (size_t)y * words + (x >> 5)] & mask) ? 1 : 0);
+            }
+            // position in the period from the phase, the period from the center of the half period
+            float phase = atan2f((float)s[x], (float)c[x]);
+            if(phase < 0) phase += 2 * (float)CV_PI;
+            float offset = phase / (2 * (float)CV_PI) * a.period;
+            float period = floorf((code * half + half / 2 - offset) / a.period + 0.5f);
+            float p = period * a.period + offset;
+            if(p < 0 || p >= length){
+                v[x >> 5] &= ~mask;
+                continue;
+            }
+            out[x][channel] = p;
+        }
+    }
+}
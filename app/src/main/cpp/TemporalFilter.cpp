@@ -0,0 +1,80 @@
+#include "TemporalFilter.h"
+
+TemporalFilter::TemporalFilter(){}
+
+void TemporalFilter::create(int width, int height)
+{
+    depthState.create(height, width, CV_16UC1);
+    confidenceState.create(height, width, CV_8UC1);
+    reset();
+}
+
+void TemporalFilter::reset()
+{
+    depthState.setTo(0);
+    confidenceState.setTo(0);
+}
+
+void TemporalFilter::filterRow(int y, Vec3f *xyz, uint8_t *confidence, int width)
+{
+    uint16_t *depth = depthState.ptr<uint16_t>(y);
+    uint8_t *conf = confidenceState.ptr<uint8_t>(y);
+    for(int x = 0; x < width; x++)
+    {
+        int raw = confidence[x];
+        // no depth average yet, e.g. after a reset: the confidence starts from the sample too
+        conf[x] = (uint8_t)(depth[x] == 0 ? raw : conf[x] + step(raw - conf[x]));
+        confidence[x] = conf[x];
+
+        int sample = (int)(xyz[x][2] * SCALE + 0.5f);
+        if(sample <= 0 || sample > 0xFFFF) continue; // no depth, left as it is
+
+        int state = depth[x];
+        if(raw < MIN_CONFIDENCE){
+            if(state == 0) continue; // nothing to hold yet
+        }
+        else if(state == 0 || abs(sample - state) > MOTION){
+            state = sample;
+        }
+        else{
+            state += step(sample - state);
+        }
+        depth[x] = (uint16_t)state;
+
+        // x and y lie on the ray of the pixel, they scale with z
+        float ratio = (float)state / sample;
+        xyz[x][0] *= ratio;
+        xyz[x][1] *= ratio;
+        xyz[x][2] = (float)state / SCALE;
+    }
+}
+
+void TemporalFilter::filterRow(int y, uint16_t *millimeters, uint8_t *confidence, int width)
+{
+    const int unitsPerMm = SCALE / 1000;
+    uint16_t *depth = depthState.ptr<uint16_t>(y);
+    uint8_t *conf = confidenceState.ptr<uint8_t>(y);
+    for(int x = 0; x < width; x++)
+    {
+        int raw = confidence[x];
+        // no depth average yet, e.g. after a reset: the confidence starts from the sample too
+        conf[x] = (uint8_t)(depth[x] == 0 ? raw : conf[x] + step(raw - conf[x]));
+        confidence[x] = conf[x];
+
+        int sample = millimeters[x] * unitsPerMm;
+        if(sample <= 0 || sample > 0xFFFF) continue;
+
+        int state = depth[x];
+        if(raw < MIN_CONFIDENCE){
+            if(state == 0) continue;
+        }
+        else if(state == 0 || abs(sample - state) > MOTION){
+            state = sample;
+        }
+        else{
+            state += step(sample - state);
+        }
+        depth[x] = (uint16_t)state;
+        millimeters[x] = (uint16_t)((state + unitsPerMm / 2) / unitsPerMm);
+    }
+}
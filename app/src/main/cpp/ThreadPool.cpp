@@ -0,0 +1,145 @@
+#include "ThreadPool.h"
+#include "Util.h"
+
+ThreadPool::ThreadPool(int count)
+{
+    if(count <= 0){
+        count = max(1, (int)thread::hardware_concurrency());
+    }
+    for(int i = 0; i < count; i++){
+        queues.push_back(unique_ptr<Queue>(new Queue()));
+    }
+    for(int i = 0; i < count; i++){
+        threads.push_back(thread(&ThreadPool::run, this, i));
+    }
+    LOGD("Thread pool started with %d threads", count);
+}
+
+ThreadPool::~ThreadPool()
+{
+    {
+        lock_guard<mutex> lock (sleepMutex);
+        stopping = true;
+    }
+    sleepCond.notify_all();
+    for(auto &t : threads){
+        t.join();
+    }
+}
+
+ThreadPool& ThreadPool::shared()
+{
+    static ThreadPool pool;
+    return pool;
+}
+
+int ThreadPool::currentIndex() const
+{
+    thread::id self = this_thread::get_id();
+    for(int i = 0; i < (int)threads.size(); i++){
+        if(threads[i].get_id() == self) return i;
+    }
+    return -1;
+}
+
+void ThreadPool::push(function<void()> task)
+{
+    int self = currentIndex();
+    int index = self >= 0 ? self : (int)(nextQueue++ % queues.size());
+    {
+        lock_guard<mutex> lock (queues[index]->queueMutex);
+        queues[index]->tasks.push_back(move(task));
+    }
+    {
+        lock_guard<mutex> lock (sleepMutex); // no worker can miss the wake up
+        queued++;
+    }
+    sleepCond.notify_one();
+}
+
+bool ThreadPool::runOne(int self)
+{
+    function<void()> task;
+    int n = (int)queues.size();
+
+    // own tasks newest first, they are still in cache
+    if(self >= 0){
+        lock_guard<mutex> lock (queues[self]->queueMutex);
+        if(!queues[self]->tasks.empty()){
+            task = move(queues[self]->tasks.back());
+            queues[self]->tasks.pop_back();
+        }
+    }
+    // steal the oldest task of the others
+    for(int k = 1; !task && k <= n; k++)
+    {
+        Queue &victim = *queues[(self + k + n) % n];
+        lock_guard<mutex> lock (victim.queueMutex);
+        if(!victim.tasks.empty()){
+            task = move(victim.tasks.front());
+            victim.tasks.pop_front();
+        }
+    }
+    if(!task) return false;
+
+    queued--;
+    task();
+    return true;
+}
+
+void ThreadPool::run(int index)
+{
+    while(true)
+    {
+        if(runOne(index)) continue;
+
+        unique_lock<mutex> lock (sleepMutex);
+        sleepCond.wait(lock, [this]{ return stopping || queued > 0; });
+        if(stopping && queued == 0) return;
+    }
+}
+
+void ThreadPool::parallelFor(int begin, int end, int grain, const function<void(int, int)> &fn)
+{
+    int count = end - begin;
+    if(count <= 0) return;
+    grain = max(grain, 1);
+
+    if(deterministic || count <= grain || threads.size() <= 1){
+        for(int from = begin; from < end; from += grain){
+            fn(from, min(from + grain, end));
+        }
+        return;
+    }
+
+    // a few chunks per thread, so stealing can balance uneven chunks
+    int chunks = min((count + grain - 1) / grain, (int)threads.size() * 4);
+    int chunkSize = (count + chunks - 1) / chunks;
+    chunks = (count + chunkSize - 1) / chunkSize;
+
+    // the chunks count down under the lock, so the caller cannot return between the last
+    // decrement and its notification
+    struct Completion{
+        mutex doneMutex;
+        condition_variable doneCond;
+        int remaining;
+    } completion;
+    completion.remaining = chunks - 1;
+    for(int c = 1; c < chunks; c++)
+    {
+        int from = begin + c * chunkSize;
+        int to = min(from + chunkSize, end);
+        push([&fn, &completion, from, to]{
+            fn(from, to);
+            lock_guard<mutex> lock (completion.doneMutex);
+            if(--completion.remaining == 0) completion.doneCond.notify_one();
+        });
+    }
+    fn(begin, min(begin + chunkSize, end));
+
+    // help with the queued chunks, then sleep until the running ones are done
+    int self = currentIndex();
+    while(runOne(self)){}
+    unique_lock<mutex> lock (completion.doneMutex);
+    completion.doneCond.wait(lock, [&completion]{ return completion.remaining == 0; });
+}
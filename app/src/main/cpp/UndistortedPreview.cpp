@@ -0,0 +1,72 @@
+#include "UndistortedPreview.h"
+#include "ThreadPool.h"
+#include "Util.h"
+
+static const int RENDER_GRAIN = 16; // rows per task
+static const uint32_t OPAQUE = 0xFF000000u;
+static const uint32_t MAGENTA = 0xFFFF00FFu;
+
+UndistortedPreview::UndistortedPreview(){}
+
+void UndistortedPreview::create(const Mat &cameraMatrix, const Mat &distortion, Size imageSize)
+{
+    size = imageSize;
+    Mat mapX, mapY;
+    initUndistortRectifyMap(cameraMatrix, distortion, Mat(), cameraMatrix, size, CV_32FC1, mapX, mapY);
+
+    taps.resize(size.area());
+    for(int y = 0; y < size.height; y++)
+    {
+        const float *sx = mapX.ptr<float>(y);
+        const float *sy = mapY.ptr<float>(y);
+        Tap *tap = &taps[y * size.width];
+        for(int x = 0; x < size.width; x++)
+        {
+            int x0 = (int)floor(sx[x]), y0 = (int)floor(sy[x]);
+            if(x0 < 0 || y0 < 0 || x0 >= size.width - 1 || y0 >= size.height - 1){
+                tap[x] = {-1, 0, 0};
+                continue;
+            }
+            tap[x].index = y0 * size.width + x0;
+            tap[x].wx = (uint8_t)lround((sx[x] - x0) * WEIGHT_ONE);
+            tap[x].wy = (uint8_t)lround((sy[x] - y0) * WEIGHT_ONE);
+        }
+    }
+    LOGD("Undistorted preview: %dx%d remap table, %.1f KB", size.width, size.height,
+         taps.size() * sizeof(Tap) / 1024.0);
+}
+
+void UndistortedPreview::render(const Mat &gray, const Mat &retro, Mat &argb) const
+{
+    argb.create(size, CV_32SC1);
+    double low, high;
+    minMaxLoc(gray, &low, &high);
+    int minimum = (int)low;
+    int scale = high > low ? (int)((255 << 16) / (high - low)) : 0; // Q16, like NORM_MINMAX to 0-255
+
+    const uint16_t *source = gray.ptr<uint16_t>(0);
+    const uint8_t *retroSource = retro.ptr<uint8_t>(0);
+    int width = size.width;
+    ThreadPool::shared().parallelFor(0, size.height, RENDER_GRAIN, [&](int from, int to)
+    {
+        for(int y = from; y < to; y++)
+        {
+            const Tap *tap = &taps[y * width];
+            uint32_t *out = argb.ptr<uint32_t>(y);
+            for(int x = 0; x < width; x++)
+            {
+                const Tap &t = tap[x];
+                if(t.index < 0){
+                    out[x] = OPAQUE;
+                    continue;
+                }
+                const uint16_t *p = source + t.index;
+                int top = p[0] * (WEIGHT_ONE - t.wx) + p[1] * t.wx;
+                int bottom = p[width] * (WEIGHT_ONE - t.wx) + p[width + 1] * t.wx;
+                int value = (top * (WEIGHT_ONE - t.wy) + bottom * t.wy) >> (2 * WEIGHT_BITS);
+                uint32_t v = (uint32_t)(((value - minimum) * scale) >> 16);
+                out[x] = retroSource[t.index] ? MAGENTA : OPAQUE | v << 16 | v << 8 | v;
+            }
+        }
+    });
+}
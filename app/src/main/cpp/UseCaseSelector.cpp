@@ -0,0 +1,149 @@
+#include "UseCaseSelector.h"
+#include "CamListener.h"
+#include "Util.h"
+#include <chrono>
+
+UseCaseSelector::UseCaseSelector() : cancelled(false), exposureTime(30) {}
+
+UseCaseSelector::~UseCaseSelector()
+{
+    cancel();
+}
+
+void UseCaseSelector::setExposureTime(uint32_t time)
+{
+    exposureTime = time;
+}
+
+void UseCaseSelector::cancel()
+{
+    cancelled = true;
+    if(worker.joinable()){
+        worker.join();
+    }
+    cancelled = false;
+}
+
+void UseCaseSelector::select(ICameraDevice* device, CamListener* listener, int mode)
+{
+    cancel();
+    {
+        lock_guard<mutex> lock (choiceMutex);
+        auto it = choices.find(mode);
+        if(it != choices.end()){
+            apply(device, listener, it->second);
+            return;
+        }
+    }
+    worker = thread(&UseCaseSelector::probe, this, device, listener, mode);
+}
+
+bool UseCaseSelector::waitFor(int ms)
+{
+    for(int waited = 0; waited < ms; waited += 50){
+        if(cancelled) return false;
+        this_thread::sleep_for(chrono::milliseconds(50));
+    }
+    return !cancelled;
+}
+
+bool UseCaseSelector::apply(ICameraDevice* device, CamListener* listener, const Choice &choice)
+{
+    CameraStatus ret = device->setUseCase (choice.useCase);
+    if (ret != CameraStatus::SUCCESS)
+    {
+        LOGE ("Failed to set use case %s, CODE %d", choice.useCase.c_str(), (int) ret);
+        return false;
+    }
+    if (choice.frameRate > 0)
+    {
+        ret = device->setFrameRate (choice.frameRate);
+        if (ret != CameraStatus::SUCCESS)
+        {
+            LOGE ("Failed to set frame rate %d, CODE %d", choice.frameRate, (int) ret);
+        }
+    }
+    // no budget while probing, the scheduler must not shed work of the measured frames
+    uint16_t frameRate = 0;
+    if (choice.frameRate > 0 && device->getFrameRate (frameRate) != CameraStatus::SUCCESS)
+    {
+        frameRate = choice.frameRate;
+    }
+    listener->setFrameRate (frameRate);
+
+    // changing the use case resets the exposure
+    ret = device->setExposureMode (ExposureMode::MANUAL);
+    if (ret != CameraStatus::SUCCESS)
+    {
+        LOGE ("Failed to set exposure mode, CODE %d", (int) ret);
+    }
+    ret = device->setExposureTime (exposureTime);
+    if (ret != CameraStatus::SUCCESS)
+    {
+        LOGE ("Failed to set exposure time, CODE %d", (int) ret);
+    }
+    return true;
+}
+
+uint16_t UseCaseSelector::frameRateFor(uint16_t maxFrameRate, int frames, int64_t meanCost) const
+{
+    double expected = maxFrameRate * PROBE_MS / 1000.0;
+    if(frames < expected * MIN_RECEIVED_RATIO || meanCost <= 0) return 0;
+
+    // highest frame rate whose period leaves room for the measured cost
+    int sustainable = (int)(1e6 * BUDGET_RATIO / meanCost);
+    return (uint16_t)max(1, min((int)maxFrameRate, sustainable));
+}
+
+void UseCaseSelector::probe(ICameraDevice* device, CamListener* listener, int mode)
+{
+    royale::Vector<royale::String> useCases;
+    if (device->getUseCases (useCases) != CameraStatus::SUCCESS || useCases.empty())
+    {
+        LOGE ("Failed to get use cases for probing");
+        return;
+    }
+
+    Choice best = {useCases[0], 0};
+    for (int i = 0; i < (int)useCases.size(); i++)
+    {
+        Choice candidate = {useCases[i], 0};
+        uint16_t maxFrameRate;
+        if (!apply(device, listener, candidate) ||
+            device->getMaxFrameRate (maxFrameRate) != CameraStatus::SUCCESS || maxFrameRate == 0)
+        {
+            continue; // e.g. mixed mode use cases do not support frame rate
+        }
+        candidate.frameRate = maxFrameRate;
+        device->setFrameRate (maxFrameRate);
+
+        if(!waitFor(SETTLE_MS)) return;
+        listener->takeFrameStats();
+        if(!waitFor(PROBE_MS)) return;
+        CamListener::FrameStats stats = listener->takeFrameStats();
+
+        candidate.frameRate = frameRateFor(maxFrameRate, stats.frames, stats.meanCost);
+        if(candidate.frameRate == 0)
+        {
+            LOGD("Use case %s: %d of %.0f frames received, skipped", useCases[i].c_str(), stats.frames,
+                 maxFrameRate * PROBE_MS / 1000.0);
+            continue;
+        }
+        LOGD("Use case %s: max %d fps, cost mean %.2f ms max %.2f ms -> %d fps", useCases[i].c_str(),
+             maxFrameRate, stats.meanCost / 1000.0, stats.maxCost / 1000.0, candidate.frameRate);
+
+        if(candidate.frameRate > best.frameRate){
+            best = candidate;
+        }
+    }
+
+    if(cancelled || !apply(device, listener, best)) return;
+    if(best.frameRate == 0){
+        LOGE("No use case could be measured, using %s", best.useCase.c_str());
+        return;
+    }
+
+    lock_guard<mutex> lock (choiceMutex);
+    choices[mode] = best;
+    LOGI("Selected use case for mode %d: %s at %d fps", mode, best.useCase.c_str(), best.frameRate);
+}
@@ -1,4 +1,3 @@
-#include <royale/CameraManager.hpp>
 #include <royale/ICameraDevice.hpp>
 #include <iostream>
 #include <jni.h>
@@ -7,7 +6,7 @@
 #include <mutex>
 #include "opencv2/opencv.hpp"
 #include <util.h>
-#include <Calibrator.h>
+#include <Session.h>
 
 #ifdef __cplusplus
 extern "C"
@@ -18,131 +17,35 @@ using namespace royale;
 using namespace std;
 using namespace cv;
 
-// this represents the main camera device object
-static std::unique_ptr<ICameraDevice> cameraDevice;
-Calibrator calibrator; // It is a child of IDepthDataListener
-double* calibration = nullptr;
-
-jintArray Java_com_esalman17_calibrator_MainActivity_OpenCameraNative (JNIEnv *env, jobject thiz, jint fd, jint vid, jint pid)
+// Every call from java carries the handle of the camera / projector session it belongs to
+static shared_ptr<Session> getSession(jint handle)
 {
-    LOGD("OpenCameraNative()");
-    // the camera manager will query for a connected camera
-    {
-        CameraManager manager;
-        auto camlist = manager.getConnectedCameraList (fd, vid, pid);
-        LOGI ("Detected %zu camera(s).", camlist.size());
-
-        if (!camlist.empty())
-        {
-            cameraDevice = manager.createCamera (camlist.at (0));
-        }
-    }
-    // the camera device is now available and CameraManager can be deallocated here
-
-    if (cameraDevice == nullptr)
-    {
-        LOGE ("Cannot create the camera device");
-    }
-
-    // IMPORTANT: call the initialize method before working with the camera device
-    CameraStatus ret = cameraDevice->initialize();
-    if (ret != CameraStatus::SUCCESS)
+    shared_ptr<Session> session = SessionRegistry::get(handle);
+    if (session == nullptr)
     {
-        LOGE ("Cannot initialize the camera device, CODE %d", (int) ret);
-    }
-
-    royale::Vector<royale::String> opModes;
-    royale::String cameraName;
-    royale::String cameraId;
-
-    ret = cameraDevice->getUseCases (opModes);
-    if (ret != CameraStatus::SUCCESS)
-    {
-        LOGE ("Failed to get use cases, CODE %d", (int) ret);
-    }
-
-    uint16_t cam_width, cam_height;
-    ret = cameraDevice->getMaxSensorWidth (cam_width);
-    if (ret != CameraStatus::SUCCESS)
-    {
-        LOGE ("Failed to get max sensor width, CODE %d", (int) ret);
-    }
-
-    ret = cameraDevice->getMaxSensorHeight (cam_height);
-    if (ret != CameraStatus::SUCCESS)
-    {
-        LOGE ("Failed to get max sensor height, CODE %d", (int) ret);
-    }
-
-    ret = cameraDevice->getId (cameraId);
-    if (ret != CameraStatus::SUCCESS)
-    {
-        LOGE ("Failed to get camera ID, CODE %d", (int) ret);
-    }
-
-    ret = cameraDevice->getCameraName (cameraName);
-    if (ret != CameraStatus::SUCCESS)
-    {
-        LOGE ("Failed to get camera name, CODE %d", (int) ret);
-    }
-
-    // display some information about the connected camera
-    LOGI ("====================================");
-    LOGI ("        Camera information");
-    LOGI ("====================================");
-    LOGI ("Id:              %s", cameraId.c_str());
-    LOGI ("Type:            %s", cameraName.c_str());
-    LOGI ("Width:           %d", cam_width);
-    LOGI ("Height:          %d", cam_height);
-    LOGI ("Operation modes: %zu", opModes.size());
-
-    for (int i = 0; i < opModes.size(); i++)
-    {
-        LOGI ("    %s", opModes.at (i).c_str());
-    }
-
-    // Set camera and projector values for calibration
-    calibrator.setCamera(cam_width, cam_height, 62, 45);
-    calibrator.setProjector(1280, 720, 46.4, 24.2);    // TODO make it generic
-    if(calibration){
-        calibrator.setCalibration(calibration);
-    }
-
-    LensParameters lensParams;
-    ret = cameraDevice->getLensParameters (lensParams);
-    if (ret != CameraStatus::SUCCESS)
-    {
-        LOGE ("Failed to get lens parameters, CODE %d", (int) ret);
-    }else{
-        calibrator.setLensParameters (lensParams);
-    }
-
-    // register a data listener
-    ret = cameraDevice->registerDataListener (&calibrator);
-    if (ret != CameraStatus::SUCCESS)
-    {
-        LOGE ("Failed to register data listener, CODE %d", (int) ret);
+        LOGE ("There is no session with handle %d", handle);
     }
+    return session;
+}
 
-    // set an operation mode
-    ret = cameraDevice->setUseCase (opModes[0]);
-    if (ret != CameraStatus::SUCCESS)
-    {
-        LOGE ("Failed to set use case, CODE %d", (int) ret);
-    }
+jint Java_com_esalman17_calibrator_MainActivity_CreateSessionNative (JNIEnv *env, jobject thiz)
+{
+    return SessionRegistry::create();
+}
 
-    //set exposure mode to manual
-    ret = cameraDevice->setExposureMode (ExposureMode::MANUAL);
-    if (ret != CameraStatus::SUCCESS)
-    {
-        LOGE ("Failed to set exposure mode, CODE %d", (int) ret);
-    }
+void Java_com_esalman17_calibrator_MainActivity_DestroySessionNative (JNIEnv *env, jobject thiz, jint handle)
+{
+    SessionRegistry::destroy(env, handle);
+}
 
-    //set exposure time (not working above 300)
-    ret = cameraDevice->setExposureTime(30);
-    if (ret != CameraStatus::SUCCESS)
+jintArray Java_com_esalman17_calibrator_MainActivity_OpenCameraNative (JNIEnv *env, jobject thiz, jint handle, jint fd, jint vid, jint pid)
+{
+    LOGD("OpenCameraNative(%d)", handle);
+    uint16_t cam_width = 0, cam_height = 0;
+    shared_ptr<Session> session = getSession(handle);
+    if (session != nullptr && !session->open(fd, vid, pid, cam_width, cam_height))
     {
-        LOGE ("Failed to set exposure time, CODE %d", (int) ret);
+        cam_width = cam_height = 0;
     }
 
     jint fill[2];
@@ -155,78 +58,50 @@ jintArray Java_com_esalman17_calibrator_MainActivity_OpenCameraNative (JNIEnv *e
     return intArray;
 }
 
-void Java_com_esalman17_calibrator_MainActivity_RegisterCallback (JNIEnv *env, jobject thiz)
+void Java_com_esalman17_calibrator_MainActivity_RegisterCallback (JNIEnv *env, jobject thiz, jint handle)
 {
-    LOGD("RegisterCallback()");
-    // save JavaVM globally; needed later to call Java method in the listener
-    JavaVM* m_vm;
-    env->GetJavaVM (&m_vm);
-
-    jobject m_obj = env->NewGlobalRef (thiz);
-
-    // save refs for callback
-    jclass g_class = env->GetObjectClass (m_obj);
-    if (g_class == NULL)
-    {
-        std::cout << "Failed to find class" << std::endl;
-    }
-
-    // save method ID to call the method later in the listener
-    jmethodID m_amplitudeCallbackID = env->GetMethodID (g_class, "amplitudeCallback", "([I)V");
-    jmethodID m_blobsCallbackID = env->GetMethodID (g_class, "blobsCallback", "([I)V");
-
-    calibrator.callbackManager = CallbackManager(m_vm, m_obj, m_amplitudeCallbackID, m_blobsCallbackID);
+    LOGD("RegisterCallback(%d)", handle);
+    shared_ptr<Session> session = getSession(handle);
+    if (session == nullptr) return;
+    session->registerCallback(env, thiz);
 }
 
-jboolean Java_com_esalman17_calibrator_MainActivity_StartCaptureNative (JNIEnv *env, jobject thiz)
+jboolean Java_com_esalman17_calibrator_MainActivity_StartCaptureNative (JNIEnv *env, jobject thiz, jint handle)
 {
-    LOGD("StartCaptureNative()");
-    if (cameraDevice == nullptr)
-    {
-        LOGE("There is no camera device to  start");
-        return (jboolean)false;
-    }
-    auto ret = cameraDevice->startCapture();
-    if (ret != CameraStatus::SUCCESS)
-    {
-        LOGE("Failed to start capture, CODE %d", (int) ret);
-        return (jboolean)false;
-    }
-    LOGI("Capture started.");
-    return (jboolean)true;
+    LOGD("StartCaptureNative(%d)", handle);
+    shared_ptr<Session> session = getSession(handle);
+    return (jboolean)(session != nullptr && session->startCapture());
 }
 
-jboolean Java_com_esalman17_calibrator_MainActivity_StopCaptureNative (JNIEnv *env, jobject thiz)
+jboolean Java_com_esalman17_calibrator_MainActivity_StopCaptureNative (JNIEnv *env, jobject thiz, jint handle)
 {
-    LOGD("StopCaptureNative()");
-    if (cameraDevice == nullptr)
-    {
-        LOGE ("There is no camera device to  stop");
-        return (jboolean)false;
-    }
-    auto ret = cameraDevice->stopCapture();
-    if (ret != CameraStatus::SUCCESS)
-    {
-        LOGE ("Failed to stop capture, CODE %d", (int) ret);
-        return (jboolean)false;
-    }
-    LOGI("Capture stopped.");
-    return (jboolean)true;
+    LOGD("StopCaptureNative(%d)", handle);
+    shared_ptr<Session> session = getSession(handle);
+    return (jboolean)(session != nullptr && session->stopCapture());
 }
 
-void Java_com_esalman17_calibrator_MainActivity_ChangeModeNative (JNIEnv *env, jobject thiz, jint mode)
+void Java_com_esalman17_calibrator_MainActivity_ChangeModeNative (JNIEnv *env, jobject thiz, jint handle, jint mode)
 {
-    calibrator.setMode(mode); // TODO chcek the setmode method, java and cpp side can be different
+    shared_ptr<Session> session = getSession(handle);
+    if (session == nullptr) return;
+    session->changeMode(mode);
 }
-jboolean Java_com_esalman17_calibrator_MainActivity_AddPointNative (JNIEnv *env, jobject thiz)
+
+jboolean Java_com_esalman17_calibrator_MainActivity_AddPointNative (JNIEnv *env, jobject thiz, jint handle)
 {
-    return (jboolean)calibrator.saveCamPoint();
+    shared_ptr<Session> session = getSession(handle);
+    return (jboolean)(session != nullptr && session->calibrator.saveCamPoint());
 }
 
-jdoubleArray Java_com_esalman17_calibrator_MainActivity_CalibrateNative (JNIEnv *env, jobject thiz)
+jdoubleArray Java_com_esalman17_calibrator_MainActivity_CalibrateNative (JNIEnv *env, jobject thiz, jint handle)
 {
-    calibrator.calibrate();
-    Vec4d calib = calibrator.getCalibration();
+    Vec4d calib;
+    shared_ptr<Session> session = getSession(handle);
+    if (session != nullptr)
+    {
+        session->calibrator.calibrate();
+        calib = session->calibrator.getCalibration();
+    }
 
     jdouble fill[4];
     fill[0] = calib[0];
@@ -240,15 +115,104 @@ jdoubleArray Java_com_esalman17_calibrator_MainActivity_CalibrateNative (JNIEnv
     return doubleArray;
 }
 
-void Java_com_esalman17_calibrator_MainActivity_ToggleFlipNative (JNIEnv *env, jobject thiz)
+void Java_com_esalman17_calibrator_MainActivity_ToggleFlipNative (JNIEnv *env, jobject thiz, jint handle)
+{
+    shared_ptr<Session> session = getSession(handle);
+    if (session == nullptr) return;
+    session->calibrator.toggleFlip();
+}
+
+void Java_com_esalman17_calibrator_MainActivity_LoadCalibrationNative (JNIEnv *env, jobject thiz, jint handle, jdoubleArray arr)
+{
+    shared_ptr<Session> session = getSession(handle);
+    if (session == nullptr) return;
+    jdouble* calibration = env->GetDoubleArrayElements( arr,0);
+    session->loadCalibration(calibration);
+    env->ReleaseDoubleArrayElements(arr, calibration, JNI_ABORT);
+}
+
+void Java_com_esalman17_calibrator_MainActivity_SetOverlayBitmapsNative (JNIEnv *env, jobject thiz, jint handle, jobject first, jobject second)
+{
+    shared_ptr<Session> session = getSession(handle);
+    if (session == nullptr) return;
+    session->calibrator.setOverlayBitmaps(env, first, second);
+}
+
+void Java_com_esalman17_calibrator_MainActivity_SetOutputCadenceNative (JNIEnv *env, jobject thiz, jint handle, jint hz)
+{
+    shared_ptr<Session> session = getSession(handle);
+    if (session == nullptr) return;
+    session->calibrator.setOutputCadence(hz);
+}
+
+jint Java_com_esalman17_calibrator_MainActivity_VsyncNative (JNIEnv *env, jobject thiz, jint handle)
+{
+    shared_ptr<Session> session = getSession(handle);
+    if (session == nullptr) return -1;
+    return session->calibrator.onVsync(env);
+}
+
+void Java_com_esalman17_calibrator_MainActivity_SetPredictionNative (JNIEnv *env, jobject thiz, jint handle, jboolean enabled)
+{
+    shared_ptr<Session> session = getSession(handle);
+    if (session == nullptr) return;
+    session->calibrator.setPrediction(enabled);
+}
+
+void Java_com_esalman17_calibrator_MainActivity_SetPyramidNative (JNIEnv *env, jobject thiz, jint handle, jboolean enabled)
+{
+    shared_ptr<Session> session = getSession(handle);
+    if (session == nullptr) return;
+    session->calibrator.setPyramid(enabled);
+}
+
+void Java_com_esalman17_calibrator_MainActivity_LearnBackgroundNative (JNIEnv *env, jobject thiz, jint handle)
+{
+    shared_ptr<Session> session = getSession(handle);
+    if (session == nullptr) return;
+    session->calibrator.learnBackground();
+}
+
+void Java_com_esalman17_calibrator_MainActivity_SetTemporalFilterNative (JNIEnv *env, jobject thiz, jint handle, jboolean enabled)
+{
+    shared_ptr<Session> session = getSession(handle);
+    if (session == nullptr) return;
+    session->calibrator.setTemporalFilter(enabled);
+}
+
+void Java_com_esalman17_calibrator_MainActivity_SetCompactFramesNative (JNIEnv *env, jobject thiz, jint handle, jboolean enabled)
+{
+    shared_ptr<Session> session = getSession(handle);
+    if (session == nullptr) return;
+    session->calibrator.setCompactFrames(enabled);
+}
+
+void Java_com_esalman17_calibrator_MainActivity_SetUndistortedPreviewNative (JNIEnv *env, jobject thiz, jint handle, jboolean enabled)
+{
+    shared_ptr<Session> session = getSession(handle);
+    if (session == nullptr) return;
+    session->calibrator.setUndistortedPreview(enabled);
+}
+
+void Java_com_esalman17_calibrator_MainActivity_SetAutoCaptureNative (JNIEnv *env, jobject thiz, jint handle, jboolean enabled)
+{
+    shared_ptr<Session> session = getSession(handle);
+    if (session == nullptr) return;
+    session->calibrator.setAutoCapture(enabled);
+}
+
+void Java_com_esalman17_calibrator_MainActivity_SetConstellationNative (JNIEnv *env, jobject thiz, jint handle, jboolean enabled)
 {
-    calibrator.toggleFlip();
+    shared_ptr<Session> session = getSession(handle);
+    if (session == nullptr) return;
+    session->calibrator.setConstellation(enabled);
 }
 
-void Java_com_esalman17_calibrator_MainActivity_LoadCalibrationNative (JNIEnv *env, jobject thiz, jdoubleArray arr)
+void Java_com_esalman17_calibrator_MainActivity_FrameShownNative (JNIEnv *env, jobject thiz, jint handle, jlong captureTime)
 {
-    calibration = env->GetDoubleArrayElements( arr,0);
-    calibrator.setCalibration(calibration);
+    shared_ptr<Session> session = getSession(handle);
+    if (session == nullptr) return;
+    session->calibrator.onFrameShown(captureTime);
 }
 
 #ifdef __cplusplus
@@ -8,10 +8,6 @@ import android.content.Context;
 import android.content.Intent;
 import android.content.IntentFilter;
 import android.content.pm.ActivityInfo;
-import android.graphics.Canvas;
-import android.graphics.Color;
-import android.graphics.Paint;
-import android.graphics.drawable.Drawable;
 import android.hardware.usb.UsbDevice;
 import android.hardware.usb.UsbDeviceConnection;
 import android.hardware.usb.UsbManager;
@@ -20,6 +16,7 @@ import android.net.Uri;
 import android.os.Bundle;
 import android.os.Environment;
 import android.util.Log;
+import android.view.Choreographer;
 import android.view.MotionEvent;
 import android.view.View;
 import android.widget.Button;
@@ -47,6 +44,7 @@ enum Mode{
     GRAY,
     CALIBRATION,
     TEST,
+    SCAN,
 }
 
 public class MainActivity extends Activity {
@@ -61,9 +59,8 @@ public class MainActivity extends Activity {
     private UsbManager manager;
     private UsbDeviceConnection usbConnection;
 
-    private Bitmap bmpCam = null, bmpPr = null;
-    private Drawable pattern;
-    private static Paint white = new Paint();
+    private Bitmap bmpCam = null;
+    private Bitmap[] bmpPr = new Bitmap[2]; // overlay buffers rendered on native side
 
     private ImageView mainImView;
     Button buttonAdd, buttonCalc;
@@ -76,23 +73,46 @@ public class MainActivity extends Activity {
     private static final String LOG_TAG = "MainActivity";
     private static final String ACTION_USB_PERMISSION = "ACTION_ROYALE_USB_PERMISSION";
 
+    int session; // handle of the native camera / projector session
     int[] resolution;
     Point displaySize, camRes;
     boolean camFlip = true;
+    boolean prediction = false;
+    boolean pyramid = false;
+    boolean smoothing = false;
+    boolean compactFrames = false;
+    boolean undistortedPreview = false;
+    boolean autoCapture = false;
+    boolean constellation = false;
+    boolean vsyncRunning = false;
 
     Mode currentMode = Mode.GRAY;
 
     private static final int PICKFILE_REQUEST_CODE = 1;
 
-    public native int[] OpenCameraNative(int fd, int vid, int pid);
-    public native boolean StartCaptureNative();
-    public native boolean StopCaptureNative();
-    public native void RegisterCallback();
-    public native void ChangeModeNative(int mode);
-    public native boolean AddPointNative();
-    public native double[] CalibrateNative();
-    public native void ToggleFlipNative();
-    public native void LoadCalibrationNative(double[] calibration);
+    public native int CreateSessionNative();
+    public native void DestroySessionNative(int session);
+    public native int[] OpenCameraNative(int session, int fd, int vid, int pid);
+    public native boolean StartCaptureNative(int session);
+    public native boolean StopCaptureNative(int session);
+    public native void RegisterCallback(int session);
+    public native void ChangeModeNative(int session, int mode);
+    public native boolean AddPointNative(int session);
+    public native double[] CalibrateNative(int session);
+    public native void ToggleFlipNative(int session);
+    public native void LoadCalibrationNative(int session, double[] calibration);
+    public native void SetOverlayBitmapsNative(int session, Bitmap first, Bitmap second);
+    public native void SetOutputCadenceNative(int session, int hz);
+    public native int VsyncNative(int session);
+    public native void SetPredictionNative(int session, boolean enabled);
+    public native void SetPyramidNative(int session, boolean enabled);
+    public native void LearnBackgroundNative(int session);
+    public native void SetTemporalFilterNative(int session, boolean enabled);
+    public native void SetCompactFramesNative(int session, boolean enabled);
+    public native void SetUndistortedPreviewNative(int session, boolean enabled);
+    public native void SetAutoCaptureNative(int session, boolean enabled);
+    public native void SetConstellationNative(int session, boolean enabled);
+    public native void FrameShownNative(int session, long captureTime);
 
     //broadcast receiver for user usb permission dialog
     private final BroadcastReceiver mUsbReceiver = new BroadcastReceiver() {
@@ -104,8 +124,9 @@ public class MainActivity extends Activity {
 
                 if (intent.getBooleanExtra(UsbManager.EXTRA_PERMISSION_GRANTED, false)) {
                     if (device != null) {
-                        RegisterCallback();
+                        RegisterCallback(session);
                         performUsbPermissionCallback(device);
+                        createOverlay();
                         if (bmpCam == null) {
                             bmpCam = Bitmap.createBitmap(resolution[0], resolution[1], Bitmap.Config.ARGB_8888);
                         }
@@ -122,6 +143,7 @@ public class MainActivity extends Activity {
     public void onCreate(Bundle savedInstanceState) {
         Log.d(LOG_TAG, "onCreate()");
         super.onCreate(savedInstanceState);
+        session = CreateSessionNative();
         setRequestedOrientation (ActivityInfo.SCREEN_ORIENTATION_LANDSCAPE);
         getWindow().setBackgroundDrawableResource(R.color.black);
         setContentView(R.layout.activity_main);
@@ -147,11 +169,6 @@ public class MainActivity extends Activity {
             }
         });
 
-        white.setColor(Color.WHITE);
-        white.setStyle(Paint.Style.STROKE);
-        white.setStrokeWidth(5);
-
-        pattern = getResources().getDrawable(R.drawable.pattern);
         mainImView = findViewById(R.id.imageViewMain);
         tvDebug = findViewById(R.id.textViewDebug);
 
@@ -165,7 +182,7 @@ public class MainActivity extends Activity {
                 if(!capturing){
                     startCapture();
                 }
-                ChangeModeNative(1);
+                ChangeModeNative(session, 1);
                 currentMode = Mode.DEPTH;
                 buttonCalc.setVisibility(View.GONE);
                 buttonAdd.setVisibility(View.GONE);
@@ -182,7 +199,7 @@ public class MainActivity extends Activity {
                 if(!capturing){
                     startCapture();
                 }
-                ChangeModeNative(2);
+                ChangeModeNative(session, 2);
                 currentMode = Mode.GRAY;
                 buttonCalc.setVisibility(View.GONE);
                 buttonAdd.setVisibility(View.GONE);
@@ -199,10 +216,9 @@ public class MainActivity extends Activity {
                 if(!capturing){
                     startCapture();
                 }
-                ChangeModeNative(3);
+                ChangeModeNative(session, 3);
                 currentMode = Mode.CALIBRATION;
-
-                mainImView.setImageDrawable(pattern);
+                startVsync();
 
                 buttonAdd.setVisibility(View.VISIBLE);
                 buttonCalc.setVisibility(View.VISIBLE);
@@ -219,8 +235,9 @@ public class MainActivity extends Activity {
                 if(!capturing){
                     startCapture();
                 }
-                ChangeModeNative(4);
+                ChangeModeNative(session, 4);
                 currentMode = Mode.TEST;
+                startVsync();
                 Log.i(LOG_TAG, "Mode changed: TEST");
                 buttonCalc.setVisibility(View.GONE);
                 buttonAdd.setVisibility(View.GONE);
@@ -230,11 +247,101 @@ public class MainActivity extends Activity {
         findViewById(R.id.buttonFlip).setOnClickListener(new View.OnClickListener() {
             @Override
             public void onClick(View view) {
-                ToggleFlipNative();
+                ToggleFlipNative(session);
                 camFlip = !camFlip;
             }
         });
 
+        findViewById(R.id.buttonPredict).setOnClickListener(new View.OnClickListener() {
+            @Override
+            public void onClick(View view) {
+                prediction = !prediction;
+                SetPredictionNative(session, prediction);
+                tvDebug.setText("Prediction: " + (prediction ? "ON" : "OFF"));
+            }
+        });
+
+        findViewById(R.id.buttonPyramid).setOnClickListener(new View.OnClickListener() {
+            @Override
+            public void onClick(View view) {
+                pyramid = !pyramid;
+                SetPyramidNative(session, pyramid);
+                tvDebug.setText("Pyramid detection: " + (pyramid ? "ON" : "OFF"));
+            }
+        });
+
+        findViewById(R.id.buttonBackground).setOnClickListener(new View.OnClickListener() {
+            @Override
+            public void onClick(View view) {
+                LearnBackgroundNative(session);
+                tvDebug.setText("Learning static reflections");
+            }
+        });
+
+        findViewById(R.id.buttonSmooth).setOnClickListener(new View.OnClickListener() {
+            @Override
+            public void onClick(View view) {
+                smoothing = !smoothing;
+                SetTemporalFilterNative(session, smoothing);
+                tvDebug.setText("Depth smoothing: " + (smoothing ? "ON" : "OFF"));
+            }
+        });
+
+        findViewById(R.id.buttonCompact).setOnClickListener(new View.OnClickListener() {
+            @Override
+            public void onClick(View view) {
+                compactFrames = !compactFrames;
+                SetCompactFramesNative(session, compactFrames);
+                tvDebug.setText("Compact frames: " + (compactFrames ? "ON" : "OFF"));
+            }
+        });
+
+        findViewById(R.id.buttonUndistort).setOnClickListener(new View.OnClickListener() {
+            @Override
+            public void onClick(View view) {
+                undistortedPreview = !undistortedPreview;
+                SetUndistortedPreviewNative(session, undistortedPreview);
+                tvDebug.setText("Undistorted preview: " + (undistortedPreview ? "ON" : "OFF"));
+            }
+        });
+
+        findViewById(R.id.buttonAuto).setOnClickListener(new View.OnClickListener() {
+            @Override
+            public void onClick(View view) {
+                autoCapture = !autoCapture;
+                SetAutoCaptureNative(session, autoCapture);
+                tvDebug.setText("Auto capture: " + (autoCapture ? "ON" : "OFF"));
+            }
+        });
+
+        findViewById(R.id.buttonBoard).setOnClickListener(new View.OnClickListener() {
+            @Override
+            public void onClick(View view) {
+                constellation = !constellation;
+                SetConstellationNative(session, constellation);
+                tvDebug.setText("Marker board: " + (constellation ? "ON" : "OFF"));
+            }
+        });
+
+        findViewById(R.id.buttonScan).setOnClickListener(new View.OnClickListener() {
+            @Override
+            public void onClick(View view) {
+                if(!cam_opened) {
+                    openCamera();
+                }
+                if(!capturing){
+                    startCapture();
+                }
+                ChangeModeNative(session, 5);
+                currentMode = Mode.SCAN;
+                startVsync();
+
+                buttonAdd.setVisibility(View.GONE);
+                buttonCalc.setVisibility(View.VISIBLE);
+                tvDebug.setText("Mode: SCAN");
+            }
+        });
+
         findViewById(R.id.buttonLoad).setOnClickListener(new View.OnClickListener() {
             @Override
             public void onClick(View view) {
@@ -250,9 +357,9 @@ public class MainActivity extends Activity {
         buttonAdd.setOnClickListener(new View.OnClickListener() {
             @Override
             public void onClick(View view) {
-                boolean res = AddPointNative();
+                boolean res = AddPointNative(session);
                 if(res){
-                    Toast.makeText(getApplicationContext(), "Point is added", Toast.LENGTH_SHORT).show();
+                    Toast.makeText(getApplicationContext(), "Point is averaged over the next frames", Toast.LENGTH_SHORT).show();
                 }
                 else{
                     Toast.makeText(getApplicationContext(), "Point cannot be added", Toast.LENGTH_SHORT).show();
@@ -264,7 +371,7 @@ public class MainActivity extends Activity {
         buttonCalc.setOnClickListener(new View.OnClickListener() {
             @Override
             public void onClick(View view) {
-                double[] calibration = CalibrateNative();
+                double[] calibration = CalibrateNative(session);
                 saveCalibrationResult(calibration);
             }
         });
@@ -285,13 +392,15 @@ public class MainActivity extends Activity {
         if(cam_opened && !capturing){
             startCapture();
         }
+        startVsync();
     }
 
     @Override
     protected void onPause() {
         Log.d(LOG_TAG, "onPause()");
+        stopVsync();
         if (cam_opened) {
-            if(StopCaptureNative()){
+            if(StopCaptureNative(session)){
                 capturing = false;
                 Log.d(LOG_TAG, "Capture has stopped");
             }
@@ -304,6 +413,8 @@ public class MainActivity extends Activity {
     protected void onDestroy() {
         Log.d(LOG_TAG, "onDestroy()");
 
+        stopVsync(); // the callback must not reach a destroyed session
+        DestroySessionNative(session);
         if(usbConnection != null) {
             usbConnection.close();
         }
@@ -330,7 +441,7 @@ public class MainActivity extends Activity {
                             if(i == 4) break;
                         }
                         Log.d(LOG_TAG, "Calibration array = "+ Arrays.toString(calibration));
-                        LoadCalibrationNative(calibration);
+                        LoadCalibrationNative(session, calibration);
                     } catch (FileNotFoundException e) {
                         e.printStackTrace();
                     } catch (IOException e) {
@@ -371,8 +482,9 @@ public class MainActivity extends Activity {
                     mUsbPi = PendingIntent.getBroadcast(this, 0, intent, 0);
                     manager.requestPermission(device, mUsbPi);
                 } else {
-                    RegisterCallback();
+                    RegisterCallback(session);
                     performUsbPermissionCallback(device);
+                    createOverlay();
                     if (bmpCam == null) {
                         bmpCam = Bitmap.createBitmap(resolution[0], resolution[1], Bitmap.Config.ARGB_8888);
                     }
@@ -392,7 +504,7 @@ public class MainActivity extends Activity {
 
         int fd = usbConnection.getFileDescriptor();
 
-        resolution = OpenCameraNative(fd, device.getVendorId(), device.getProductId());
+        resolution = OpenCameraNative(session, fd, device.getVendorId(), device.getProductId());
         Log.d(LOG_TAG, "Camera resolution: width="+resolution[0]+" height="+resolution[1]);
         camRes = new Point(resolution[0], resolution[1]);
 
@@ -403,7 +515,7 @@ public class MainActivity extends Activity {
 
     public void startCapture() {
         if(cam_opened ){
-            if(StartCaptureNative()){
+            if(StartCaptureNative(session)){
                 capturing = true;
                 Log.d(LOG_TAG, "Camera is capturing");
             }
@@ -414,7 +526,7 @@ public class MainActivity extends Activity {
     }
 
     public void amplitudeCallback(int[] amplitudes) {
-        if(currentMode == Mode.CALIBRATION || currentMode == Mode.TEST){
+        if(currentMode == Mode.CALIBRATION || currentMode == Mode.TEST || currentMode == Mode.SCAN){
             // This callback should not be called in this modes
             return;
         }
@@ -436,37 +548,97 @@ public class MainActivity extends Activity {
         });
     }
 
-    public void blobsCallback(final int[] descriptors) {
-        if(currentMode != Mode.TEST){
-            // This callback only be called in test mode
-            return;
+    private void createOverlay() {
+        if (bmpPr[0] == null) {
+            bmpPr[0] = Bitmap.createBitmap(displaySize.x, displaySize.y, Bitmap.Config.ARGB_8888);
+            bmpPr[1] = Bitmap.createBitmap(displaySize.x, displaySize.y, Bitmap.Config.ARGB_8888);
         }
-        if (!cam_opened)
-        {
-            Log.d(LOG_TAG, "Device in Java not initialized");
+        SetOverlayBitmapsNative(session, bmpPr[0], bmpPr[1]);
+    }
+
+    // Overlay is pulled from native side once per display frame, so results faster than the display are coalesced
+    private final Choreographer.FrameCallback vsyncCallback = new Choreographer.FrameCallback() {
+        @Override
+        public void doFrame(long frameTimeNanos) {
+            if(currentMode != Mode.CALIBRATION && currentMode != Mode.TEST && currentMode != Mode.SCAN){
+                vsyncRunning = false;
+                return;
+            }
+            int index = VsyncNative(session);
+            if(index >= 0){
+                mainImView.setImageBitmap(bmpPr[index]);
+                mainImView.invalidate();
+            }
+            Choreographer.getInstance().postFrameCallback(this);
+        }
+    };
+
+    // Started when an overlay mode is entered or the activity resumes, stops itself in other modes
+    private void startVsync() {
+        if(currentMode != Mode.CALIBRATION && currentMode != Mode.TEST && currentMode != Mode.SCAN){
             return;
         }
-        if (bmpPr == null) {
-            bmpPr = Bitmap.createBitmap(displaySize.x, displaySize.y, Bitmap.Config.ARGB_8888);
+        if(!vsyncRunning){
+            vsyncRunning = true;
+            Choreographer.getInstance().postFrameCallback(vsyncCallback);
         }
+    }
 
-        Canvas canvas = new Canvas(bmpPr);
-        canvas.drawColor(0xFF000000); // to clear
-        canvas.drawRect(0,0,1280,720, white);
+    private void stopVsync() {
+        Choreographer.getInstance().removeFrameCallback(vsyncCallback);
+        vsyncRunning = false;
+    }
 
-        int x,y;
-        for (int i = 0; i <= descriptors.length - 2; i += 2)
+    // Only called when an output cadence is set on native side, otherwise see vsyncCallback
+    public void overlayCallback(final int index, final long captureTime) {
+        if(currentMode != Mode.CALIBRATION && currentMode != Mode.TEST && currentMode != Mode.SCAN){
+            // Overlay is only projected in these modes
+            return;
+        }
+        if (!cam_opened)
         {
-            x = descriptors[i];
-            y = descriptors[i+1];
-            canvas.drawCircle(x, y, 40, white);
-            canvas.drawCircle(x, y, 5, white);
+            Log.d(LOG_TAG, "Device in Java not initialized");
+            return;
         }
 
         runOnUiThread(new Runnable() {
             @Override
             public void run() {
-                mainImView.setImageBitmap(bmpPr);
+                mainImView.setImageBitmap(bmpPr[index]);
+                mainImView.invalidate();
+                // the bitmap is drawn within the next frame, report it to measure motion to photon latency
+                Choreographer.getInstance().postFrameCallback(new Choreographer.FrameCallback() {
+                    @Override
+                    public void doFrame(long frameTimeNanos) {
+                        FrameShownNative(session, captureTime);
+                    }
+                });
+            }
+        });
+    }
+
+    // Called when an average of calibration points or a scan is finished, depths in cm. Rejected points moved
+    // or were seen in too few frames. neededDepth is -1 when the points are enough.
+    public void pointCallback(final int points, final int added, final int rejected, final int depth, final int neededDepth) {
+        runOnUiThread(new Runnable() {
+            @Override
+            public void run() {
+                if(added == 0){
+                    Toast.makeText(getApplicationContext(), "Point is not saved, hold the retro still", Toast.LENGTH_SHORT).show();
+                    tvDebug.setText(points + " points, " + rejected + " rejected");
+                    return;
+                }
+                if(rejected > 0){
+                    Toast.makeText(getApplicationContext(), added + " points saved, " + rejected + " rejected", Toast.LENGTH_SHORT).show();
+                }
+                if(neededDepth == -1 && autoCapture){
+                    autoCapture = false;
+                    SetAutoCaptureNative(session, false);
+                    buttonCalc.performClick();
+                    tvDebug.setText(points + " points collected, calibrated");
+                    return;
+                }
+                tvDebug.setText(points + " points, last at " + depth + " cm. Next around " + neededDepth + " cm");
             }
         });
     }
@@ -0,0 +1,23 @@
+#pragma once
+
+// Retro segmentation threshold computed from the gray histogram of the frame.
+// Otsu's method is run on the bright tail of the histogram, where retro pixels separate from
+// the brightest ambient pixels, and the result is smoothed with hysteresis across frames.
+class AdaptiveThreshold {
+
+    const double TAIL_START = 0.9;      // the tail begins at this percentile
+    const int MIN_THRESHOLD = 150;      // 16-bit gray value
+    const int AMBIENT_FACTOR = 3;       // threshold is at least this times the median gray value
+    const double HYSTERESIS = 0.1;      // relative change which is ignored
+    const double SMOOTHING = 0.5;       // step towards the new value
+
+public:
+    AdaptiveThreshold(int initial);
+
+    // hist: bin i counts gray values in [i << shift, (i+1) << shift), total is the pixel count
+    int update(const int* hist, int bins, int shift, int total);
+    int get() const { return current; }
+
+private:
+    int current;
+};
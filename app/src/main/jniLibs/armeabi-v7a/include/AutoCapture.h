@@ -0,0 +1,50 @@
+#pragma once
+
+#include "opencv2/opencv.hpp"
+
+using namespace std;
+using namespace cv;
+
+// Collects calibration points without the add button. A point is taken when a single confident
+// blob holds still for STABLE_FRAMES frames. Points are indexed by depth buckets; a bucket takes
+// a new point only while it has no more points than the least sampled bucket the marker has
+// visited, so the samples spread evenly over the depths instead of piling up at one distance.
+class AutoCapture {
+
+    const int STABLE_FRAMES = 10;
+    const int STILL_DISTANCE = 2;       // in pixel, movement allowed while the blob holds still
+    const float STILL_DEPTH = 1.0f;     // in cm
+    const int MIN_SEPARATION = 8;       // in pixel, the blob should move this far between two points
+    const float NEAREST = 30.0f;        // in cm, near edge of the first bucket
+    const float BUCKET_SIZE = 10.0f;    // in cm
+    const int BUCKETS = 12;
+    const int PER_BUCKET = 3;           // points of a full bucket
+    const int COMPLETE_BUCKETS = 5;     // full buckets which are enough to calibrate
+
+public:
+    AutoCapture();
+
+    void reset();
+    // Indexes a point which is saved, also the ones added by hand
+    void add(int index, float depth);
+
+    // Called for every frame in calibration mode while no point is averaged, valid is false if
+    // there is not a single acceptable blob. Returns true if the blob at uv (px) and depth (cm)
+    // should be averaged now, the pose counts as captured only after finish(true).
+    bool update(bool valid, Point2i uv, float depth);
+    // Called when the averaging started by update() is over, saved is false if the point moved
+    void finish(bool saved);
+
+    // Center depth in cm of the least sampled bucket the operator should move to,
+    // -1 if the points are enough to calibrate
+    int neededDepth() const;
+    int bucketOf(float depth) const; // -1 out of range
+
+private:
+    vector<vector<int>> buckets; // indices of the saved points per depth bucket
+    vector<bool> visited;        // buckets a stable blob has been seen in
+    Point2i stillPoint, lastCapture, pendingCapture;
+    float stillDepth = 0, lastCaptureDepth = 0, pendingDepth = 0;
+    int stableFrames = 0;
+    bool captured = false;
+};
@@ -0,0 +1,25 @@
+#pragma once
+
+#include "opencv2/opencv.hpp"
+
+using namespace std;
+using namespace cv;
+
+// Extrapolates projected blob centers forward in time, so the overlay does not trail
+// moving markers by the pipeline latency.
+class BlobPredictor {
+
+    const float MAX_MATCH_DISTANCE = 80.0f; // in pro. pixel, larger jumps are treated as a new blob
+
+public:
+    BlobPredictor();
+
+    // centers: {u0, v0, u1, v1, ...} in pro. pixel, they are moved by velocity * latency in place
+    // timestamp and latency in microseconds
+    void predict(vector<int> &centers, int64_t timestamp, int64_t latency, Size bounds);
+    void reset();
+
+private:
+    vector<Point2f> previous;
+    int64_t previousTimestamp = 0;
+};
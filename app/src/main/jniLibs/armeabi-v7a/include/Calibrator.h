@@ -4,28 +4,61 @@
 
 #include "opencv2/opencv.hpp"
 #include "CamListener.h"
+#include "LatencyMonitor.h"
+#include "BlobPredictor.h"
+#include "ExposureController.h"
+#include "AdaptiveThreshold.h"
+#include "OutputStage.h"
+#include "Segmenter.h"
+#include "PyramidDetector.h"
+#include "StaticMask.h"
+#include "ChangeGate.h"
+#include "DepthSampler.h"
+#include "UndistortedPreview.h"
+#include "AutoCapture.h"
+#include "MarkerConstellation.h"
+#include "PointAverager.h"
+#include "StructuredLight.h"
+#include "ProjectorMapping.h"
+#include "ShiftFit.h"
 
 using namespace std;
 using namespace cv;
 
 class Calibrator : public CamListener{
 
-    const int RETRO_THRESHOLD = 300;
-    const double MAX_RETRO_AREA = 50.0;
+    const int RETRO_THRESHOLD = 300; // initial value of the adaptive threshold
+    const int MAX_RETRO_AREA = 50; // in pixel
     const int MIN_CONFIDENCE = 100;
+    const int MIN_MARKERS = 3; // of the constellation, to save its points
     const float MAX_RANGE = 0.5f;
+    const double MIN_UV_VARIANCE = 1.0 / 12; // in pixel^2, quantization of the centroid
+    const int SCAN_SETTLE_FRAMES = 5;   // skipped after a scan pattern is set, until it is on the wall
+    const int SCAN_FRAMES = 3;          // averaged for every scan pattern
+    const int SCAN_STEP = 8;            // in pixel, grid of the decoded pixels which become cam points
 
     struct CamPoint{
         Point3f xyz;            // in cm
-        Point2i uv;             // in pixel ( cam )
-        Point2i uv_corrected;   // in pixel ( cam )
+        Point2f uv;             // in pixel ( cam ), centroid averaged over the frames
+        Point2f uv_corrected;   // in pixel ( cam )
+        Point2f target;         // in pro. pixel, where the marker is projected
+        Point3f variance;       // of u, v (pixel^2) and z (cm^2) while it is averaged,
+                                // of the shift (cam. pixel^2) and z over the pixels of a scan
+    };
+
+    // single blob of the last detected frame, sampled while the detect stage owns its maps
+    struct Candidate{
+        int blobs = 0;
+        int area = 0;
+        int confidence = 0;     // of the ring the depth is sampled from
+        CamPoint point;
     };
 
 public:
     // Constructors
     Calibrator();
 
-    enum Mode {UNKNOWN, DEPTH, GRAY, CALIBRATION, TEST};
+    enum Mode {UNKNOWN, DEPTH, GRAY, CALIBRATION, TEST, SCAN};
 
     //functions
     void calibrate();
@@ -34,26 +67,85 @@ public:
     void setMode(int i);
     Vec4d getCalibration();
     void setCalibration(double* arr);
+    void setLensParameters (LensParameters lensParameters);
+    void setPrediction(bool enabled);
+    void setPyramid(bool enabled); // coarse-to-fine retro detection
+    void learnBackground(); // learns the static bright pixels again from the next frames
+    void setUndistortedPreview(bool enabled); // GRAY preview without the lens distortion
+    void setAutoCapture(bool enabled); // points are saved without saveCamPoint in calibration mode
+    void setConstellation(bool enabled); // saveCamPoint saves every marker of the board at once
+    void onFrameShown(int64_t captureTime); // called when the blobs of the frame are displayed
+    int requiredStreams();
+    bool needsTileSums();
+    void setOverlayBitmaps(JNIEnv* env, jobject first, jobject second);
+    void setOutputCadence(int hz);
+    int onVsync(JNIEnv* env); // returns the overlay buffer to present or -1
+
+    ExposureController exposureController;
 
 
 private:
-    Mat pattern, grayBin;
-    vector<vector<Point> > retro_contours;
+    Mat pattern;
+    vector<Blob> blobs;
     vector<CamPoint> cam_points;
 
-    float x_scale, y_scale;
+    float x_scale = 0, y_scale = 0;
     double x_offset, y_offset; // in pro. pixel
-    vector<int> blobCenters;
+    ProjectorMapping mapping; // rebuilt when the projector or the calibration changes
+    Candidate candidate;
+
+    AdaptiveThreshold retroThreshold;
+    Segmenter segmenter;
+    PyramidDetector pyramid;
+    bool pyramidEnabled = false;
+    StaticMask staticMask;
+    bool maskFlip = true; // flip of the frames the static mask is learned from
+    ChangeGate changeGate;
+    DepthSampler depthSampler;
+    UndistortedPreview undistortedPreview; // guarded by outputMutex
+    bool undistorting = false;
+    AutoCapture autoCapture;
+    bool autoCapturing = false;
+    bool autoAveraging = false;     // the averaged point is started by the auto capture
+    MarkerConstellation constellation;
+    bool constellationEnabled = false;
+    vector<Point2f> targets;        // of the constellation markers in pro. pixel
+    Mat constellationPattern;
+    vector<CamPoint> markerPoints;  // identified markers of the last detected frame
+    vector<int> markerSlots;        // index of each marker point in the constellation
+    PointAverager averager;         // points are saved after it averages them
+    bool averagingBoard = false;    // slots of the averager are the constellation markers
+    StructuredLight structuredLight;
+    int scanPattern = 0;            // shown by the projector, patterns() when the scan is done
+    int scanFrames = 0;             // detected since the pattern is set
+    int64_t scanStart = 0;
+    vector<int> lastCenters; // of the last processed frame in TEST mode
+    LatencyMonitor latency;
+    BlobPredictor predictor;
+    OutputStage output;
+    bool prediction = false;
 
     Mode currentMode = UNKNOWN;
     Device projector; //{1280, 720, 37.6*deg2rad, 21.76*deg2rad};
     Vec4d calibration_result;
 
-    void onNewData (const DepthData *data);
-    pair<double, double> fitExponential(const vector<double> &x, vector<double> &y);
+    void detectFrame(Frame &frame);
+    void publishFrame(Frame &frame);
     pair<double, double> fitLinear(const vector<double> &x, const vector<double> &y);
+    bool candidateValid() const;
+    void averagePoints(Frame &frame);
+    void startScan();
+    void scanFrame(Frame &frame);
+    void addScanPoints(const Frame &frame, const Mat &coordinates);
+    void addCamPoint(const CamPoint &cp);
+    void updateConstellation();
+    void identifyMarkers(const Frame &frame);
+    const Mat& calibrationPattern() const;
     void undistortCamPoints();
+    void updateScale();
+    Point2d shiftOf(const CamPoint &cp) const; // in pro. pixel, of an undistorted point
     Point2i convertCam2Pro(Point2i proj_point, float depth);
+    void updateMapping();
 
 };
 
@@ -4,23 +4,47 @@
 
 #include <jni.h>
 #include <opencv2/core.hpp>
+#include "OverlayRenderer.h"
 
 class CallbackManager {
 
 public:
     CallbackManager();
-    CallbackManager(JavaVM* vm, jobject& obj, jmethodID& amplitudeCallbackID, jmethodID& shapeDetectedCallbackID);
+    CallbackManager(JavaVM* vm, jobject& obj, jmethodID& amplitudeCallbackID, jmethodID& overlayCallbackID,
+                    jmethodID& pointCallbackID);
+
+    // Deletes the global references of java objects
+    void release(JNIEnv* env);
 
     // It sends whole image to java
     void sendImageToJavaSide(const cv::Mat& image, const bool flip = false);
+    // It sends an image which is packed already, CV_32SC1 ARGB_8888
+    void sendArgbToJavaSide(const cv::Mat& argb);
+
+    // It tells java that a calibration point is captured, depths in cm
+    void sendPointToJavaSide(int points, int added, int rejected, int depth, int neededDepth);
+
+    // Two ARGB_8888 bitmaps of java side which the overlay is rendered into
+    void setOverlayBitmaps(JNIEnv* env, jobject first, jobject second);
+    cv::Size overlaySize();
+
+    // It renders center of the detected retros into the back bitmap and asks java to present it,
+    // with the capture time of its frame (us)
+    bool presentOverlay(OverlayRenderer &renderer, const std::vector<int> & centers, int64_t captureTime);
 
-    // It sends center of the detected retro as array
-    void onShapeDetected(const std::vector<int> & arr);
+    // It renders into the back bitmap on a thread attached to java, returns its index or -1 on failure
+    int renderOverlay(JNIEnv* env, OverlayRenderer &renderer, const std::vector<int> & centers);
 
 private:
-    JavaVM* m_vm;
+    void sendPixels(const jint* pixels, int count);
+
+    JavaVM* m_vm = nullptr;
     jmethodID m_amplitudeCallbackID;
-    jmethodID m_blobsCallbackID;
-    jobject m_obj;
-};
+    jmethodID m_overlayCallbackID;
+    jmethodID m_pointCallbackID;
+    jobject m_obj = nullptr;
 
+    jobject m_overlay[2] = {nullptr, nullptr};
+    cv::Size m_overlaySize;
+    int m_backBuffer = 0;
+};
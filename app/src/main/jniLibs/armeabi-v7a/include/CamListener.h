@@ -4,9 +4,17 @@
 
 #include <royale/LensParameters.hpp>
 #include <royale/IDepthDataListener.hpp>
+#include <royale/IDepthImageListener.hpp>
 #include "opencv2/opencv.hpp"
 #include "CallbackManager.h"
+#include "Frame.h"
+#include "FrameScheduler.h"
+#include "TemporalFilter.h"
+#include "SpscQueue.h"
+#include <atomic>
+#include <condition_variable>
 #include <mutex>
+#include <thread>
 #include <jni.h>
 
 using namespace royale;
@@ -15,16 +23,43 @@ using namespace cv;
 
 static const double deg2rad = 0.0174533; // 1 degree = 0.0174533 radian
 
-class CamListener : public royale::IDepthDataListener {
+class CamListener : public royale::IDepthDataListener, public royale::IDepthImageListener {
 
 public:
+    // royale streams which can feed the listener
+    enum Stream { DEPTH_DATA = 1, DEPTH_IMAGE = 2 };
+
     // Constructors
     CamListener();
+    virtual ~CamListener();
 
     // Public methods
-    void setLensParameters (LensParameters lensParameters);
+    virtual void setLensParameters (LensParameters lensParameters);
     void setCamera(int width, int height, double v_fov, double h_fov);
     void toggleFlip();
+    void setCallbackManager(const CallbackManager &manager);
+    void setTemporalFilter(bool enabled); // smooths depth and confidence during ingestion
+    void setCompactFrames(bool enabled); // z is stored as 16 bit millimeters instead of a float xyz map
+    // Frames go through ingest (royale callback), detect and publish stages, each on its own thread.
+    // Without the pipeline both stages run in the data callback.
+    void startPipeline();
+    void stopPipeline();
+    void waitIdle(); // waits until all ingested frames are published
+    // Frame rate of the active use case, it sets the processing budget. 0 while it is being probed.
+    void setFrameRate(int fps);
+
+    // Streams which should be registered to the camera for the current state
+    virtual int requiredStreams();
+    // Whether ingestion fills Frame::tileSums, only change detection reads them
+    virtual bool needsTileSums();
+
+    struct FrameStats{
+        int frames = 0;         // frames processed since the last call
+        int64_t meanCost = 0;   // time of the slowest stage per frame in us, it limits the throughput
+        int64_t maxCost = 0;
+    };
+    // Returns the statistics collected since the last call and resets them
+    FrameStats takeFrameStats();
 
     // Public variables
     CallbackManager callbackManager;
@@ -36,18 +71,80 @@ protected:
         double horizontal_fov;
     };
 
+    struct IngestStats{
+        int frames = 0;
+        int64_t bytes = 0;
+        int64_t micros = 0;
+    };
+
+    void onNewData (const DepthData *data);
+    void onNewData (const DepthImage *data);
+    // Called on the detect stage with flagMutex locked, results are stored in the frame
+    virtual void detectFrame(Frame &frame);
+    // Called on the publish stage with outputMutex locked, sends the results to java
+    virtual void publishFrame(Frame &frame);
 
-    virtual void onNewData (const DepthData *data);
-    void updateMaps(const DepthData* data);
+    void updateMaps(Frame &target, const DepthData* data);
+    void updateMaps(Frame &target, const DepthImage* data);
     void setFlip(bool flip);
+    bool previewDue(const Frame &frame); // false for the previews shed by the scheduler
 
-    Mat xyzMap, confMap, grayImage;
-    Mat outputImage; // to visualize with CV_8UC1
+    Mat outputImage; // to visualize with CV_8UC1, used by the publish stage
 
     Mat cameraMatrix, distortionCoefficients;
 
     Device camera;
     mutex flagMutex;
-    bool flip = true;
-};
+    mutex outputMutex; // guards callbackManager and outputImage
+    atomic<bool> flip {true};
 
+private:
+    static const int STATS_INTERVAL = 300; // frames
+    static const int SLOT_COUNT = 4;
+    static const int PREVIEW_DIVISOR = 4; // every n-th preview is sent while previews are shed
+
+    // Wakes up a stage which waits for its input queue
+    struct StageSignal{
+        mutex signalMutex;
+        condition_variable condition;
+        void notify();
+    };
+
+    void logIngest(Stream stream, IngestStats &stats, int64_t bytes, int64_t start);
+    bool startFilter(bool flipped); // true if the frame is filtered, resets the history if needed
+    bool acquireSlot();
+    void handOver();
+    void runDetect();
+    void runPublish();
+    void detect(Frame &target);
+    void publish(Frame &target);
+    bool waitFor(SpscQueue<SLOT_COUNT> &queue, StageSignal &signal, int &slot);
+    void recordCost(const Frame &target);
+    void logOccupancy();
+
+    // Preallocated frames travel ingest -> detect -> publish -> free, each queue has one producer and one consumer
+    Frame slots[SLOT_COUNT];
+    SpscQueue<SLOT_COUNT> freeSlots, detectQueue, publishQueue;
+    StageSignal detectSignal, publishSignal;
+    int ingestSlot = -1;        // slot which the next frame is written to
+    atomic<int> inFlight {0};   // frames which are ingested but not published yet
+    atomic<bool> running {false};
+    thread detectThread, publishThread;
+
+    mutex ingestMutex, statsMutex;
+    int dropped = 0, staleFrames = 0;
+    TemporalFilter temporalFilter; // guarded by ingestMutex
+    atomic<bool> filtering {false}, filterReset {false};
+    atomic<bool> compact {false};
+    bool filteredFlip = true; // flip of the filter history
+    FrameScheduler scheduler;
+    bool skipNext = false;  // detect stage alternates frames while the scheduler skips frames
+    int previewCount = 0;
+
+    IngestStats depthDataStats, depthImageStats;
+    FrameStats frameStats;
+    int64_t totalCost = 0;
+    int64_t busy[3] = {0, 0, 0}; // ingest, detect, publish time since the last occupancy report
+    int64_t occupancyStart = 0;
+    int occupancyFrames = 0;
+};
@@ -0,0 +1,34 @@
+#pragma once
+
+#include "opencv2/opencv.hpp"
+
+using namespace std;
+using namespace cv;
+
+// Decides whether a frame can reuse the results of the last processed one. The tile sums and
+// moments of the gray image (see Frame) are compared with the ones of the last processed frame.
+// A marker moving between tiles changes their sums far more than the sensor noise, a marker
+// moving inside one tile keeps the sum but shifts the moments.
+class ChangeGate {
+
+    const int MAX_MEAN_CHANGE = 8;      // gray value per pixel of a tile, more is a change
+    const int REFRESH_FRAMES = 30;      // a frame is processed at least this often
+    const int REPORT_INTERVAL = 300;    // frames
+
+public:
+    ChangeGate();
+
+    // true if nothing changed since the last accepted frame, its results can be reused
+    bool unchanged(const Mat &tileSums);
+    // Stores the tile sums of a processed frame and the time it took in microseconds
+    void accept(const Mat &tileSums, int64_t cost);
+    void invalidate(); // next frame is processed, e.g. after a mode change
+
+private:
+    void count(bool reused);
+
+    Mat reference;
+    int sinceRefresh = 0;
+    int frames = 0, reusedFrames = 0;
+    int64_t processedCost = 0;
+};
@@ -0,0 +1,41 @@
+#pragma once
+
+#include "opencv2/opencv.hpp"
+#include "Frame.h"
+
+using namespace std;
+using namespace cv;
+
+// Depth of a retro blob. The blob itself is often saturated and has low confidence, so the
+// depth is the confidence weighted median of a ring of pixels around its bounding box in the
+// (distorted) camera image. Only every stride-th pixel of the ring is visited, the cost per blob
+// is bounded.
+class DepthSampler {
+
+    const int RING_GAP = 1;             // pixels between the blob and the ring
+    const int RING_WIDTH = 3;
+    const int MAX_SAMPLES = 256;
+    const int MIN_SAMPLE_CONFIDENCE = 50;
+
+public:
+    struct Sample{
+        Point3f xyz;        // in meters, point of the median pixel
+        int confidence = 0; // mean confidence of the used pixels
+        int count = 0;      // used pixels, 0 if there is no valid one
+    };
+
+    DepthSampler();
+
+    // Pinhole model of the frames, x and y of compact frames are reconstructed with it
+    void setLens(const Mat &cameraMatrix);
+
+    // Thread safe, blobs of a frame can be sampled in parallel
+    Sample estimate(const Frame &frame, const Rect &bbox) const;
+
+    // Point of a pixel in meters, z is its depth
+    Point3f pointAt(const Frame &frame, Point pixel, float z) const;
+
+private:
+
+    float fx = 0, fy = 0, cx = 0, cy = 0;
+};
@@ -0,0 +1,75 @@
+#pragma once
+
+#include <royale/ICameraDevice.hpp>
+#include <royale/IExposureListener2.hpp>
+#include <atomic>
+#include <condition_variable>
+#include <functional>
+#include <mutex>
+#include <thread>
+
+using namespace royale;
+using namespace std;
+
+// Closed loop exposure control which keeps the peak gray value of the retro blobs in range.
+// The data callback only hands over the blob statistics, exposure is changed on the
+// controller thread at most once per CONTROL_INTERVAL_MS. The camera runs in MANUAL exposure
+// mode, so the controller keeps track of the exposure time it sets itself. The exposure listener
+// confirms the changes, an exposure set by someone else (e.g. a use case change) is taken over.
+// Without a blob it searches a few steps above the last exposure which showed one, then it
+// goes back to that exposure and holds, a longer exposure only saturates the scene.
+class ExposureController : public royale::IExposureListener2 {
+
+    const int CONTROL_INTERVAL_MS = 200;
+    const int TARGET_PEAK = 1500;          // 16-bit gray value
+    const int MIN_PEAK = 700;              // retro threshold should be exceeded clearly
+    const int MAX_PEAK = 2500;             // markers saturate above
+    const double MAX_STEP = 2.0;           // exposure ratio in one update
+    const double SEARCH_STEP = 1.25;       // while there is no blob
+    const int MAX_SEARCH_STEPS = 4;        // up to 2.4x of the last exposure with a blob
+
+public:
+    ExposureController();
+    ~ExposureController();
+
+    void start(ICameraDevice* device, uint32_t exposureTime);
+    void stop();
+
+    // True once per control interval, blob statistics are computed only then
+    bool wantsStats() const { return statsRequested; }
+    // Called from the data callback with the brightest blob of the frame (peak = 0 when there is no blob)
+    void onBlobStats(int peak, double area);
+
+    // Called with the new exposure time after it is applied
+    function<void(uint32_t)> onExposureChanged;
+
+    // Control law of one interval, it does not touch the camera. Returns the exposure time for
+    // the peak of the brightest blob seen at the current exposure (0 when there is no blob).
+    uint32_t nextExposure(int peak);
+    // Exposure time in effect, set after the camera accepted it
+    void setExposure(uint32_t exposureTime);
+    void setLimits(uint32_t minExposure, uint32_t maxExposure);
+    uint32_t exposureTime() const { return exposure; }
+
+private:
+    void onNewExposure (const uint32_t exposureTime, const royale::StreamId streamId) override;
+    void run();
+
+    ICameraDevice* device = nullptr;
+    uint32_t exposure = 0;
+    uint32_t requested = 0;    // sent to the camera, its confirmation is not a change from outside
+    uint32_t minExposure = 1, maxExposure = 2000;
+    uint32_t blobExposure = 0; // last exposure which showed a blob, the search starts from it
+    int searchSteps = 0;       // MAX_SEARCH_STEPS + 1 while holding after a search
+
+    int latestPeak = 0;
+    double latestArea = 0;
+    bool hasStats = false;
+    atomic<bool> statsRequested;
+    int64_t unstableSince = 0; // ms, 0 when peak is in range
+
+    thread worker;
+    mutex statsMutex;
+    condition_variable statsCond;
+    bool running = false;
+};
@@ -0,0 +1,136 @@
+#pragma once
+
+#include "opencv2/opencv.hpp"
+
+using namespace cv;
+
+// One camera frame in the layout used by the processing, whichever royale stream filled it
+struct Frame {
+    enum Content { XYZ = 1, CONFIDENCE = 2, GRAY = 4, DEPTH = 8, TILES = 16 };
+
+    // coarse histogram of the gray image, filled during ingestion. The retro threshold needs the
+    // distribution of the gray values, not every pixel: every HIST_STEP-th pixel of every
+    // HIST_STEP-th row is counted.
+    static const int HIST_SHIFT = 4;
+    static const int HIST_BINS = 256;   // gray values above 4095 are counted in the last bin
+    static const int HIST_STEP = 2;
+    // gray sum and first moments of 16x16 tiles, filled during ingestion to detect changes
+    // between frames. The moments weight a pixel with its offset from the tile center.
+    static const int TILE_SHIFT = 4;
+    static const int TILE = 1 << TILE_SHIFT;
+    static const int TILE_CHANNELS = 3; // sum, x moment, y moment
+
+    int64_t timestamp = 0;  // capture time in microseconds since epoch
+    int64_t ingestCost = 0; // time spent in each pipeline stage in microseconds
+    int64_t detectCost = 0;
+    int64_t publishCost = 0;
+    int content = 0;        // Content flags of the maps which are valid for this frame
+    bool flipped = false;   // maps are mirrored, as the flip was during ingestion
+
+    Mat xyzMap;     // CV_32FC3 in meters (only z is valid when it comes from a depth image)
+    Mat depthMap;   // CV_16UC1 z in millimeters, used instead of xyzMap by compact frames
+    Mat confMap;    // CV_8UC1 0 (invalid) - 255 (full confidence)
+    Mat grayImage;  // CV_16UC1
+    int grayHistogram[HIST_BINS];
+    Mat tileSums;   // CV_32SC3
+
+    // results of the detect stage for the publish stage
+    bool stale = false;     // a newer frame was waiting or the frame is shed, it is not published
+    bool reused = false;    // nothing changed, the results of the previous frame are on the display
+    int level = 0;          // FrameScheduler::Level the frame is processed with
+    int mode = 0;           // mode of the listener when the frame is detected
+    int threshold = 0;      // retro threshold of the gray image
+    std::vector<uint32_t> retroBits; // GRAY mode: packed retro mask after the static suppression,
+    int retroWords = 0;              // retroWords per row, 0 when the detection was decimated
+    std::vector<int> centers; // blob centers in projector pixels, u0 v0 u1 v1 ...
+    int capturedPoints = 0; // calibration points after this frame
+    int addedPoints = 0;    // points saved by this frame, when an average or a scan finished
+    int rejectedPoints = 0; // points of a finished average which moved or were seen too rarely
+    int capturedDepth = 0;  // in cm, of the last added point
+    int neededDepth = 0;    // in cm, where the next point is needed, -1 if there are enough
+
+    void create(int width, int height, bool compact = false)
+    {
+        grayImage.create (Size (width,height), CV_16UC1);
+        confMap.create(Size (width,height), CV_8UC1);
+        tileSums.create((height + TILE - 1) / TILE, (width + TILE - 1) / TILE, CV_32SC3);
+        setCompact(compact);
+        content = 0;
+    }
+
+    // Compact frames carry z only as 16 bit millimeters, x and y come from the lens model
+    void setCompact(bool compact)
+    {
+        Size size = grayImage.size();
+        if(compact){
+            depthMap.create(size, CV_16UC1);
+            xyzMap.release();
+        }
+        else{
+            xyzMap.create(size, CV_32FC3);
+            depthMap.release();
+        }
+    }
+    bool compact() const { return !depthMap.empty(); }
+
+    // Twice the offset of a column or row from the center of its tile, odd in [-15, 15]
+    static int tileWeight(int i) { return 2 * (i & (TILE - 1)) - (TILE - 1); }
+
+    static bool histogramRow(int y) { return y % HIST_STEP == 0; }
+    // Pixels counted in the histogram of a frame
+    static int histogramSamples(int width, int height)
+    {
+        return ((width + HIST_STEP - 1) / HIST_STEP) * ((height + HIST_STEP - 1) / HIST_STEP);
+    }
+
+    bool has(int flags) const { return (content & flags) == flags; }
+
+    // z in meters at a pixel, from the map which is valid
+    float depthAt(int y, int x) const
+    {
+        return has(XYZ) ? xyzMap.at<Vec3f>(y, x)[2] : depthMap.at<uint16_t>(y, x) * 0.001f;
+    }
+
+    // z map in meters as CV_32FC1
+    void depth(Mat &z) const
+    {
+        if(has(XYZ)) extractChannel(xyzMap, z, 2);
+        else depthMap.convertTo(z, CV_32F, 0.001);
+    }
+
+    // Bytes of the maps per pixel: confidence, gray and depth
+    static int bytesPerPixel(bool compact)
+    {
+        return (int)(sizeof(uint8_t) + sizeof(uint16_t) + (compact ? sizeof(uint16_t) : 3 * sizeof(float)));
+    }
+
+    // Exchanges the buffers, no pixel is copied
+    void swap(Frame &other)
+    {
+        std::swap(timestamp, other.timestamp);
+        std::swap(ingestCost, other.ingestCost);
+        std::swap(detectCost, other.detectCost);
+        std::swap(publishCost, other.publishCost);
+        std::swap(stale, other.stale);
+        std::swap(reused, other.reused);
+        std::swap(level, other.level);
+        std::swap(mode, other.mode);
+        std::swap(threshold, other.threshold);
+        retroBits.swap(other.retroBits);
+        std::swap(retroWords, other.retroWords);
+        centers.swap(other.centers);
+        std::swap(capturedPoints, other.capturedPoints);
+        std::swap(addedPoints, other.addedPoints);
+        std::swap(rejectedPoints, other.rejectedPoints);
+        std::swap(capturedDepth, other.capturedDepth);
+        std::swap(neededDepth, other.neededDepth);
+        std::swap(content, other.content);
+        std::swap(flipped, other.flipped);
+        cv::swap(xyzMap, other.xyzMap);
+        cv::swap(depthMap, other.depthMap);
+        cv::swap(confMap, other.confMap);
+        cv::swap(grayImage, other.grayImage);
+        cv::swap(tileSums, other.tileSums);
+        std::swap_ranges(grayHistogram, grayHistogram + HIST_BINS, other.grayHistogram);
+    }
+};
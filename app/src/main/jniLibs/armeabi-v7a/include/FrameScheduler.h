@@ -0,0 +1,68 @@
+#pragma once
+
+#include <atomic>
+#include <cstdint>
+#include <mutex>
+#include <vector>
+
+using namespace std;
+
+// Keeps the pipeline within the frame period of the active use case. When the slowest stage
+// runs over the budget, work is shed level by level: preview first, then segmentation
+// resolution, then whole frames. A level which does not relieve the slowest stage is passed over.
+// Shed levels are restored in reverse order once their predicted cost has headroom again: the
+// cost of the current level is scaled by the ratio measured when the level was shed.
+class FrameScheduler {
+
+    const double OVERRUN_RATIO = 0.9;   // of the budget, a slower frame is an overrun
+    const double HEADROOM_RATIO = 0.8;  // of the budget, the restored level should be predicted below
+    const int DEGRADE_FRAMES = 5;       // consecutive overruns before shedding a level
+    const int RESTORE_FRAMES = 60;      // consecutive frames with headroom before restoring a level
+    const int SETTLE_FRAMES = 10;       // frames at a new level before its cost is compared
+    const double SMOOTHING = 0.125;     // weight of a new frame in the average stage costs
+
+public:
+    enum Level {FULL, NO_PREVIEW, DECIMATED, SKIP_FRAMES, LEVEL_COUNT};
+    enum Stage {INGEST, DETECT, PUBLISH, STAGE_COUNT};
+
+    struct Metrics{
+        int overruns = 0;
+        int degraded = 0;   // level changes towards less work
+        int restored = 0;
+        int frames[LEVEL_COUNT] = {0, 0, 0, 0}; // frames processed at each level
+    };
+
+    FrameScheduler();
+
+    // Budget is the frame period, 0 disables the scheduler and restores full quality
+    void setFrameRate(int fps);
+    // Called with the stage costs of every processed frame in microseconds. Pipelined stages
+    // overlap and the slowest one sets the frame rate, else the stages run one after the other.
+    void onFrame(const int64_t costs[STAGE_COUNT], bool pipelined);
+    Level level() const { return (Level)currentLevel.load(); }
+
+    // Returns the metrics collected since the last call and resets them
+    Metrics takeMetrics();
+
+private:
+    // A level which is shed, with its stage costs relative to the level which replaced it
+    struct Shed{
+        int level;
+        double ratio[STAGE_COUNT];
+        bool measured = false;
+    };
+
+    double load(const double costs[STAGE_COUNT], int level, bool pipelined, int &bottleneck) const;
+    int relief(int stage, bool pipelined) const; // next level which reduces the stage, -1 if none
+    void changeLevel(int level, double load);
+
+    atomic<int> currentLevel {FULL};
+    int64_t budget = 0;
+    int overrunStreak = 0, headroomStreak = 0;
+    double average[STAGE_COUNT];    // stage costs at the current level
+    double shedCost[STAGE_COUNT];   // stage costs of the level before the last shedding
+    int levelFrames = 0;            // frames at the current level
+    vector<Shed> shed;              // restored from the back
+    Metrics metrics;
+    mutex schedulerMutex;
+};
@@ -0,0 +1,151 @@
+#pragma once
+
+#include <royale/DepthData.hpp>
+#include "opencv2/opencv.hpp"
+#include "Frame.h"
+#include <algorithm>
+
+using namespace royale;
+using namespace std;
+using namespace cv;
+
+// Per row kernels of the frame ingestion, in a header so they can be benchmarked on the host.
+
+// Android DEPTH16 confidence of the upper 3 bits: 0 -> 100%, 1 -> 0%, n -> (n-1)/7
+static const uint8_t DEPTH16_CONFIDENCE[8] = {255, 0, 36, 72, 109, 145, 182, 218};
+
+// Neighbouring histogram samples mostly fall into the same bin, they are counted in two lanes
+// so an increment does not wait for the previous one
+static const int HIST_LANES = 2;
+
+// Destination of one ingested row
+struct IngestRow{
+    Vec3f *xyz;         // null for compact frames
+    uint16_t *depth;    // null for float frames
+    uint8_t *conf;
+    uint16_t *gray;
+    int *hist;          // HIST_LANES histograms of Frame::HIST_BINS, null on rows which are not sampled
+    int *columns;       // gray sums then y moments of the columns in the row of tiles, see reduceTiles
+    int rowWeight;      // Frame::tileWeight of the row
+};
+
+// Tile sums of a row of tiles from the column sums the kernels accumulated over its rows.
+// Adding whole rows to the columns vectorizes, the tiles are only formed once per row of tiles.
+static inline void reduceTiles(const int *columns, int width, int *tiles)
+{
+    const int *sums = columns, *moments = columns + width;
+    for (int start = 0; start < width; start += Frame::TILE)
+    {
+        int end = min(start + Frame::TILE, width);
+        int sum = 0, xMoment = 0, yMoment = 0;
+        for (int x = start; x < end; x++){
+            sum += sums[x];
+            xMoment += Frame::tileWeight(x) * sums[x];
+            yMoment += moments[x];
+        }
+        int *tile = tiles + (start >> Frame::TILE_SHIFT) * Frame::TILE_CHANNELS;
+        tile[0] = sum;
+        tile[1] = xMoment;
+        tile[2] = yMoment;
+    }
+}
+
+// Adds the lanes of an ingestion histogram to a histogram of Frame::HIST_BINS
+static inline void mergeHistogram(const int *lanes, int *hist)
+{
+    for(int i = 0; i < Frame::HIST_BINS; i++){
+        int sum = 0;
+        for(int lane = 0; lane < HIST_LANES; lane++) sum += lanes[lane * Frame::HIST_BINS + i];
+        hist[i] += sum;
+    }
+}
+
+static inline int histBin(uint16_t gray)
+{
+    return min(gray >> Frame::HIST_SHIFT, Frame::HIST_BINS - 1);
+}
+
+// Ingestion kernels are instantiated per orientation, depth representation and whether the mode
+// needs the tile sums, the pixel loops do not branch on them. A flipped row is read backwards
+// from src.
+// The maps are copied first, then the column sums and the histogram are taken from the gray row
+// while it is in the cache, in loops which the compiler can vectorize.
+template <bool FLIPPED, bool PACKED, bool TILES>
+static void ingestPoints(const DepthPoint *src, int width, const IngestRow &row)
+{
+    // in locals: a store through the byte pointer conf could change the members of row
+    Vec3f *xyz = row.xyz;
+    uint16_t *depth = row.depth;
+    uint8_t *conf = row.conf;
+    uint16_t *gray = row.gray;
+    int *sums = row.columns, *moments = row.columns + width;
+    const int rowWeight = row.rowWeight;
+    if(FLIPPED && !PACKED){
+        // one loop reading backwards is not vectorized, split it and sum the columns from the source
+        for (int x = 0; x < width; x++){
+            const DepthPoint &p = src[-x];
+            conf[x] = p.depthConfidence;
+            gray[x] = p.grayValue;
+            if(TILES){
+                sums[x] += p.grayValue;
+                moments[x] += rowWeight * p.grayValue;
+            }
+        }
+        for (int x = 0; x < width; x++){
+            const DepthPoint &p = src[-x];
+            xyz[x] = Vec3f(p.x, p.y, p.z);
+        }
+    }
+    else{
+        for (int x = 0; x < width; x++){
+            const DepthPoint &p = src[FLIPPED ? -x : x];
+            if(PACKED) depth[x] = (uint16_t)(int)min(p.z * 1000 + 0.5f, 65535.f);
+            else xyz[x] = Vec3f(p.x, p.y, p.z);
+            conf[x] = p.depthConfidence;
+            gray[x] = p.grayValue;
+        }
+        if(TILES){
+            for (int x = 0; x < width; x++){
+                sums[x] += gray[x];
+                moments[x] += rowWeight * gray[x];
+            }
+        }
+    }
+
+    int *hist = row.hist;
+    if(!hist) return;
+    static_assert(Frame::HIST_STEP == 2 && HIST_LANES == 2, "the loop counts pixels 0 and 2 of 4");
+    int x = 0;
+    for (; x + 4 <= width; x += 4){
+        hist[histBin(gray[x])]++;
+        hist[Frame::HIST_BINS + histBin(gray[x + 2])]++;
+    }
+    for (; x < width; x += Frame::HIST_STEP) hist[histBin(gray[x])]++;
+}
+
+// DEPTH16: lower 13 bits depth in mm, upper 3 bits confidence
+template <bool FLIPPED, bool PACKED>
+static void ingestDepth16(const uint16_t *src, int width, const IngestRow &row)
+{
+    for (int x = 0; x < width ; x++)
+    {
+        uint16_t cd = src[FLIPPED ? -x : x];
+        if(PACKED) row.depth[x] = cd & 0x1FFF; // already in millimeters
+        else row.xyz[x] = Vec3f(0, 0, (cd & 0x1FFF) * 0.001f);
+        row.conf[x] = DEPTH16_CONFIDENCE[cd >> 13];
+    }
+}
+
+typedef void (*PointKernel)(const DepthPoint *src, int width, const IngestRow &row);
+typedef void (*Depth16Kernel)(const uint16_t *src, int width, const IngestRow &row);
+
+// indexed by [flipped][packed][tiles]
+static const PointKernel POINT_KERNELS[2][2][2] = {
+        {{ingestPoints<false, false, false>, ingestPoints<false, false, true>},
+         {ingestPoints<false, true, false>, ingestPoints<false, true, true>}},
+        {{ingestPoints<true, false, false>, ingestPoints<true, false, true>},
+         {ingestPoints<true, true, false>, ingestPoints<true, true, true>}}};
+// indexed by [flipped][packed], depth images have no gray image
+static const Depth16Kernel DEPTH16_KERNELS[2][2] = {
+        {ingestDepth16<false, false>, ingestDepth16<false, true>},
+        {ingestDepth16<true, false>, ingestDepth16<true, true>}};
@@ -0,0 +1,44 @@
+#pragma once
+
+#include <cstdint>
+#include <mutex>
+
+using namespace std;
+
+// Collects the delay between the capture time of a frame (DepthData::timeStamp) and the
+// end of each pipeline stage. Keeps a sliding window per stage and logs its distribution.
+class LatencyMonitor {
+
+public:
+    enum Stage {INGEST, DETECT, PUBLISH, DISPLAY, STAGE_COUNT};
+
+    LatencyMonitor();
+
+    // Adds (now - captureTime) as a sample of the given stage
+    void record(Stage stage, int64_t captureTime);
+    // Adds a delay in microseconds, the distribution is logged every REPORT_INTERVAL ingested frames
+    void add(Stage stage, int64_t delay);
+
+    // Mean of the samples in the window in microseconds, 0 if there is no sample yet
+    int64_t mean(Stage stage);
+    // Percentile (0..100) of the samples in the window in microseconds, 0 if there is no sample yet
+    int64_t percentile(Stage stage, int percent);
+    // Samples in the window
+    int samplesIn(Stage stage);
+
+    void reset();
+
+    // Microseconds since epoch, same clock with DepthData::timeStamp
+    static int64_t now();
+
+private:
+    static const int WINDOW = 128;
+    static const int REPORT_INTERVAL = 300; // frames
+
+    void report();
+    int64_t percentileLocked(Stage stage, int percent);
+
+    int64_t samples[STAGE_COUNT][WINDOW];
+    int counts[STAGE_COUNT];
+    mutex sampleMutex;
+};
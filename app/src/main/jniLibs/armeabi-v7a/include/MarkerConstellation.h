@@ -0,0 +1,50 @@
+#pragma once
+
+#include "opencv2/opencv.hpp"
+#include <unordered_map>
+
+using namespace std;
+using namespace cv;
+
+// Identifies the markers of a rigid board with a known layout among the blobs of a frame by
+// geometric hashing. Every ordered pair of layout points is a basis, the other points are hashed
+// with their coordinates in it, which do not change with translation, rotation and scale. The
+// mirrored layout is hashed too. A frame votes with pairs of its blobs; the best basis is
+// verified by predicting every marker and taking the nearest blob.
+class MarkerConstellation {
+
+    const float BIN = 0.1f;             // size of a hash cell in basis lengths
+    const float TOLERANCE = 0.15f;      // of the closest marker spacing, distance of a marker to its prediction
+    const int MAX_BLOBS = 16;           // more blobs are not tried as basis, the vote is bounded
+    const int REPORT_INTERVAL = 300;    // frames
+
+public:
+    MarkerConstellation();
+
+    // Layout of the markers in any units with the axes of the camera image, at least 3 points
+    void setLayout(const vector<Point2f> &layout);
+    int size() const { return (int)layout.size(); }
+
+    // markers[k] is the index of the blob of layout point k or -1. Returns the identified markers.
+    int identify(const vector<Point2f> &blobs, vector<int> &markers);
+
+private:
+    struct Entry{
+        int basis;  // (i * n + j) * 2 + mirrored
+        int point;  // layout point which is hashed
+    };
+
+    static int key(int u, int v) { return (u + 1024) * 2048 + (v + 1024); }
+    Point2f basisCoordinates(Point2f origin, Point2f axis, Point2f p) const;
+    // Returns the markers found, error is their mean squared distance to the prediction in layout units
+    int verify(const vector<Point2f> &blobs, int a, int b, int basis, vector<int> &markers, float &error) const;
+    void report(int identified, int64_t cost);
+
+    vector<Point2f> layout;
+    float spacing = 0; // closest distance of two layout points
+    unordered_map<int, vector<Entry>> table;
+    vector<int> votes; // per basis, reused by every blob pair
+
+    int frames = 0, markersFound = 0;
+    int64_t totalCost = 0;
+};
@@ -0,0 +1,50 @@
+#pragma once
+
+#include "OverlayRenderer.h"
+#include <jni.h>
+#include <mutex>
+
+using namespace std;
+using namespace cv;
+
+class CallbackManager;
+
+// Keeps only the latest blob set of the processing and publishes it at the display cadence.
+// By default java pulls it on every Choreographer tick (onVsync), with a cadence set the
+// processing thread pushes it itself at most that often. Intermediate results are coalesced.
+class OutputStage {
+
+    const int REPORT_INTERVAL = 300; // published frames
+
+public:
+    OutputStage();
+
+    void setSize(Size display, Size projector);
+    void setPattern(const Mat &pattern);
+    // hz = 0: results are pulled by onVsync, otherwise they are pushed to java at most hz times per second
+    void setCadence(int hz);
+
+    // Called by the processing thread with the result of the frame
+    void publish(CallbackManager &callbackManager, const vector<int> &centers, int64_t captureTime);
+
+    // Called on the UI thread at vsync. Renders the pending result and returns the buffer to
+    // present, or -1 if nothing changed. captureTime is set to the frame of the rendered result.
+    // With a cadence only a result which publish held back is rendered, once its slot has come.
+    int onVsync(CallbackManager &callbackManager, JNIEnv* env, int64_t &captureTime);
+
+private:
+    void countPublished();
+
+    OverlayRenderer renderer;
+    mutex outputMutex;
+
+    vector<int> latest, presented;
+    int64_t latestTime = 0;
+    bool pending = false;        // latest is not presented yet
+    bool staticChanged = true;   // background of the overlay changed
+
+    int cadence = 0;
+    int64_t lastPush = 0;
+
+    int published = 0, coalesced = 0, unchanged = 0;
+};
@@ -0,0 +1,36 @@
+#pragma once
+
+#include "opencv2/opencv.hpp"
+
+using namespace std;
+using namespace cv;
+
+// Rasterizes the projector overlay into two persistent ARGB buffers.
+// Static content (projector border, calibration pattern) is kept in a background image and
+// only the rectangles around the blobs drawn last time on a buffer are restored from it.
+class OverlayRenderer {
+
+    const int OUTER_RADIUS = 40;    // in pro. pixel
+    const int INNER_RADIUS = 5;
+    const int THICKNESS = 5;
+
+public:
+    OverlayRenderer();
+
+    void setSize(Size display, Size projector);
+    // Pattern is fitted to the center of the projector, empty pattern shows only the projector border
+    void setPattern(const Mat &pattern);
+    bool ready() const { return !background.empty(); }
+
+    // Draws centers {u0, v0, u1, v1, ...} into target (CV_8UC4 buffer with given index).
+    // The view shows the buffers in turn, so it is redrawn as a whole.
+    void render(int buffer, Mat &target, const vector<int> &centers);
+
+private:
+    void updateBackground();
+
+    Size displaySize, projectorSize;
+    Mat pattern, background;
+    vector<Rect> drawn[2];  // blob rectangles drawn on each buffer
+    bool fullRedraw[2];
+};
@@ -0,0 +1,38 @@
+#pragma once
+
+#include <jni.h>
+#include <opencv2/core.hpp>
+
+// Per row kernels of the preview packing, in a header so they can be benchmarked on the host.
+
+// Source formats of the preview, int color = (A & 0xff) << 24 | (R & 0xff) << 16 | (G & 0xff) << 8 | (B & 0xff)
+struct BgrPixels{
+    typedef cv::Vec3b Pixel;
+    static jint argb(const Pixel &p) { return (jint)(0xFF000000u | p[2] << 16 | p[1] << 8 | p[0]); }
+};
+struct GrayPixels{
+    typedef uint8_t Pixel;
+    static jint argb(Pixel p) { return (jint)(0xFF000000u | p << 16 | p << 8 | p); }
+};
+
+// Packs one row, instantiated per format and orientation so the pixel loop does not branch.
+// A flipped image is written backwards from the last pixel.
+template <typename Format, bool FLIPPED>
+static void packRow(const cv::Mat &image, int row, jint *out)
+{
+    const typename Format::Pixel *src = image.ptr<typename Format::Pixel>(row);
+    int cols = image.cols; // a local, the stores to out could alias the Mat header
+    int last = image.rows * cols - 1;
+    jint *dst = FLIPPED ? out + last - row * cols : out + row * cols;
+    for (int j = 0; j < cols; j++){
+        dst[FLIPPED ? -j : j] = Format::argb(src[j]);
+    }
+}
+
+typedef void (*PackKernel)(const cv::Mat &image, int row, jint *out);
+
+// indexed by [format][flipped]
+enum PreviewFormat { BGR_PREVIEW, GRAY_PREVIEW };
+static const PackKernel PACK_KERNELS[2][2] = {
+        {packRow<BgrPixels, false>, packRow<BgrPixels, true>},
+        {packRow<GrayPixels, false>, packRow<GrayPixels, true>}};
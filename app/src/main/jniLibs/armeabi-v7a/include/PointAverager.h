@@ -0,0 +1,52 @@
+#pragma once
+
+#include "opencv2/opencv.hpp"
+
+using namespace std;
+using namespace cv;
+
+// Averages calibration points over a window of frames with streaming (Welford) mean and
+// variance, no frame is kept. Every point has a slot: 0 for a single marker, the marker index
+// on a board. A point is committed only if it held still, its variance is kept for the fit.
+class PointAverager {
+
+    const int WINDOW = 15;                  // frames
+    const int MIN_SAMPLES = 10;             // frames a point should be seen in
+    const double MAX_UV_VARIANCE = 0.5;     // in pixel^2
+    const double MAX_DEPTH_VARIANCE = 1.0;  // in cm^2
+
+public:
+    struct Point{
+        Point2f uv;         // mean in pixel ( cam )
+        Point3f xyz;        // mean in cm
+        Point3f variance;   // of u, v (pixel^2) and z (cm^2)
+    };
+
+    PointAverager();
+
+    void start(int slots);
+    void cancel();
+    bool active() const { return frames < WINDOW; }
+    int size() const { return (int)slots.size(); }
+
+    void add(int slot, Point2f uv, Point3f xyz);
+    // Called after the points of a frame are added, true when the window is complete
+    bool endFrame();
+    int samples(int slot) const { return slots[slot].z.count; } // frames the slot is seen in
+    // Mean and variance of a slot, false if it is not seen often enough or it moved
+    bool result(int slot, Point &point) const;
+
+private:
+    struct RunningStats{
+        int count = 0;
+        double mean = 0, m2 = 0;
+        void add(double x);
+        double variance() const { return count > 1 ? m2 / (count - 1) : 0; }
+    };
+    struct Accumulator{
+        RunningStats u, v, x, y, z;
+    };
+
+    vector<Accumulator> slots;
+    int frames;
+};
@@ -0,0 +1,36 @@
+#pragma once
+
+#include "opencv2/opencv.hpp"
+
+using namespace std;
+using namespace cv;
+
+// Camera pixel and depth to projector pixel with the fitted calibration: a scale and an offset
+// per axis minus a shift which decays exponentially with the depth, a * exp(b * depth).
+// The shifts are tabulated per millimeter in Q16 fixed point, so a point needs two
+// multiplications and a table lookup per axis. Deeper points use the float path.
+class ProjectorMapping {
+
+    const int SHIFT = 16;               // fraction bits of the fixed point mapping
+    const int DEPTHS = 8192;            // shifts are tabulated per millimeter up to the range of DEPTH16
+    const double MAX_SHIFT = 16384;     // in pro. pixel, keeps the fixed point sums in 32 bits
+
+public:
+    ProjectorMapping();
+
+    // scale in pro. pixel per camera pixel, offset in pro. pixel,
+    // coefficients a and b of the x shift, then of the y shift, with depth in cm
+    void create(Point2d scale, Point2d offset, Vec4d coefficients);
+    // Table size in bytes
+    size_t tableBytes() const { return (xShift.size() + yShift.size()) * sizeof(int); }
+
+    // depth in cm, the result is not clipped to the projector
+    Point2i map(Point2i pixel, float depth) const;
+    Point2i mapFloat(Point2i pixel, float depth) const; // without the table
+
+private:
+    Point2d scale, offset;
+    Vec4d coefficients;
+    int xScaleFixed = 0, yScaleFixed = 0, xOffsetFixed = 0, yOffsetFixed = 0;
+    vector<int> xShift, yShift; // indexed by depth in mm
+};
@@ -0,0 +1,38 @@
+#pragma once
+
+#include "opencv2/opencv.hpp"
+#include "Segmenter.h"
+
+using namespace std;
+using namespace cv;
+
+// Coarse-to-fine retro detection. The gray image is max-pooled, so a single bright pixel keeps
+// its cell above the threshold, and the coarse blobs give the regions which are segmented at
+// full resolution. Overlapping regions are merged, every blob is found whole in one region.
+class PyramidDetector {
+
+    const int FACTOR = 4;               // coarse pixel = FACTOR x FACTOR full resolution pixels
+
+public:
+    PyramidDetector();
+
+    void detect(const Mat &gray, int threshold, vector<Blob> &blobs, int step = 1);
+    void setSuppression(const uint32_t *bits, int words); // see Segmenter, coarse regions are not suppressed
+
+    // Packed retro mask of the whole frame before suppression, like Segmenter::packedMask.
+    // It is assembled from the regions, so only detections with step 1 fill it.
+    const vector<uint32_t>& packedMask() const { return mask; }
+    int packedWords() const { return maskWords; }
+
+private:
+    void maxPool(const Mat &gray);
+    void findRegions(Size size);
+    void copyMask(const Rect &region);
+
+    Segmenter coarseSegmenter, fineSegmenter;
+    Mat coarse; // CV_16UC1
+    vector<Blob> coarseBlobs, regionBlobs;
+    vector<Rect> regions;
+    vector<uint32_t> mask;  // 1 bit per pixel of the frame, maskWords per row
+    int maskWords = 0;
+};
@@ -0,0 +1,70 @@
+#pragma once
+
+#include "opencv2/opencv.hpp"
+#include "ThreadPool.h"
+
+using namespace std;
+using namespace cv;
+
+// 8-connected component of the pixels above the retro threshold
+struct Blob {
+    Rect bbox;
+    int area = 0;       // in pixel
+    Point2f centroid;
+    int peak = 0;       // max gray value
+};
+
+// Finds the blobs of a 16-bit gray image. The parallel path splits the image into horizontal
+// stripes, packs each row of a stripe into a 1 bit per pixel mask, reads the foreground runs from
+// the mask and labels them concurrently. Components crossing stripe borders are merged with
+// union-find. The serial path gives the same blobs with OpenCV.
+class Segmenter {
+
+    const int MIN_STRIPE_ROWS = 16;
+
+public:
+    struct Run {
+        int row, start, end; // end is exclusive
+        int peak;
+    };
+
+    Segmenter();
+
+    // step > 1 looks at every step-th row and column only, blobs are scaled back to full resolution
+    void segment(const Mat &gray, int threshold, vector<Blob> &blobs, int step = 1);
+    void segmentSerial(const Mat &gray, int threshold, vector<Blob> &blobs);
+
+    // Stripes of the parallel path, 0 takes one per thread of the pool. Stripes have at least
+    // MIN_STRIPE_ROWS rows, so small images get fewer.
+    void setStripes(int count) { stripeCount = count; }
+
+    // Pixels set in the packed mask are never foreground. The mask covers the whole image at full
+    // resolution, gray can be a region of it. nullptr disables the suppression.
+    void setSuppression(const uint32_t *bits, int words);
+
+    // Packed retro mask of the last segmentation before suppression, packedWords() per row
+    const vector<uint32_t>& packedMask() const { return mask; }
+    int packedWords() const { return maskWords; }
+
+private:
+    struct Stripe {
+        int firstRow, lastRow;      // [firstRow, lastRow)
+        vector<Run> runs;
+        vector<int> rowStart;       // index of the first run of each row, one more for the end
+        vector<int> parent;         // local union-find
+        vector<uint32_t> rowBits;   // row of the mask after suppression
+    };
+
+    void extractRuns(const Mat &gray, int threshold, int step, Point offset, Stripe &stripe);
+    void suppressRow(uint32_t *bits, int cols, int step, int row, int column) const;
+    void labelStripe(Stripe &stripe);
+
+    vector<Stripe> stripes;
+    vector<int> parent;             // global union-find over the runs of all stripes
+    vector<int> blobIndex;
+    vector<uint32_t> mask;          // 1 bit per pixel of the (decimated) image, maskWords per row
+    int maskWords = 0;
+    int stripeCount = 0;
+    const uint32_t *suppression = nullptr;
+    int suppressionWords = 0;
+};
@@ -0,0 +1,56 @@
+#pragma once
+
+#include <royale/ICameraDevice.hpp>
+#include <jni.h>
+#include <map>
+#include <memory>
+#include <mutex>
+#include "Calibrator.h"
+#include "UseCaseSelector.h"
+
+using namespace royale;
+using namespace std;
+
+// One camera / projector pair. It owns its camera device, listener and calibration,
+// its frames go through the pipeline threads of the listener and its loops use the shared pool.
+class Session {
+
+public:
+    Session();
+    ~Session();
+
+    // Opens the first camera behind the usb descriptor, returns false if there is none
+    bool open(int fd, int vid, int pid, uint16_t &width, uint16_t &height);
+    void registerCallback(JNIEnv *env, jobject thiz);
+    void release(JNIEnv *env); // deletes the java references
+    bool startCapture();
+    bool stopCapture();
+    void changeMode(int mode);
+    void loadCalibration(const double* arr);
+
+    Calibrator calibrator; // It is a child of IDepthDataListener
+
+private:
+    void selectStreams();
+
+    std::unique_ptr<ICameraDevice> cameraDevice;
+    UseCaseSelector useCaseSelector;
+    vector<double> calibration;
+    int registeredStreams = 0;
+    int currentMode = 0;
+    bool capturing = false;
+};
+
+// Sessions are referred from java side with integer handles. A session which is destroyed
+// while a call still holds it is deleted when that call releases it.
+class SessionRegistry {
+
+public:
+    static int create();
+    static shared_ptr<Session> get(int handle); // nullptr if there is no such session
+    static void destroy(JNIEnv *env, int handle);
+
+private:
+    static mutex& registryMutex();
+    static map<int, shared_ptr<Session>>& sessions();
+};
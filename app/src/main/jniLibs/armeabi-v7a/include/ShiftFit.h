@@ -0,0 +1,29 @@
+#pragma once
+
+#include "opencv2/opencv.hpp"
+
+using namespace std;
+using namespace cv;
+
+// Fits the shift between the camera and the projector, shift = c * e^(a * depth) per axis, on
+// ln(shift) weighted by the inverse variance of ln(shift). The shift keeps its sign over the depths
+// of a setup; noise can flip the sign of a small one, such points are not on the curve and are
+// left out instead of being mirrored onto it.
+class ShiftFit {
+
+public:
+    struct Sample{
+        double depth;       // in cm
+        Point2d shift;      // in pro. pixel
+        Point2d variance;   // of the shift in pro. pixel^2
+    };
+
+    // One sample with the mean depth and shift of the given ones and the spread of their shifts
+    // as its variance, so the pixels of a scan weigh as much as a single point at their depth
+    static Sample merge(const vector<Sample> &samples);
+    // { cx, ax, cy, ay }
+    static Vec4d fit(const vector<Sample> &samples);
+    // {c, a}, zero if less than two points have the sign of the most
+    static pair<double, double> fitExponential(const vector<double> &x, const vector<double> &y,
+                                               const vector<double> &variance);
+};
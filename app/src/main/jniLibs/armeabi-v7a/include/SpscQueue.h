@@ -0,0 +1,41 @@
+#pragma once
+
+#include <atomic>
+
+using namespace std;
+
+// Lock-free ring of frame slot indices between two pipeline stages.
+// Only one thread may push and only one thread may pop.
+template <int CAPACITY>
+class SpscQueue {
+
+    static_assert((CAPACITY & (CAPACITY - 1)) == 0, "indices wrap around, capacity should be a power of two");
+
+public:
+    // Returns false if the queue is full, producer only
+    bool push(int value)
+    {
+        unsigned t = tail.load(memory_order_relaxed);
+        if(t - head.load(memory_order_acquire) == CAPACITY) return false;
+        items[t % CAPACITY] = value;
+        tail.store(t + 1, memory_order_release);
+        return true;
+    }
+
+    // Returns false if the queue is empty, consumer only
+    bool pop(int &value)
+    {
+        unsigned h = head.load(memory_order_relaxed);
+        if(h == tail.load(memory_order_acquire)) return false;
+        value = items[h % CAPACITY];
+        head.store(h + 1, memory_order_release);
+        return true;
+    }
+
+    int size() const { return (int)(tail.load(memory_order_acquire) - head.load(memory_order_acquire)); }
+    bool empty() const { return size() == 0; }
+
+private:
+    int items[CAPACITY];
+    atomic<unsigned> head {0}, tail {0};
+};
@@ -0,0 +1,43 @@
+#pragma once
+
+#include <cstdint>
+#include <vector>
+
+using namespace std;
+
+// Bright pixels which do not move, e.g. fixed reflectors and hot pixels. It is learned as the
+// AND of the packed retro masks of the first frames, grown by one pixel for their flickering
+// edges, and excluded from segmentation. Afterwards pixels which stay dark for a whole update
+// window are removed incrementally. New static pixels are only added by learning again, so a
+// marker held still is never learned into the background.
+class StaticMask {
+
+    const int LEARN_FRAMES = 60;    // about two seconds of capture
+    const int UPDATE_FRAMES = 300;
+
+public:
+    StaticMask();
+
+    void reset(); // learns again from the next frames
+    bool learning() const { return state == LEARNING; }
+
+    // Called with the packed retro mask of a full resolution frame, before suppression
+    void update(const vector<uint32_t> &frameMask, int rows, int words);
+
+    // Packed mask of the suppressed pixels in the same layout, nullptr if nothing is learned yet
+    const uint32_t* bits() const;
+    int words() const { return rowWords; }
+
+private:
+    enum State {LEARNING, ACTIVE};
+
+    void grow();
+    static int count(const vector<uint32_t> &mask);
+
+    State state = LEARNING;
+    vector<uint32_t> core;          // static pixels
+    vector<uint32_t> suppressed;    // core grown by one pixel
+    vector<uint32_t> accumulator;   // bright in every learning frame / dark in every update frame
+    int rows = 0, rowWords = 0;
+    int frames = 0;
+};
@@ -0,0 +1,65 @@
+#pragma once
+
+#include "opencv2/opencv.hpp"
+
+using namespace std;
+using namespace cv;
+
+// Patterns of a structured light scan and their decoder, it finds the projector coordinate
+// seen by every camera pixel. The sequence is a white and a black reference, then per axis
+// a Gray code down to half of the phase period and four sinusoids shifted by a quarter period.
+// The Gray code gives the half period a pixel is in, the phase gives the position inside the
+// period; a Gray bit decoded wrong at a stripe edge is corrected by the phase.
+// Frames are accumulated as they come, every Gray bit is kept as a plane of 1 bit per pixel.
+// It needs only OpenCV, so it can be run on the host against synthetic renders.
+class StructuredLight {
+
+    const int MIN_PERIOD = 8;               // in camera pixel, of the sinusoid
+    const int PHASE_STEPS = 4;
+    const int MIN_CONTRAST = 20;            // gray difference of the white and black references
+    const float MIN_MODULATION = 0.25f;     // amplitude of the sinusoid relative to the contrast
+
+public:
+    StructuredLight();
+
+    // footprint is the size of a camera pixel on the projector, in pro. pixel
+    void create(Size projector, Size camera, Point2f footprint);
+    bool ready() const { return patterns() > 0; }
+    int patterns() const;
+    Size projectorSize() const { return projector; }
+
+    // CV_8UC1 image of the pattern, projector sized
+    void render(int index, Mat &pattern) const;
+
+    // Clears the accumulated frames for a new scan
+    void start();
+    // Adds a CV_16UC1 gray image captured while the pattern is shown, the patterns are added in order
+    void add(int index, const Mat &gray);
+    // Called after the last frame of a pattern is added
+    void endPattern(int index);
+
+    // Projector coordinates seen by the camera pixels, CV_32FC2 with (-1,-1) where nothing is
+    // decoded. Returns the number of decoded pixels.
+    int decode(Mat &coordinates) const;
+
+private:
+    enum Kind {WHITE, BLACK, GRAY_CODE, PHASE};
+    struct Axis{
+        int period = 0;     // in pro. pixel, a power of 2
+        int bits = 0;       // of the Gray code of the half periods
+        int first = 0;      // index of the first Gray code pattern
+        vector<uint32_t> planes; // Gray code bits, 'bits' planes of rows * words
+        Mat cosSum, sinSum; // CV_32SC1, phase steps weighted by cos and sin of their shift
+    };
+
+    Kind kindOf(int index, int &axis, int &step) const;
+    void decodeAxis(const Axis &a, int length, int channel, uint32_t *valid, Mat &coordinates) const;
+
+    Size projector, camera;
+    Axis axes[2]; // x, y
+    int words = 0; // of a plane row
+    Mat sum; // CV_32SC1, frames of the current pattern
+    int frames = 0;
+    Mat white, black, threshold; // CV_16UC1
+    vector<uint32_t> contrast; // pixels whose references differ enough
+};
@@ -0,0 +1,41 @@
+#pragma once
+
+#include "opencv2/opencv.hpp"
+
+using namespace cv;
+
+// Running average of depth and confidence per pixel against the ToF noise. Depth is kept in
+// quarter millimetres in 16 bits, confidence in 8 bits. A sample below the confidence gate does
+// not change the average, a sample far from it (motion) restarts it. The first sample after a
+// reset seeds depth and confidence. It is applied to each row right after the row is ingested,
+// while the row is still in the cache.
+class TemporalFilter {
+
+    static const int SCALE = 4000;          // state units per meter
+    static const int ALPHA_SHIFT = 2;       // new = old + (sample - old) / 4, rounded
+    static const int MIN_CONFIDENCE = 64;
+    static const int MOTION = 30 * SCALE / 1000; // 30 mm
+
+public:
+    TemporalFilter();
+
+    void create(int width, int height);
+    void reset(); // forgets the history, e.g. after the image is flipped
+
+    // Filters the ingested row y in place, rows can be filtered in parallel
+    void filterRow(int y, Vec3f *xyz, uint8_t *confidence, int width);
+    // Same for a row of a compact frame, depth in millimeters
+    void filterRow(int y, uint16_t *depth, uint8_t *confidence, int width);
+
+private:
+    // delta / 2^ALPHA_SHIFT rounded to the nearest, halves away from zero. A shift alone rounds
+    // negative deltas down and biases the average low.
+    static int step(int delta)
+    {
+        const int half = 1 << (ALPHA_SHIFT - 1);
+        return delta >= 0 ? (delta + half) >> ALPHA_SHIFT : -((half - delta) >> ALPHA_SHIFT);
+    }
+
+    Mat depthState;      // CV_16UC1, 0 if there is no average yet
+    Mat confidenceState; // CV_8UC1
+};
@@ -0,0 +1,54 @@
+#pragma once
+
+#include <atomic>
+#include <condition_variable>
+#include <deque>
+#include <functional>
+#include <memory>
+#include <mutex>
+#include <thread>
+#include <vector>
+
+using namespace std;
+
+// Work stealing task pool shared by all sessions, one thread per core.
+// Every worker has its own deque: it takes its newest task first and steals the oldest
+// task of the others when it runs out. Tasks come only from parallelFor, whose caller waits
+// for them, so the queues cannot pile up.
+class ThreadPool {
+
+public:
+    explicit ThreadPool(int threads = 0); // 0: number of cores
+    ~ThreadPool();
+
+    // Calls fn(from, to) for chunks of [begin, end) with at least grain items and returns when all
+    // are done. The calling thread runs chunks too, so it can be called from a task of the pool.
+    void parallelFor(int begin, int end, int grain, const function<void(int, int)> &fn);
+
+    // Tasks run in order on the calling thread, results are reproducible
+    void setDeterministic(bool d) { deterministic = d; }
+    int size() const { return (int)threads.size(); }
+
+    // Pool which is shared by the sessions
+    static ThreadPool& shared();
+
+private:
+    struct Queue{
+        deque<function<void()>> tasks;
+        mutex queueMutex;
+    };
+
+    void push(function<void()> task);
+    bool runOne(int self);
+    int currentIndex() const; // index of the calling worker, -1 for other threads
+    void run(int index);
+
+    vector<unique_ptr<Queue>> queues;
+    vector<thread> threads;
+    atomic<int> queued {0};
+    atomic<unsigned> nextQueue {0};
+    mutex sleepMutex;
+    condition_variable sleepCond;
+    bool stopping = false;
+    atomic<bool> deterministic {false};
+};
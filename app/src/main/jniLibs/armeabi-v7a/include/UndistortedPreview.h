@@ -0,0 +1,36 @@
+#pragma once
+
+#include "opencv2/opencv.hpp"
+#include <cstdint>
+
+using namespace std;
+using namespace cv;
+
+// GRAY preview without the lens distortion. The bilinear remap is tabulated in fixed point once
+// per lens, then remap, normalization, the retro highlight and the ARGB packing are done in a
+// single pass over the rows on the shared pool.
+class UndistortedPreview {
+
+    static const int WEIGHT_BITS = 5; // fraction bits of the bilinear weights
+    static const int WEIGHT_ONE = 1 << WEIGHT_BITS;
+
+public:
+    UndistortedPreview();
+
+    void create(const Mat &cameraMatrix, const Mat &distortion, Size size);
+    bool ready() const { return !taps.empty(); }
+
+    // gray is a continuous CV_16UC1 of the size given to create, argb is CV_32SC1 ARGB_8888.
+    // Pixels whose top left source pixel is set in retro (CV_8UC1 of the same size) are painted
+    // magenta like the distorted preview.
+    void render(const Mat &gray, const Mat &retro, Mat &argb) const;
+
+private:
+    struct Tap{
+        int32_t index;  // of the top left source pixel, -1 if it falls outside of the image
+        uint8_t wx, wy; // weights of the right and the lower neighbours
+    };
+
+    vector<Tap> taps; // one per preview pixel
+    Size size;
+};
@@ -0,0 +1,53 @@
+#pragma once
+
+#include <royale/ICameraDevice.hpp>
+#include <atomic>
+#include <map>
+#include <mutex>
+#include <thread>
+
+using namespace royale;
+using namespace std;
+
+class CamListener;
+
+// Measures the per frame cost of the pipeline for every use case of the camera and
+// activates the use case with the highest frame rate which can be processed without drops.
+// Probing is done on its own thread, since the use case cannot be changed in the data callback.
+class UseCaseSelector {
+
+    const double BUDGET_RATIO = 0.8;       // processing may use this ratio of the frame period
+    const double MIN_RECEIVED_RATIO = 0.9; // of the expected frames, less means the camera drops
+    const int SETTLE_MS = 500;             // wait after a use case change before measuring
+    const int PROBE_MS = 1500;
+
+public:
+    UseCaseSelector();
+    ~UseCaseSelector();
+
+    // Selects the use case for the mode, probes the camera in background if the mode is not probed before.
+    // Capture should be running.
+    void select(ICameraDevice* device, CamListener* listener, int mode);
+    void cancel(); // stops a running probe and waits for it
+    void setExposureTime(uint32_t time);
+
+    // Frame rate which a use case is run at, given the frames received and their mean cost in us
+    // during a probe. 0 if the camera dropped frames or nothing was measured.
+    uint16_t frameRateFor(uint16_t maxFrameRate, int frames, int64_t meanCost) const;
+
+private:
+    struct Choice{
+        royale::String useCase;
+        uint16_t frameRate;
+    };
+
+    void probe(ICameraDevice* device, CamListener* listener, int mode);
+    bool apply(ICameraDevice* device, CamListener* listener, const Choice &choice);
+    bool waitFor(int ms); // false if cancelled
+
+    map<int, Choice> choices; // mode -> selected use case
+    mutex choiceMutex;
+    thread worker;
+    atomic<bool> cancelled;
+    atomic<uint32_t> exposureTime;
+};
@@ -0,0 +1,72 @@
+#include "Check.h"
+#include "AdaptiveThreshold.h"
+#include <vector>
+
+using namespace std;
+
+static const int BINS = 256, SHIFT = 4;
+
+// Histogram of ambient pixels in one bin and two brighter groups
+static vector<int> histogram(int ambientBin, int ambient, int brightBin, int bright, int retroBin, int retro)
+{
+    vector<int> hist(BINS, 0);
+    hist[ambientBin] += ambient;
+    hist[brightBin] += bright;
+    hist[retroBin] += retro;
+    return hist;
+}
+
+static int total(const vector<int> &hist)
+{
+    int sum = 0;
+    for(int count : hist) sum += count;
+    return sum;
+}
+
+static int converge(AdaptiveThreshold &threshold, const vector<int> &hist)
+{
+    for(int i = 0; i < 30; i++) threshold.update(hist.data(), BINS, SHIFT, total(hist));
+    return threshold.get();
+}
+
+int main()
+{
+    // dark room: the tail holds bright ambient pixels (bin 20, gray 320..335) and retro
+    // pixels (bin 150, gray 2400..2415). Otsu splits them right above the ambient pixels.
+    vector<int> room = histogram(2, 9000, 20, 800, 150, 200);
+    AdaptiveThreshold fromAbove(1000);
+    int threshold = converge(fromAbove, room);
+    CHECK(threshold > 335 && threshold < 2400);
+    CHECK(threshold <= 336 * 1.1);
+    AdaptiveThreshold fromBelow(150);
+    threshold = converge(fromBelow, room);
+    CHECK(threshold > 335 * 0.9 && threshold <= 336);
+
+    // one step goes half way
+    AdaptiveThreshold stepped(1000);
+    CHECK(stepped.update(room.data(), BINS, SHIFT, total(room)) == 1000 - (1000 - 336) / 2);
+
+    // hysteresis: a change within 10% is ignored, a larger one is followed
+    AdaptiveThreshold close(360);
+    CHECK(close.update(room.data(), BINS, SHIFT, total(room)) == 360);
+    AdaptiveThreshold far(400);
+    CHECK(far.update(room.data(), BINS, SHIFT, total(room)) == 400 - (400 - 336) / 2);
+
+    // no retro pixels in a dark frame: the floor holds
+    vector<int> dark = histogram(1, 9000, 2, 900, 3, 100);
+    AdaptiveThreshold floor(1000);
+    threshold = converge(floor, dark);
+    CHECK(threshold >= 150 && threshold <= 165);
+
+    // bright ambient light: at least three times the median
+    vector<int> bright = histogram(40, 9000, 42, 500, 200, 500);
+    AdaptiveThreshold ambient(500);
+    threshold = converge(ambient, bright);
+    CHECK(threshold >= 40 * 16 * 3 * 0.9 && threshold <= 40 * 16 * 3);
+
+    // an empty histogram keeps the threshold
+    vector<int> empty(BINS, 0);
+    AdaptiveThreshold kept(777);
+    CHECK(kept.update(empty.data(), BINS, SHIFT, 0) == 777);
+    return checkFailures;
+}
@@ -0,0 +1,88 @@
+#include "Check.h"
+#include "AutoCapture.h"
+
+// Feeds a blob holding still at uv and depth, returns the frame a capture is signalled in, -1 if none
+static int hold(AutoCapture &capture, Point2i uv, float depth, int frames = 20)
+{
+    for(int i = 0; i < frames; i++){
+        if(capture.update(true, uv, depth)) return i;
+    }
+    return -1;
+}
+
+int main()
+{
+    AutoCapture capture;
+
+    // out of the buckets
+    CHECK(capture.bucketOf(29.9f) == -1);
+    CHECK(capture.bucketOf(30.0f) == 0);
+    CHECK(capture.bucketOf(149.9f) == 11);
+    CHECK(capture.bucketOf(150.0f) == -1);
+    // nothing sampled, the middle of the range is asked first
+    CHECK(capture.neededDepth() == 95);
+
+    // a blob is taken on its tenth still frame
+    CHECK(hold(capture, Point2i(100, 100), 65.0f) == 9);
+    // jitter within the still distance does not restart the count
+    capture.reset();
+    for(int i = 0; i < 9; i++) CHECK(!capture.update(true, Point2i(100 + i % 3, 100), 65.0f + 0.1f * (i % 2)));
+    CHECK(capture.update(true, Point2i(101, 100), 65.0f));
+    // a move, a depth step or a lost blob restarts it
+    capture.reset();
+    for(int i = 0; i < 5; i++) capture.update(true, Point2i(100, 100), 65.0f);
+    capture.update(true, Point2i(104, 100), 65.0f);
+    CHECK(hold(capture, Point2i(104, 100), 65.0f) == 8);
+    capture.reset();
+    for(int i = 0; i < 5; i++) capture.update(true, Point2i(100, 100), 65.0f);
+    capture.update(true, Point2i(100, 100), 67.0f);
+    CHECK(hold(capture, Point2i(100, 100), 67.0f) == 8);
+    capture.reset();
+    for(int i = 0; i < 5; i++) capture.update(true, Point2i(100, 100), 65.0f);
+    capture.update(false, Point2i(100, 100), 65.0f);
+    CHECK(hold(capture, Point2i(100, 100), 65.0f) == 9);
+    // out of range depths are not taken
+    capture.reset();
+    CHECK(hold(capture, Point2i(100, 100), 20.0f) == -1);
+
+    // the pose of a saved point is not taken again until the marker moves
+    capture.reset();
+    CHECK(hold(capture, Point2i(100, 100), 65.0f) == 9);
+    capture.finish(true);
+    capture.add(0, 65.0f);
+    CHECK(hold(capture, Point2i(100, 100), 65.0f) == -1);
+    CHECK(hold(capture, Point2i(110, 100), 65.0f) == 9);
+    // a rejected point leaves the pose open, it is taken again after holding still
+    capture.reset();
+    CHECK(hold(capture, Point2i(100, 100), 65.0f) == 9);
+    capture.finish(false);
+    CHECK(hold(capture, Point2i(100, 100), 65.0f) == 9);
+    capture.finish(true);
+    CHECK(hold(capture, Point2i(100, 100), 65.0f) == -1);
+
+    // a bucket ahead of another visited bucket waits for it
+    capture.reset();
+    capture.add(0, 45.0f);
+    capture.add(1, 45.0f);
+    CHECK(hold(capture, Point2i(100, 100), 35.0f) == 9); // visits the empty bucket
+    capture.finish(false);
+    CHECK(hold(capture, Point2i(200, 100), 45.0f) == -1);
+    capture.add(2, 35.0f);
+    capture.add(3, 35.0f);
+    CHECK(hold(capture, Point2i(200, 100), 45.0f) == 0); // the blob held still already
+    // a full bucket takes no more points
+    capture.reset();
+    for(int i = 0; i < 3; i++) capture.add(i, 45.0f);
+    CHECK(hold(capture, Point2i(100, 100), 45.0f) == -1);
+
+    // the least sampled bucket next to the sampled depths is asked, none when five are full
+    capture.reset();
+    for(int i = 0; i < 3; i++) capture.add(i, 45.0f);
+    CHECK(capture.neededDepth() == 35 || capture.neededDepth() == 55);
+    for(int b = 0; b < 5; b++){
+        for(int i = 0; i < 3; i++) capture.add(3 * b + i, 30.0f + 10.0f * b + 5.0f);
+    }
+    CHECK(capture.neededDepth() == -1);
+
+    return checkFailures;
+}
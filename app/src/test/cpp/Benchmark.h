@@ -0,0 +1,54 @@
+#pragma once
+
+#include <algorithm>
+#include <chrono>
+#include <cstdio>
+#include <vector>
+
+// Median time of one run in microseconds, after a few warm up runs
+template <typename F>
+double measure(F run, int runs = 200)
+{
+    for(int i = 0; i < 5; i++) run();
+    std::vector<double> times(runs);
+    for(int i = 0; i < runs; i++)
+    {
+        auto start = std::chrono::steady_clock::now();
+        run();
+        times[i] = std::chrono::duration<double, std::micro>(std::chrono::steady_clock::now() - start).count();
+    }
+    std::nth_element(times.begin(), times.begin() + runs / 2, times.end());
+    return times[runs / 2];
+}
+
+// Median ratio of the time of a case to the time of its baseline. The two are run in turns, so
+// a machine whose speed drifts during the benchmark affects both alike.
+template <typename B, typename C>
+double measureRatio(B baseline, C candidate, int runs = 400)
+{
+    for(int i = 0; i < 5; i++){
+        baseline();
+        candidate();
+    }
+    std::vector<double> ratios(runs);
+    for(int i = 0; i < runs; i++)
+    {
+        auto start = std::chrono::steady_clock::now();
+        baseline();
+        auto middle = std::chrono::steady_clock::now();
+        candidate();
+        auto end = std::chrono::steady_clock::now();
+        ratios[i] = std::chrono::duration<double>(end - middle).count() / std::chrono::duration<double>(middle - start).count();
+    }
+    std::nth_element(ratios.begin(), ratios.begin() + runs / 2, ratios.end());
+    return ratios[runs / 2];
+}
+
+// Prints the time of a case and its ratio to the baseline
+inline void report(const char *name, double micros, double baseline)
+{
+    printf("%-40s %9.1f us %7.2fx\n", name, micros, micros / baseline);
+}
+
+// Results are written here so that the compiler keeps the measured work
+static volatile int benchmarkSink;
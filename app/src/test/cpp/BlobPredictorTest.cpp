@@ -0,0 +1,48 @@
+#include "Check.h"
+#include "BlobPredictor.h"
+
+static const Size PROJECTOR(1280, 720);
+static const int64_t FRAME = 22222; // 45 fps, in us
+
+int main()
+{
+    BlobPredictor predictor;
+
+    // the first frame has no velocity, the centers are kept
+    vector<int> centers = {100, 200, 600, 400};
+    predictor.predict(centers, FRAME, 40000, PROJECTOR);
+    CHECK(centers == vector<int>({100, 200, 600, 400}));
+
+    // 10 and -5 pro. pixel per frame, moved forward by the latency of two frames
+    centers = {110, 195, 600, 400};
+    predictor.predict(centers, 2 * FRAME, 2 * FRAME, PROJECTOR);
+    CHECK(abs(centers[0] - 130) <= 1 && abs(centers[1] - 185) <= 1);
+    CHECK(centers[2] == 600 && centers[3] == 400); // still blob
+
+    // the velocity comes from the measured centers, not from the predicted ones
+    centers = {120, 190, 600, 400};
+    predictor.predict(centers, 3 * FRAME, FRAME, PROJECTOR);
+    CHECK(abs(centers[0] - 130) <= 1 && abs(centers[1] - 185) <= 1);
+
+    // a jump beyond the match distance is a new blob, it is not extrapolated
+    centers = {300, 190, 600, 400};
+    predictor.predict(centers, 4 * FRAME, FRAME, PROJECTOR);
+    CHECK(centers[0] == 300 && centers[1] == 190);
+
+    // predictions stay on the projector
+    centers = {1270, 10};
+    predictor.reset();
+    predictor.predict(centers, 5 * FRAME, FRAME, PROJECTOR);
+    centers = {1278, 2};
+    predictor.predict(centers, 6 * FRAME, 10 * FRAME, PROJECTOR);
+    CHECK(centers[0] == PROJECTOR.width && centers[1] == 0);
+
+    // without latency or after a reset nothing is moved
+    predictor.reset();
+    centers = {500, 500};
+    predictor.predict(centers, 7 * FRAME, FRAME, PROJECTOR);
+    centers = {510, 500};
+    predictor.predict(centers, 8 * FRAME, 0, PROJECTOR);
+    CHECK(centers[0] == 510 && centers[1] == 500);
+    return checkFailures;
+}
@@ -0,0 +1,78 @@
+#pragma once
+
+#include <royale/ICameraDevice.hpp>
+
+using namespace royale;
+
+// Camera device of the host tests, every call fails with NOT_IMPLEMENTED. A test overrides the
+// calls its code under test makes.
+class CameraStub : public ICameraDevice {
+
+public:
+    CameraStatus initialize () override { return CameraStatus::NOT_IMPLEMENTED; }
+    CameraStatus getId (royale::String &id) const override { return CameraStatus::NOT_IMPLEMENTED; }
+    CameraStatus getCameraName (royale::String &cameraName) const override { return CameraStatus::NOT_IMPLEMENTED; }
+    CameraStatus getCameraInfo (royale::Vector<royale::Pair<royale::String, royale::String>> &camInfo) const override { return CameraStatus::NOT_IMPLEMENTED; }
+    CameraStatus setUseCase (const royale::String &name) override { return CameraStatus::NOT_IMPLEMENTED; }
+    CameraStatus getUseCases (royale::Vector<royale::String> &useCases) const override { return CameraStatus::NOT_IMPLEMENTED; }
+    CameraStatus getStreams (royale::Vector<royale::StreamId> &streams) const override { return CameraStatus::NOT_IMPLEMENTED; }
+    CameraStatus getNumberOfStreams (const royale::String &name, uint32_t &nrStreams) const override { return CameraStatus::NOT_IMPLEMENTED; }
+    CameraStatus getCurrentUseCase (royale::String &useCase) const override { return CameraStatus::NOT_IMPLEMENTED; }
+    CameraStatus setExposureTime (uint32_t exposureTime, royale::StreamId streamId) override { return CameraStatus::NOT_IMPLEMENTED; }
+    CameraStatus setExposureMode (royale::ExposureMode exposureMode, royale::StreamId streamId) override { return CameraStatus::NOT_IMPLEMENTED; }
+    CameraStatus getExposureMode (royale::ExposureMode &exposureMode, royale::StreamId streamId) const override { return CameraStatus::NOT_IMPLEMENTED; }
+    CameraStatus getExposureLimits (royale::Pair<uint32_t, uint32_t> &exposureLimits, royale::StreamId streamId) const override { return CameraStatus::NOT_IMPLEMENTED; }
+    CameraStatus registerDataListener (royale::IDepthDataListener *listener) override { return CameraStatus::NOT_IMPLEMENTED; }
+    CameraStatus unregisterDataListener() override { return CameraStatus::NOT_IMPLEMENTED; }
+    CameraStatus registerDepthImageListener (royale::IDepthImageListener *listener) override { return CameraStatus::NOT_IMPLEMENTED; }
+    CameraStatus unregisterDepthImageListener() override { return CameraStatus::NOT_IMPLEMENTED; }
+    CameraStatus registerSparsePointCloudListener (royale::ISparsePointCloudListener *listener) override { return CameraStatus::NOT_IMPLEMENTED; }
+    CameraStatus unregisterSparsePointCloudListener() override { return CameraStatus::NOT_IMPLEMENTED; }
+    CameraStatus registerIRImageListener (royale::IIRImageListener *listener) override { return CameraStatus::NOT_IMPLEMENTED; }
+    CameraStatus unregisterIRImageListener() override { return CameraStatus::NOT_IMPLEMENTED; }
+    CameraStatus registerEventListener (royale::IEventListener *listener) override { return CameraStatus::NOT_IMPLEMENTED; }
+    CameraStatus unregisterEventListener() override { return CameraStatus::NOT_IMPLEMENTED; }
+    CameraStatus startCapture() override { return CameraStatus::NOT_IMPLEMENTED; }
+    CameraStatus stopCapture() override { return CameraStatus::NOT_IMPLEMENTED; }
+    CameraStatus getMaxSensorWidth (uint16_t &maxSensorWidth) const override { return CameraStatus::NOT_IMPLEMENTED; }
+    CameraStatus getMaxSensorHeight (uint16_t &maxSensorHeight) const override { return CameraStatus::NOT_IMPLEMENTED; }
+    CameraStatus getLensParameters (royale::LensParameters &param) const override { return CameraStatus::NOT_IMPLEMENTED; }
+    CameraStatus isConnected (bool &connected) const override { return CameraStatus::NOT_IMPLEMENTED; }
+    CameraStatus isCalibrated (bool &calibrated) const override { return CameraStatus::NOT_IMPLEMENTED; }
+    CameraStatus isCapturing (bool &capturing) const override { return CameraStatus::NOT_IMPLEMENTED; }
+    CameraStatus getAccessLevel (royale::CameraAccessLevel &accessLevel) const override { return CameraStatus::NOT_IMPLEMENTED; }
+    CameraStatus startRecording (const royale::String &fileName, uint32_t numberOfFrames, uint32_t frameSkip, uint32_t msSkip) override { return CameraStatus::NOT_IMPLEMENTED; }
+    CameraStatus stopRecording() override { return CameraStatus::NOT_IMPLEMENTED; }
+    CameraStatus registerRecordListener (royale::IRecordStopListener *listener) override { return CameraStatus::NOT_IMPLEMENTED; }
+    CameraStatus unregisterRecordListener() override { return CameraStatus::NOT_IMPLEMENTED; }
+    CameraStatus registerExposureListener (royale::IExposureListener *listener) override { return CameraStatus::NOT_IMPLEMENTED; }
+    CameraStatus registerExposureListener (royale::IExposureListener2 *listener) override { return CameraStatus::NOT_IMPLEMENTED; }
+    CameraStatus unregisterExposureListener() override { return CameraStatus::NOT_IMPLEMENTED; }
+    CameraStatus setFrameRate (uint16_t framerate) override { return CameraStatus::NOT_IMPLEMENTED; }
+    CameraStatus getFrameRate (uint16_t &frameRate) const override { return CameraStatus::NOT_IMPLEMENTED; }
+    CameraStatus getMaxFrameRate (uint16_t &maxFrameRate) const override { return CameraStatus::NOT_IMPLEMENTED; }
+    CameraStatus setExternalTrigger (bool useExternalTrigger) override { return CameraStatus::NOT_IMPLEMENTED; }
+    CameraStatus getExposureGroups (royale::Vector< royale::String > &exposureGroups) const override { return CameraStatus::NOT_IMPLEMENTED; }
+    CameraStatus setExposureTime (const String &exposureGroup, uint32_t exposureTime) override { return CameraStatus::NOT_IMPLEMENTED; }
+    CameraStatus getExposureLimits (const String &exposureGroup, royale::Pair<uint32_t, uint32_t> &exposureLimits) const override { return CameraStatus::NOT_IMPLEMENTED; }
+    CameraStatus setExposureTimes (const royale::Vector<uint32_t> &exposureTimes, royale::StreamId streamId) override { return CameraStatus::NOT_IMPLEMENTED; }
+    CameraStatus setExposureForGroups (const royale::Vector<uint32_t> &exposureTimes) override { return CameraStatus::NOT_IMPLEMENTED; }
+    CameraStatus setProcessingParameters (const royale::ProcessingParameterVector &parameters, uint16_t streamId) override { return CameraStatus::NOT_IMPLEMENTED; }
+    CameraStatus getProcessingParameters (royale::ProcessingParameterVector &parameters, uint16_t streamId) override { return CameraStatus::NOT_IMPLEMENTED; }
+    CameraStatus registerDataListenerExtended (royale::IExtendedDataListener *listener) override { return CameraStatus::NOT_IMPLEMENTED; }
+    CameraStatus unregisterDataListenerExtended() override { return CameraStatus::NOT_IMPLEMENTED; }
+    CameraStatus setCallbackData (royale::CallbackData cbData) override { return CameraStatus::NOT_IMPLEMENTED; }
+    CameraStatus setCallbackData (uint16_t cbData) override { return CameraStatus::NOT_IMPLEMENTED; }
+    CameraStatus setCalibrationData (const royale::String &filename) override { return CameraStatus::NOT_IMPLEMENTED; }
+    CameraStatus setCalibrationData (const royale::Vector<uint8_t> &data) override { return CameraStatus::NOT_IMPLEMENTED; }
+    CameraStatus getCalibrationData (royale::Vector<uint8_t> &data) override { return CameraStatus::NOT_IMPLEMENTED; }
+    CameraStatus writeCalibrationToFlash() override { return CameraStatus::NOT_IMPLEMENTED; }
+    CameraStatus writeDataToFlash (const royale::Vector<uint8_t> &data) override { return CameraStatus::NOT_IMPLEMENTED; }
+    CameraStatus writeDataToFlash (const royale::String &filename) override { return CameraStatus::NOT_IMPLEMENTED; }
+    CameraStatus setDutyCycle (double dutyCycle, uint16_t index) override { return CameraStatus::NOT_IMPLEMENTED; }
+    CameraStatus writeRegisters (const royale::Vector<royale::Pair<royale::String, uint64_t>> &registers) override { return CameraStatus::NOT_IMPLEMENTED; }
+    CameraStatus readRegisters (royale::Vector<royale::Pair<royale::String, uint64_t>> &registers) override { return CameraStatus::NOT_IMPLEMENTED; }
+    CameraStatus shiftLensCenter (int16_t tx, int16_t ty) override { return CameraStatus::NOT_IMPLEMENTED; }
+    CameraStatus getLensCenter (uint16_t &x, uint16_t &y) override { return CameraStatus::NOT_IMPLEMENTED; }
+    CameraStatus initialize (const royale::String &initUseCase) override { return CameraStatus::NOT_IMPLEMENTED; }
+};
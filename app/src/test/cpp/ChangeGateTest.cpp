@@ -0,0 +1,76 @@
+#include "Check.h"
+#include "ChangeGate.h"
+#include "IngestKernels.h"
+#include <random>
+
+static const int WIDTH = 224, HEIGHT = 172; // pico flexx
+
+// Frame of ambient noise with a square marker, its tile sums are filled by the ingest kernel
+static void ingest(Frame &frame, Point2f marker, int side, mt19937 &random)
+{
+    normal_distribution<float> noise(300, 20);
+    vector<DepthPoint> points(WIDTH * HEIGHT);
+    for(int y = 0; y < HEIGHT; y++){
+        for(int x = 0; x < WIDTH; x++){
+            DepthPoint &p = points[y * WIDTH + x];
+            p.x = p.y = 0;
+            p.z = 1.5f;
+            p.noise = 0;
+            p.depthConfidence = 255;
+            bool retro = x >= marker.x && x < marker.x + side && y >= marker.y && y < marker.y + side;
+            p.grayValue = (uint16_t)(retro ? 2000 : max(0.f, noise(random)));
+        }
+    }
+
+    vector<int> lanes(HIST_LANES * Frame::HIST_BINS, 0), columns(2 * WIDTH);
+    fill(frame.grayHistogram, frame.grayHistogram + Frame::HIST_BINS, 0);
+    for(int ty = 0; ty < frame.tileSums.rows; ty++)
+    {
+        fill(columns.begin(), columns.end(), 0);
+        for(int y = ty * Frame::TILE; y < min((ty + 1) * Frame::TILE, HEIGHT); y++)
+        {
+            IngestRow row;
+            row.xyz = frame.xyzMap.ptr<Vec3f>(y);
+            row.depth = nullptr;
+            row.conf = frame.confMap.ptr<uint8_t>(y);
+            row.gray = frame.grayImage.ptr<uint16_t>(y);
+            row.hist = Frame::histogramRow(y) ? lanes.data() : nullptr;
+            row.columns = columns.data();
+            row.rowWeight = Frame::tileWeight(y);
+            POINT_KERNELS[0][0][1](points.data() + y * WIDTH, WIDTH, row);
+        }
+        reduceTiles(columns.data(), WIDTH, frame.tileSums.ptr<int>(ty));
+    }
+    mergeHistogram(lanes.data(), frame.grayHistogram);
+}
+
+// Whether the gate reuses the second frame after processing the first one
+static bool reused(Point2f first, Point2f second, int side, mt19937 &random)
+{
+    Frame frame;
+    frame.create(WIDTH, HEIGHT);
+    ChangeGate gate;
+    ingest(frame, first, side, random);
+    gate.unchanged(frame.tileSums);
+    gate.accept(frame.tileSums, 0);
+    ingest(frame, second, side, random);
+    return gate.unchanged(frame.tileSums);
+}
+
+int main()
+{
+    mt19937 random(41);
+
+    // sensor noise alone is not a change
+    CHECK(reused(Point2f(100, 50), Point2f(100, 50), 3, random));
+    CHECK(reused(Point2f(100, 50), Point2f(100, 50), 6, random));
+
+    // marker moving to another tile changes the sums
+    CHECK(!reused(Point2f(100, 50), Point2f(120, 50), 3, random));
+
+    // marker moving inside one tile (96..111, 48..63) keeps the sum, the moments change
+    CHECK(!reused(Point2f(100, 50), Point2f(101, 50), 3, random));
+    CHECK(!reused(Point2f(100, 50), Point2f(100, 51), 3, random));
+    CHECK(!reused(Point2f(97, 49), Point2f(105, 57), 6, random));
+    return checkFailures;
+}
@@ -0,0 +1,10 @@
+#pragma once
+
+#include <cstdio>
+
+// Failed checks are printed and counted, a test returns the count from main
+static int checkFailures = 0;
+
+#define CHECK(condition) \
+    do { if(!(condition)) { checkFailures++; \
+        fprintf(stderr, "%s:%d: CHECK(%s) failed\n", __FILE__, __LINE__, #condition); } } while(0)
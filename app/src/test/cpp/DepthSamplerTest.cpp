@@ -0,0 +1,117 @@
+#include "Check.h"
+#include "DepthSampler.h"
+#include <random>
+
+static const int WIDTH = 224, HEIGHT = 172; // pico flexx
+static const float WALL = 1.5f;             // in meters
+static const float NOISE = 0.003f;
+
+// Wall with noise, the blobs are saturated: no depth and no confidence
+static void synthesize(Frame &frame, const vector<Rect> &blobs, mt19937 &random)
+{
+    normal_distribution<float> noise(0, NOISE);
+    uniform_int_distribution<int> confidence(60, 255);
+    for(int y = 0; y < HEIGHT; y++){
+        for(int x = 0; x < WIDTH; x++){
+            float z = WALL + noise(random);
+            frame.xyzMap.at<Vec3f>(y, x) = Vec3f(0, 0, z);
+            frame.depthMap.at<uint16_t>(y, x) = (uint16_t)(z * 1000 + 0.5f);
+            frame.confMap.at<uint8_t>(y, x) = (uint8_t)confidence(random);
+        }
+    }
+    for(const Rect &blob : blobs){
+        frame.xyzMap(blob).setTo(Scalar(0, 0, 0));
+        frame.depthMap(blob).setTo(Scalar(0));
+        frame.confMap(blob).setTo(Scalar(0));
+    }
+}
+
+// The ring sampling before the stride was applied to the loop indices: every ring pixel is
+// visited and every stride-th one is used. Returns z of the weighted median and the count.
+static float reference(const Frame &frame, const Rect &bbox, int &count)
+{
+    Rect image(0, 0, WIDTH, HEIGHT);
+    Rect inner = Rect(bbox.x - 1, bbox.y - 1, bbox.width + 2, bbox.height + 2) & image;
+    Rect outer = Rect(bbox.x - 4, bbox.y - 4, bbox.width + 8, bbox.height + 8) & image;
+    int stride = max(1, (outer.area() - inner.area() + 255) / 256);
+    vector<pair<float, int>> pixels;
+    int index = 0;
+    for(int y = outer.y; y < outer.y + outer.height; y++){
+        for(int x = outer.x; x < outer.x + outer.width; x++){
+            if(inner.contains(Point(x, y))) continue;
+            if(index++ % stride != 0) continue;
+            float z = frame.depthAt(y, x);
+            int conf = frame.confMap.at<uint8_t>(y, x);
+            if(conf >= 50 && z > 0) pixels.push_back(make_pair(z, conf));
+        }
+    }
+    count = (int)pixels.size();
+    if(pixels.empty()) return 0;
+    sort(pixels.begin(), pixels.end(), [](const pair<float, int> &a, const pair<float, int> &b){ return a.first < b.first; });
+    int total = 0;
+    for(auto &p : pixels) total += p.second;
+    int cumulative = 0;
+    for(auto &p : pixels){
+        cumulative += p.second;
+        if(cumulative >= (total + 1) / 2) return p.first;
+    }
+    return pixels.back().first;
+}
+
+int main()
+{
+    mt19937 random(42);
+    // small, large (ring above MAX_SAMPLES), clipped at the corner and at the right border
+    vector<Rect> blobs = {Rect(100, 80, 6, 6), Rect(20, 40, 70, 60), Rect(0, 0, 5, 3), Rect(WIDTH - 3, 120, 3, 8), Rect(150, 20, 1, 1)};
+    Frame frame;
+    frame.create(WIDTH, HEIGHT);
+    Frame compact;
+    compact.create(WIDTH, HEIGHT, true);
+    frame.depthMap.create(frame.grayImage.size(), CV_16UC1);
+    compact.xyzMap.create(frame.grayImage.size(), CV_32FC3);
+    synthesize(frame, blobs, random);
+    frame.depthMap.copyTo(compact.depthMap);
+    frame.confMap.copyTo(compact.confMap);
+    frame.content = Frame::XYZ | Frame::CONFIDENCE;
+    compact.content = Frame::DEPTH | Frame::CONFIDENCE;
+
+    DepthSampler sampler;
+    for(const Rect &blob : blobs)
+    {
+        Point center(blob.x + blob.width / 2, blob.y + blob.height / 2);
+        // the single pixel read at the center has no depth, the ring has the wall
+        CHECK(frame.depthAt(center.y, center.x) == 0);
+        DepthSampler::Sample sample = sampler.estimate(frame, blob);
+        CHECK(sample.count > 0 && sample.count <= 256);
+        CHECK(fabs(sample.xyz.z - WALL) < 3 * NOISE);
+        CHECK(sample.confidence >= 60);
+
+        // the same pixels as visiting the whole ring
+        int count;
+        float z = reference(frame, blob, count);
+        CHECK(sample.count == count);
+        CHECK(sample.xyz.z == z);
+
+        DepthSampler::Sample packed = sampler.estimate(compact, blob);
+        CHECK(packed.count == sample.count);
+        CHECK(fabs(packed.xyz.z - sample.xyz.z) < 0.001f);
+    }
+
+    // where the center is valid, the ring agrees with the single pixel read within the noise
+    synthesize(frame, vector<Rect>(), random);
+    double difference = 0;
+    int centers = 0;
+    for(int y = 10; y < HEIGHT - 10; y += 17){
+        for(int x = 10; x < WIDTH - 10; x += 23){
+            DepthSampler::Sample sample = sampler.estimate(frame, Rect(x - 2, y - 2, 5, 5));
+            difference += fabs(sample.xyz.z - frame.depthAt(y, x));
+            centers++;
+        }
+    }
+    CHECK(difference / centers < 2 * NOISE);
+
+    // nothing confident around the blob
+    frame.confMap.setTo(Scalar(10));
+    CHECK(sampler.estimate(frame, blobs[0]).count == 0);
+    return checkFailures;
+}
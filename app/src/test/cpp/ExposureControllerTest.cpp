@@ -0,0 +1,203 @@
+#include "Check.h"
+#include "CameraStub.h"
+#include "ExposureController.h"
+#include <algorithm>
+#include <chrono>
+
+static const int FRAME_MS = 22; // 45 fps
+
+// Camera which applies the exposure it is given and confirms it to the exposure listener,
+// like royale does on its own thread
+class ReplayCamera : public CameraStub {
+
+public:
+    uint32_t minExposure = 1, maxExposure = 2000;
+    atomic<uint32_t> exposure {0};
+    atomic<uint32_t> highest {0};   // since the last reset
+    atomic<int> changes {0};
+    IExposureListener2 *listener = nullptr;
+
+    CameraStatus getExposureLimits (royale::Pair<uint32_t, uint32_t> &limits, royale::StreamId) const override
+    {
+        limits = royale::Pair<uint32_t, uint32_t>(minExposure, maxExposure);
+        return CameraStatus::SUCCESS;
+    }
+
+    CameraStatus setExposureTime (uint32_t time, royale::StreamId) override
+    {
+        if(time < minExposure || time > maxExposure) return CameraStatus::EXPOSURE_TIME_NOT_SUPPORTED;
+        exposure = time;
+        highest = max(highest.load(), time);
+        changes++;
+        if(listener) listener->onNewExposure(time, 0);
+        return CameraStatus::SUCCESS;
+    }
+
+    CameraStatus registerExposureListener (IExposureListener2 *l) override
+    {
+        listener = l;
+        return CameraStatus::SUCCESS;
+    }
+
+    CameraStatus unregisterExposureListener() override
+    {
+        listener = nullptr;
+        return CameraStatus::SUCCESS;
+    }
+};
+
+// Peak of a retro marker grows linearly with the exposure until it saturates,
+// below the retro threshold there is no blob.
+struct Scene{
+    double gain;            // peak per exposure unit
+    int threshold = 300;
+    bool visible = true;
+
+    explicit Scene(double gain) : gain(gain) {}
+
+    int peak(uint32_t exposure) const
+    {
+        int p = (int)std::min(gain * exposure, 4095.0);
+        return visible && p > threshold ? p : 0;
+    }
+
+    bool inRange(uint32_t exposure) const
+    {
+        int p = peak(exposure);
+        return p >= 700 && p <= 2500;
+    }
+};
+
+// Feeds frames of the scene to the controller like the data callback does, for ms milliseconds
+// or until the peak is in range. Returns the time it took in ms, -1 if the peak is not in range.
+static int feed(ExposureController &controller, ReplayCamera &camera, const Scene &scene, int ms, bool untilInRange)
+{
+    auto start = chrono::steady_clock::now();
+    int elapsed = 0;
+    while(elapsed < ms)
+    {
+        uint32_t exposure = camera.exposure;
+        if(untilInRange && scene.inRange(exposure)) return elapsed;
+        if(controller.wantsStats()) controller.onBlobStats(scene.peak(exposure), 16);
+        this_thread::sleep_for(chrono::milliseconds(FRAME_MS));
+        elapsed = (int)chrono::duration_cast<chrono::milliseconds>(chrono::steady_clock::now() - start).count();
+    }
+    return scene.inRange(camera.exposure) ? elapsed : -1;
+}
+
+static void start(ExposureController &controller, ReplayCamera &camera, uint32_t exposure)
+{
+    camera.setExposureTime(exposure, 0); // set by the session before the controller starts
+    camera.highest = exposure;
+    camera.changes = 0;
+    controller.start(&camera, exposure);
+}
+
+static void testConvergesFromDark()
+{
+    ReplayCamera camera;
+    ExposureController controller;
+    start(controller, camera, 80);
+    Scene scene{4.0}; // in range from 175 to 625
+    int ms = feed(controller, camera, scene, 2000, true);
+    printf("from dark: %d ms, %d changes\n", ms, camera.changes.load());
+    CHECK(ms >= 0 && camera.changes <= 4);
+    controller.stop();
+    CHECK(camera.listener == nullptr);
+}
+
+static void testConvergesFromSaturation()
+{
+    ReplayCamera camera;
+    ExposureController controller;
+    start(controller, camera, 1500);
+    Scene scene{2.0}; // saturated at 1500
+    int ms = feed(controller, camera, scene, 2000, true);
+    printf("from saturation: %d ms, %d changes\n", ms, camera.changes.load());
+    CHECK(ms >= 0 && camera.changes <= 4);
+
+    // and holds there
+    int changes = camera.changes;
+    CHECK(feed(controller, camera, scene, 600, false) >= 0);
+    CHECK(camera.changes == changes);
+}
+
+static void testSearchFindsDarkMarkers()
+{
+    ReplayCamera camera;
+    ExposureController controller;
+    start(controller, camera, 120);
+    Scene scene{2.0}; // no blob below 150
+    CHECK(feed(controller, camera, scene, 2000, true) >= 0);
+}
+
+static void testSearchIsCapped()
+{
+    ReplayCamera camera;
+    ExposureController controller;
+    start(controller, camera, 100);
+    Scene scene{1.0};
+    scene.visible = false;
+    feed(controller, camera, scene, 2400, false);
+    CHECK(camera.highest <= 100 * 2.45);
+    CHECK(camera.highest > 100);
+    CHECK(camera.exposure == 100);
+    CHECK(controller.exposureTime() == 100);
+}
+
+static void testReturnsToLastBlob()
+{
+    ReplayCamera camera;
+    ExposureController controller;
+    start(controller, camera, 80);
+    Scene scene{4.0};
+    CHECK(feed(controller, camera, scene, 2000, true) >= 0);
+    feed(controller, camera, scene, 400, false); // the controller sees the blob in range
+    uint32_t converged = camera.exposure;
+
+    // markers leave the view and come back, the peak is in range at once
+    scene.visible = false;
+    feed(controller, camera, scene, 2000, false);
+    CHECK(camera.exposure == converged);
+    scene.visible = true;
+    CHECK(scene.inRange(camera.exposure));
+}
+
+static void testLimits()
+{
+    ReplayCamera camera;
+    camera.minExposure = 50;
+    camera.maxExposure = 400;
+    ExposureController controller;
+    start(controller, camera, 300);
+    Scene scene{1.0}; // would need 1500
+    CHECK(feed(controller, camera, scene, 1000, false) < 0);
+    CHECK(camera.exposure == 400);
+}
+
+static void testExposureFromOutside()
+{
+    ReplayCamera camera;
+    ExposureController controller;
+    start(controller, camera, 300);
+    Scene scene{4.0}; // in range at 300
+    CHECK(feed(controller, camera, scene, 400, false) >= 0);
+    CHECK(camera.changes == 0);
+
+    // a use case change resets the exposure, the listener reports it
+    camera.setExposureTime(100, 0);
+    CHECK(controller.exposureTime() == 100);
+    CHECK(feed(controller, camera, scene, 2000, true) >= 0);
+}
+
+int main()
+{
+    testConvergesFromDark();
+    testConvergesFromSaturation();
+    testSearchFindsDarkMarkers();
+    testSearchIsCapped();
+    testReturnsToLastBlob();
+    testLimits();
+    testExposureFromOutside();
+    return checkFailures;
+}
@@ -0,0 +1,97 @@
+#include "Check.h"
+#include "FrameScheduler.h"
+
+static const int FPS = 30; // budget of 33.3 ms
+
+// Stage costs in ms of a frame at full quality, decimation quarters the detection
+struct Scene{
+    double ingest, detect, publish;
+
+    void costs(int level, int64_t out[FrameScheduler::STAGE_COUNT]) const
+    {
+        out[FrameScheduler::INGEST] = (int64_t)(ingest * 1000);
+        out[FrameScheduler::DETECT] = (int64_t)(detect * 1000 / (level >= FrameScheduler::DECIMATED ? 4 : 1));
+        out[FrameScheduler::PUBLISH] = (int64_t)(publish * 1000);
+    }
+};
+
+static void run(FrameScheduler &scheduler, const Scene &scene, int frames)
+{
+    int64_t costs[FrameScheduler::STAGE_COUNT];
+    for(int i = 0; i < frames; i++){
+        scene.costs(scheduler.level(), costs);
+        scheduler.onFrame(costs, true);
+    }
+}
+
+// Detection bound frames are decimated, the preview is not the problem
+static void testDetectBottleneck()
+{
+    FrameScheduler scheduler;
+    scheduler.setFrameRate(FPS);
+    run(scheduler, Scene{3, 60, 5}, 20);
+    CHECK(scheduler.level() == FrameScheduler::DECIMATED);
+    FrameScheduler::Metrics metrics = scheduler.takeMetrics();
+    CHECK(metrics.degraded == 1);
+    CHECK(metrics.frames[FrameScheduler::NO_PREVIEW] == 0);
+}
+
+// Decimation does not help a slow publish stage, it goes on to skipping frames
+static void testPublishBottleneck()
+{
+    FrameScheduler scheduler;
+    scheduler.setFrameRate(FPS);
+    run(scheduler, Scene{3, 10, 40}, 5);
+    CHECK(scheduler.level() == FrameScheduler::NO_PREVIEW);
+    run(scheduler, Scene{3, 10, 40}, 5);
+    CHECK(scheduler.level() == FrameScheduler::SKIP_FRAMES);
+    CHECK(scheduler.takeMetrics().frames[FrameScheduler::DECIMATED] == 0);
+}
+
+// Every frame is ingested at every level, nothing is shed for it
+static void testIngestBottleneck()
+{
+    FrameScheduler scheduler;
+    scheduler.setFrameRate(FPS);
+    run(scheduler, Scene{40, 10, 5}, 100);
+    CHECK(scheduler.level() == FrameScheduler::FULL);
+    CHECK(scheduler.takeMetrics().overruns == 100);
+}
+
+// A frame which fits the budget at half the rate and at the full rate is not kept skipped
+static void testRestoreFromSkipFrames()
+{
+    FrameScheduler scheduler;
+    scheduler.setFrameRate(FPS);
+    run(scheduler, Scene{3, 160, 5}, 20); // 40 ms decimated
+    CHECK(scheduler.level() == FrameScheduler::SKIP_FRAMES);
+
+    run(scheduler, Scene{3, 90, 5}, 200); // 22.5 ms decimated, 90 ms at full resolution
+    CHECK(scheduler.level() == FrameScheduler::DECIMATED);
+
+    run(scheduler, Scene{3, 20, 5}, 200);
+    CHECK(scheduler.level() == FrameScheduler::FULL);
+    FrameScheduler::Metrics metrics = scheduler.takeMetrics();
+    CHECK(metrics.restored == 2);
+    CHECK(metrics.degraded == 2);
+}
+
+// A restored level which would overrun again is not restored
+static void testNoOscillation()
+{
+    FrameScheduler scheduler;
+    scheduler.setFrameRate(FPS);
+    run(scheduler, Scene{3, 40, 5}, 1000); // 10 ms decimated, 40 ms at full resolution
+    CHECK(scheduler.level() == FrameScheduler::DECIMATED);
+    CHECK(scheduler.takeMetrics().degraded == 1);
+}
+
+int main()
+{
+    testDetectBottleneck();
+    testPublishBottleneck();
+    testIngestBottleneck();
+    testRestoreFromSkipFrames();
+    testNoOscillation();
+    return checkFailures;
+}
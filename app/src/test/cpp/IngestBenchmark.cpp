@@ -0,0 +1,231 @@
+#include "Benchmark.h"
+#include "IngestKernels.h"
+#include "ProjectorMapping.h"
+#include <random>
+
+static const int WIDTH = 224, HEIGHT = 172; // pico flexx
+
+// Ingestion before the histogram and the tile sums: the maps are only copied
+static void copyPoints(const DepthPoint *src, int width, const IngestRow &row)
+{
+    for (int x = 0; x < width ; x++)
+    {
+        const DepthPoint &p = src[x];
+        row.xyz[x] = Vec3f(p.x, p.y, p.z);
+        row.conf[x] = p.depthConfidence;
+        row.gray[x] = p.grayValue;
+    }
+}
+
+// Ingestion before the kernels were specialized: one loop for every configuration, which tests
+// the flip and the depth representation per pixel
+static void branchyPoints(const DepthPoint *src, int width, const IngestRow &row, bool flipped, bool packed)
+{
+    int k = 0;
+    for (int x = 0; x < width; x++)
+    {
+        const DepthPoint &p = src[k];
+        if(packed){
+            row.depth[x] = (uint16_t)(int)min(p.z * 1000 + 0.5f, 65535.f);
+        }
+        else{
+            row.xyz[x][0] = p.x;
+            row.xyz[x][1] = p.y;
+            row.xyz[x][2] = p.z;
+        }
+        row.conf[x] = p.depthConfidence;
+        row.gray[x] = p.grayValue;
+        if(row.hist && x % Frame::HIST_STEP == 0){
+            row.hist[((x / Frame::HIST_STEP) & (HIST_LANES - 1)) * Frame::HIST_BINS + histBin(p.grayValue)]++;
+        }
+        row.columns[x] += p.grayValue;
+        row.columns[width + x] += row.rowWeight * p.grayValue;
+        k = flipped ? k-1 : k+1;
+    }
+}
+
+// CamListener::updateMaps before this work: a copy of every point through the bounds checked
+// at(), the flip is tested per pixel, nothing else is computed
+static void baselineUpdateMaps(const vector<DepthPoint> &points, Frame &frame, bool flip)
+{
+    int k;
+    if(flip) k = HEIGHT * WIDTH -1 ;
+    else k = 0;
+
+    for (int y = 0; y < HEIGHT ; y++)
+    {
+        Vec3f *xyzptr = frame.xyzMap.ptr<Vec3f>(y);
+        uint8_t *confptr = frame.confMap.ptr<uint8_t>(y);
+        uint16_t *grayptr= frame.grayImage.ptr<uint16_t> (y);
+
+        for (int x = 0; x < WIDTH ; x++)
+        {
+            auto curPoint = points.at (k);
+            xyzptr[x][0] = curPoint.x;
+            xyzptr[x][1] = curPoint.y;
+            xyzptr[x][2] = curPoint.z;
+            confptr[x] = curPoint.depthConfidence;
+            grayptr[x] = curPoint.grayValue;
+
+            k = flip ? k-1 : k+1;
+        }
+    }
+    benchmarkSink = frame.grayImage.ptr<uint16_t>(HEIGHT / 2)[WIDTH / 2];
+}
+
+// Histogram and tile sums as a second pass over the gray image
+static void histogramPass(Frame &frame)
+{
+    for(int y = 0; y < HEIGHT; y++)
+    {
+        const uint16_t *gray = frame.grayImage.ptr<uint16_t>(y);
+        int *tiles = frame.tileSums.ptr<int>(y >> Frame::TILE_SHIFT);
+        for(int x = 0; x < WIDTH; x++){
+            frame.grayHistogram[min(gray[x] >> Frame::HIST_SHIFT, Frame::HIST_BINS - 1)]++;
+            int *tile = tiles + (x >> Frame::TILE_SHIFT) * Frame::TILE_CHANNELS;
+            tile[0] += gray[x];
+            tile[1] += Frame::tileWeight(x) * gray[x];
+            tile[2] += Frame::tileWeight(y) * gray[x];
+        }
+    }
+}
+
+// Frame of a wall at 1.5 m with a few retro markers
+static void synthesize(vector<DepthPoint> &points)
+{
+    mt19937 random(17);
+    normal_distribution<float> noise(0, 0.005f);
+    uniform_int_distribution<int> ambient(100, 400);
+    points.resize(WIDTH * HEIGHT);
+    for(int y = 0; y < HEIGHT; y++){
+        for(int x = 0; x < WIDTH; x++){
+            DepthPoint &p = points[y * WIDTH + x];
+            p.z = 1.5f + noise(random);
+            p.x = (x - WIDTH / 2) * p.z / 210;
+            p.y = (y - HEIGHT / 2) * p.z / 210;
+            p.noise = 0;
+            bool retro = (x % 40) < 4 && (y % 40) < 4;
+            p.grayValue = (uint16_t)(retro ? 3000 : ambient(random));
+            p.depthConfidence = 255;
+        }
+    }
+}
+
+// Runs a kernel over a frame, single threaded
+template <typename Kernel>
+static void ingest(const vector<DepthPoint> &points, Frame &frame, Kernel kernel, bool flipped)
+{
+    int last = WIDTH * HEIGHT - 1;
+    bool packed = frame.compact();
+    static int lanes[HIST_LANES * Frame::HIST_BINS], columns[2 * WIDTH];
+    fill(lanes, lanes + HIST_LANES * Frame::HIST_BINS, 0);
+    fill(frame.grayHistogram, frame.grayHistogram + Frame::HIST_BINS, 0);
+    for(int ty = 0; ty < frame.tileSums.rows; ty++)
+    {
+        fill(columns, columns + 2 * WIDTH, 0);
+        for(int y = ty * Frame::TILE; y < min((ty + 1) * Frame::TILE, HEIGHT); y++)
+        {
+            IngestRow row;
+            row.xyz = packed ? nullptr : frame.xyzMap.ptr<Vec3f>(y);
+            row.depth = packed ? frame.depthMap.ptr<uint16_t>(y) : nullptr;
+            row.conf = frame.confMap.ptr<uint8_t>(y);
+            row.gray = frame.grayImage.ptr<uint16_t>(y);
+            row.hist = Frame::histogramRow(y) ? lanes : nullptr;
+            row.columns = columns;
+            row.rowWeight = Frame::tileWeight(y);
+            kernel(points.data() + (flipped ? last - y * WIDTH : y * WIDTH), WIDTH, row);
+        }
+        reduceTiles(columns, WIDTH, frame.tileSums.ptr<int>(ty));
+    }
+    mergeHistogram(lanes, frame.grayHistogram);
+    benchmarkSink = frame.grayImage.ptr<uint16_t>(HEIGHT / 2)[WIDTH / 2];
+}
+
+int main()
+{
+    vector<DepthPoint> points;
+    synthesize(points);
+    Frame frame;
+    frame.create(WIDTH, HEIGHT);
+
+    printf("Ingestion of a %dx%d depth data frame, one thread\n", WIDTH, HEIGHT);
+    double baseline = measure([&]{ baselineUpdateMaps(points, frame, true); });
+    report("baseline updateMaps, at() copy", baseline, baseline);
+    double copy = measure([&]{ ingest(points, frame, copyPoints, false); });
+    report("copy only", copy, baseline);
+    report("copy, then histogram pass", measure([&]{
+        ingest(points, frame, copyPoints, false);
+        histogramPass(frame);
+    }), baseline);
+    report("fused kernel", measure([&]{ ingest(points, frame, POINT_KERNELS[1][0][1], true); }), baseline);
+    Frame compact;
+    compact.create(WIDTH, HEIGHT, true);
+    report("fused kernel, compact frame", measure([&]{ ingest(points, compact, POINT_KERNELS[1][1][1], true); }), baseline);
+    printf("maps: %d B/px float, %d B/px compact\n", Frame::bytesPerPixel(false), Frame::bytesPerPixel(true));
+
+    // interleaved with the baseline of the same flip, so a drift of the clock affects both alike.
+    // Only TEST mode needs the tile sums, the other modes with a gray image skip them.
+    printf("\nKernels per [flipped][packed][tiles] over the baseline updateMaps, median of interleaved runs\n");
+    for(int flipped = 0; flipped < 2; flipped++){
+        for(int packed = 0; packed < 2; packed++){
+            for(int tiles = 0; tiles < 2; tiles++)
+            {
+                Frame &target = packed ? compact : frame;
+                double ratio = measureRatio([&]{ baselineUpdateMaps(points, frame, flipped); },
+                                            [&]{ ingest(points, target, POINT_KERNELS[flipped][packed][tiles], flipped); });
+                char name[64];
+                snprintf(name, sizeof(name), "%s, %s, %s", flipped ? "flipped" : "upright", packed ? "compact" : "float",
+                         tiles ? "tile sums (TEST)" : "no tile sums");
+                printf("%-40s %7.2fx\n", name, ratio);
+            }
+        }
+    }
+
+    printf("\nKernels specialized per [flipped][packed] vs one loop testing both per pixel\n");
+    for(int flipped = 0; flipped < 2; flipped++){
+        for(int packed = 0; packed < 2; packed++)
+        {
+            Frame &target = packed ? compact : frame;
+            double branchy = measure([&]{
+                ingest(points, target, [&](const DepthPoint *src, int width, const IngestRow &row){
+                    branchyPoints(src, width, row, flipped, packed);
+                }, flipped);
+            });
+            char name[64];
+            snprintf(name, sizeof(name), "%s, %s: branchy", flipped ? "flipped" : "upright", packed ? "compact" : "float");
+            report(name, branchy, branchy);
+            report("  specialized", measure([&]{ ingest(points, target, POINT_KERNELS[flipped][packed][1], flipped); }), branchy);
+        }
+    }
+
+    // calibration of a 1280x720 projector over the camera, shifts fitted in pro. pixel
+    ProjectorMapping mapping;
+    mapping.create(Point2d(1280.0 * 1.4 / WIDTH, 720.0 * 1.4 / HEIGHT), Point2d(256, 144), Vec4d(400, -0.02, 150, -0.025));
+    const int POINTS = 4096;
+    vector<Point2i> pixels(POINTS);
+    vector<float> depths(POINTS);
+    mt19937 random(44);
+    uniform_int_distribution<int> px(0, WIDTH - 1), py(0, HEIGHT - 1);
+    uniform_real_distribution<float> depth(30, 200); // in cm
+    int maxError = 0;
+    for(int i = 0; i < POINTS; i++){
+        pixels[i] = Point2i(px(random), py(random));
+        depths[i] = depth(random);
+        Point2i error = mapping.map(pixels[i], depths[i]) - mapping.mapFloat(pixels[i], depths[i]);
+        maxError = max(maxError, max(abs(error.x), abs(error.y)));
+    }
+
+    printf("\nMapping of %d points to the projector, largest difference %d pro. pixel\n", POINTS, maxError);
+    double floats = measure([&]{
+        int sum = 0;
+        for(int i = 0; i < POINTS; i++) sum += mapping.mapFloat(pixels[i], depths[i]).x;
+        benchmarkSink = sum;
+    });
+    report("float with exp", floats, floats);
+    report("fixed point table", measure([&]{
+        int sum = 0;
+        for(int i = 0; i < POINTS; i++) sum += mapping.map(pixels[i], depths[i]).x;
+        benchmarkSink = sum;
+    }), floats);
+    return 0;
+}
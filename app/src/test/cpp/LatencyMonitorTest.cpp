@@ -0,0 +1,39 @@
+#include "Check.h"
+#include "LatencyMonitor.h"
+
+int main()
+{
+    LatencyMonitor latency;
+    CHECK(latency.mean(LatencyMonitor::DISPLAY) == 0);
+    CHECK(latency.percentile(LatencyMonitor::DISPLAY, 50) == 0);
+
+    // 1..100 ms
+    for(int ms = 1; ms <= 100; ms++) latency.add(LatencyMonitor::DISPLAY, ms * 1000);
+    CHECK(latency.samplesIn(LatencyMonitor::DISPLAY) == 100);
+    CHECK(latency.mean(LatencyMonitor::DISPLAY) == 50500);
+    CHECK(latency.percentile(LatencyMonitor::DISPLAY, 0) == 1000);
+    CHECK(latency.percentile(LatencyMonitor::DISPLAY, 50) == 51000);
+    CHECK(latency.percentile(LatencyMonitor::DISPLAY, 90) == 91000);
+    CHECK(latency.percentile(LatencyMonitor::DISPLAY, 100) == 100000);
+
+    // the stages are kept apart
+    CHECK(latency.samplesIn(LatencyMonitor::PUBLISH) == 0);
+
+    // the window slides, old samples are dropped
+    for(int i = 0; i < 128; i++) latency.add(LatencyMonitor::DISPLAY, 7000);
+    CHECK(latency.samplesIn(LatencyMonitor::DISPLAY) == 128);
+    CHECK(latency.mean(LatencyMonitor::DISPLAY) == 7000);
+    CHECK(latency.percentile(LatencyMonitor::DISPLAY, 100) == 7000);
+
+    // a capture time from another clock is ignored
+    latency.record(LatencyMonitor::INGEST, LatencyMonitor::now() + 1000000);
+    latency.record(LatencyMonitor::INGEST, 0);
+    CHECK(latency.samplesIn(LatencyMonitor::INGEST) == 0);
+    latency.record(LatencyMonitor::INGEST, LatencyMonitor::now() - 5000);
+    CHECK(latency.samplesIn(LatencyMonitor::INGEST) == 1);
+    CHECK(latency.mean(LatencyMonitor::INGEST) >= 5000 && latency.mean(LatencyMonitor::INGEST) < 50000);
+
+    latency.reset();
+    CHECK(latency.samplesIn(LatencyMonitor::DISPLAY) == 0);
+    return checkFailures;
+}
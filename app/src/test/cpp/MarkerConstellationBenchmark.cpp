@@ -0,0 +1,51 @@
+#include "Benchmark.h"
+#include "MarkerConstellation.h"
+#include <random>
+
+static const Point2f BOARD[] = {{0, 0}, {-360, -200}, {-60, -220}, {300, -120}, {-200, 180}};
+static const float CAMERA_SCALE = 0.2f;
+
+// The board rotated and shifted in the camera image with noisy centroids, a few markers
+// missing and outliers anywhere in the frame
+static vector<Point2f> synthesize(mt19937 &random, int missing, int outliers)
+{
+    normal_distribution<float> jitter(0, 0.5f);
+    uniform_real_distribution<float> px(0, 224), py(0, 172);
+    float a = 0.3f, s = CAMERA_SCALE;
+    vector<Point2f> blobs;
+    for(int k = missing; k < (int)(sizeof(BOARD) / sizeof(BOARD[0])); k++){
+        Point2f p = BOARD[k];
+        blobs.push_back(Point2f(112, 86) + Point2f(cos(a) * p.x - sin(a) * p.y, sin(a) * p.x + cos(a) * p.y) * s
+                        + Point2f(jitter(random), jitter(random)));
+    }
+    for(int i = 0; i < outliers; i++) blobs.push_back(Point2f(px(random), py(random)));
+    shuffle(blobs.begin(), blobs.end(), random);
+    return blobs;
+}
+
+int main()
+{
+    mt19937 random(48);
+    MarkerConstellation constellation;
+    vector<Point2f> layout;
+    for(const Point2f &p : BOARD) layout.push_back(p * CAMERA_SCALE);
+    constellation.setLayout(layout);
+    vector<int> markers;
+
+    printf("Identification of a %d marker board, time per frame by the blobs of the frame\n", constellation.size());
+    vector<Point2f> clean = synthesize(random, 0, 0);
+    double baseline = measure([&]{ benchmarkSink = constellation.identify(clean, markers); });
+    report("5 markers", baseline, baseline);
+    struct Case{ const char *name; int missing, outliers; };
+    for(const Case &c : {Case{"3 markers", 2, 0}, Case{"5 markers + 3 outliers", 0, 3},
+                         Case{"4 markers + 6 outliers", 1, 6}, Case{"5 markers + 11 outliers", 0, 11},
+                         Case{"5 markers + 20 outliers (capped)", 0, 20}})
+    {
+        vector<Point2f> blobs = synthesize(random, c.missing, c.outliers);
+        int found = 0;
+        double micros = measure([&]{ found = constellation.identify(blobs, markers); benchmarkSink = found; });
+        report(c.name, micros, baseline);
+        printf("  %d markers identified\n", found);
+    }
+    return 0;
+}
@@ -0,0 +1,106 @@
+#include "Check.h"
+#include "MarkerConstellation.h"
+#include <random>
+
+// Offsets of the calibration board in projector pixels, in camera pixels at about 1/5 of it
+static const Point2f BOARD[] = {{0, 0}, {-360, -200}, {-60, -220}, {300, -120}, {-200, 180}};
+static const int MARKERS = 5;
+static const float CAMERA_SCALE = 0.2f;
+
+struct Scene{
+    vector<Point2f> blobs;
+    vector<int> truth; // blob of each marker, -1 if it is missing
+};
+
+// The board seen with a random similarity, mirrored or not, with noisy centroids, some markers
+// missing and outliers kept away from every marker position
+static Scene synthesize(mt19937 &random, float noise, int missing, int outliers, bool mirrored)
+{
+    uniform_real_distribution<float> angle(-0.5f, 0.5f), scale(0.7f, 1.3f), shift(-20, 20);
+    uniform_real_distribution<float> px(0, 224), py(0, 172);
+    normal_distribution<float> jitter(0, noise);
+    float a = angle(random), s = scale(random) * CAMERA_SCALE;
+    Point2f center(112 + shift(random), 86 + shift(random));
+
+    vector<Point2f> positions;
+    for(const Point2f &p : BOARD){
+        Point2f q(p.x, mirrored ? -p.y : p.y);
+        positions.push_back(center + Point2f(cos(a) * q.x - sin(a) * q.y, sin(a) * q.x + cos(a) * q.y) * s);
+    }
+    vector<int> order(MARKERS);
+    for(int k = 0; k < MARKERS; k++) order[k] = k;
+    shuffle(order.begin(), order.end(), random);
+    vector<bool> seen(MARKERS, true);
+    for(int i = 0; i < missing; i++) seen[order[i]] = false;
+
+    // blobs are in a random order, outliers are farther than 3 tolerances (0.15 * spacing) from markers
+    Scene scene;
+    vector<pair<Point2f, int>> blobs;
+    for(int k = 0; k < MARKERS; k++){
+        if(seen[k]) blobs.push_back(make_pair(positions[k] + Point2f(jitter(random), jitter(random)), k));
+    }
+    float clearance = 3 * 0.15f * 228 * s;
+    while(outliers > 0){
+        Point2f p(px(random), py(random));
+        bool clear = true;
+        for(const Point2f &q : positions) clear = clear && norm(p - q) > clearance;
+        if(!clear) continue;
+        blobs.push_back(make_pair(p, -1));
+        outliers--;
+    }
+    shuffle(blobs.begin(), blobs.end(), random);
+    scene.truth.assign(MARKERS, -1);
+    for(int i = 0; i < (int)blobs.size(); i++){
+        scene.blobs.push_back(blobs[i].first);
+        if(blobs[i].second != -1) scene.truth[blobs[i].second] = i;
+    }
+    return scene;
+}
+
+// Scenes whose markers are all identified, a wrong blob for a marker counts as a failure
+static int identified(MarkerConstellation &constellation, mt19937 &random, int scenes,
+                      float noise, int missing, int outliers)
+{
+    int correct = 0;
+    vector<int> markers;
+    for(int i = 0; i < scenes; i++)
+    {
+        Scene scene = synthesize(random, noise, missing, outliers, i % 2 == 1);
+        int found = constellation.identify(scene.blobs, markers);
+        if(found == MARKERS - missing && markers == scene.truth) correct++;
+    }
+    return correct;
+}
+
+int main()
+{
+    MarkerConstellation constellation;
+    vector<Point2f> layout;
+    for(const Point2f &p : BOARD) layout.push_back(p * CAMERA_SCALE);
+    constellation.setLayout(layout);
+    CHECK(constellation.size() == MARKERS);
+    mt19937 random(48);
+
+    // too few blobs
+    vector<int> markers;
+    CHECK(constellation.identify(vector<Point2f>{Point2f(1, 1), Point2f(20, 5)}, markers) == 0);
+    CHECK(markers == vector<int>(MARKERS, -1));
+
+    // every marker under rotation, scale, mirroring and centroid noise
+    CHECK(identified(constellation, random, 200, 0.0f, 0, 0) == 200);
+    CHECK(identified(constellation, random, 200, 0.5f, 0, 0) == 200);
+    // the whole board among outliers, up to the blob budget
+    CHECK(identified(constellation, random, 200, 0.5f, 0, 6) == 200);
+    CHECK(identified(constellation, random, 200, 0.5f, 0, 11) == 200);
+    // a missing marker
+    CHECK(identified(constellation, random, 200, 0.5f, 1, 0) == 200);
+    CHECK(identified(constellation, random, 200, 0.5f, 1, 6) >= 196);
+    // three markers are one basis and a single vote: some triples of the board are close to
+    // similar, isosceles or mirrored, and with outliers a wrong pose fits as many markers.
+    // A wrong frame within an averaged window fails the variance gate of the averager.
+    CHECK(identified(constellation, random, 200, 0.5f, 2, 0) >= 170);
+    printf("identified of 200 frames: 1 missing + 11 outliers %d, 2 missing + 6 outliers %d\n",
+           identified(constellation, random, 200, 0.5f, 1, 11), identified(constellation, random, 200, 0.5f, 2, 6));
+
+    return checkFailures;
+}
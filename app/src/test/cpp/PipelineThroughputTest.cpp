@@ -0,0 +1,116 @@
+#include "Check.h"
+#include "CamListener.h"
+#include "LatencyMonitor.h"
+#include "ThreadPool.h"
+#include <random>
+
+static const int WIDTH = 224, HEIGHT = 172; // pico flexx
+static const int FRAMES = 300;              // fed to each camera
+static const int RETRO_THRESHOLD = 1000;
+
+// Camera fed with synthetic depth data as fast as its pipeline takes it. The detect stage
+// finds the bright pixels on the shared pool like the retro detection, there is no java side
+// so publishing only counts the frame.
+class FakeCamera : public CamListener {
+
+public:
+    explicit FakeCamera(int seed)
+    {
+        setCamera(WIDTH, HEIGHT, 62, 45);
+        mt19937 random(seed);
+        uniform_int_distribution<int> ambient(100, 400);
+        data.width = WIDTH;
+        data.height = HEIGHT;
+        data.points.resize(WIDTH * HEIGHT);
+        for(int i = 0; i < WIDTH * HEIGHT; i++)
+        {
+            DepthPoint &p = data.points[i];
+            int x = i % WIDTH, y = i / WIDTH;
+            p.x = p.y = 0;
+            p.z = 1.5f;
+            p.noise = 0;
+            p.grayValue = (uint16_t)((x % 40) < 4 && (y % 40) < 4 ? 3000 : ambient(random));
+            p.depthConfidence = 255;
+        }
+    }
+
+    void feed()
+    {
+        data.timeStamp = chrono::microseconds(LatencyMonitor::now());
+        onNewData(&data);
+    }
+
+    atomic<int> published {0};
+    atomic<int> retroPixels {0}; // of the last detected frame
+
+protected:
+    void detectFrame(Frame &frame) override
+    {
+        atomic<int> count {0};
+        ThreadPool::shared().parallelFor(0, HEIGHT, 16, [&](int from, int to)
+        {
+            int local = 0;
+            for(int y = from; y < to; y++){
+                const uint16_t *gray = frame.grayImage.ptr<uint16_t>(y);
+                for(int x = 0; x < WIDTH; x++) local += gray[x] > RETRO_THRESHOLD;
+            }
+            count += local;
+        });
+        retroPixels = count.load();
+    }
+
+    void publishFrame(Frame &frame) override
+    {
+        published++;
+    }
+
+private:
+    DepthData data;
+};
+
+// Feeds every camera from its own thread, returns the processed frames per second of all
+static double run(vector<unique_ptr<FakeCamera>> &cameras)
+{
+    for(auto &camera : cameras) camera->startPipeline();
+    int64_t start = LatencyMonitor::now();
+    vector<thread> feeders;
+    for(auto &camera : cameras){
+        FakeCamera *c = camera.get();
+        feeders.push_back(thread([c]{ for(int i = 0; i < FRAMES; i++) c->feed(); }));
+    }
+    for(thread &t : feeders) t.join();
+    for(auto &camera : cameras) camera->waitIdle();
+    double seconds = (LatencyMonitor::now() - start) / 1e6;
+
+    int processed = 0;
+    for(auto &camera : cameras)
+    {
+        CamListener::FrameStats stats = camera->takeFrameStats();
+        CHECK(stats.frames > 0);
+        CHECK(camera->published == stats.frames);
+        CHECK(camera->retroPixels == 6 * 5 * 16); // 4x4 pixels every 40 pixels
+        processed += stats.frames;
+        camera->stopPipeline();
+    }
+    return processed / seconds;
+}
+
+static vector<unique_ptr<FakeCamera>> createCameras(int count)
+{
+    vector<unique_ptr<FakeCamera>> cameras;
+    for(int i = 0; i < count; i++) cameras.push_back(unique_ptr<FakeCamera>(new FakeCamera(i)));
+    return cameras;
+}
+
+int main()
+{
+    vector<unique_ptr<FakeCamera>> one = createCameras(1);
+    double single = run(one);
+    vector<unique_ptr<FakeCamera>> four = createCameras(4);
+    double aggregate = run(four);
+
+    printf("%d pool threads, %dx%d frames\n", ThreadPool::shared().size(), WIDTH, HEIGHT);
+    printf("1 camera:  %7.0f frames/s\n", single);
+    printf("4 cameras: %7.0f frames/s \t %.2fx\n", aggregate, aggregate / single);
+    return checkFailures;
+}
@@ -0,0 +1,87 @@
+#include "Check.h"
+#include "PointAverager.h"
+#include <random>
+
+// Two pass mean and sample variance
+static void reference(const vector<double> &values, double &mean, double &variance)
+{
+    mean = 0;
+    for(double value : values) mean += value;
+    mean /= values.size();
+    variance = 0;
+    for(double value : values) variance += (value - mean) * (value - mean);
+    variance /= values.size() - 1;
+}
+
+int main()
+{
+    PointAverager averager;
+    CHECK(!averager.active());
+
+    // the window closes on the fifteenth frame, points of an inactive averager are dropped
+    mt19937 random(47);
+    normal_distribution<double> pixel(0, 0.3), depth(0, 0.6);
+    averager.start(2);
+    vector<double> u, v, z;
+    for(int frame = 0; frame < 15; frame++){
+        CHECK(averager.active());
+        u.push_back(120.5 + pixel(random));
+        v.push_back(80.25 + pixel(random));
+        z.push_back(65.0 + depth(random));
+        averager.add(0, Point2f((float)u.back(), (float)v.back()), Point3f(1.0f, 2.0f, (float)z.back()));
+        averager.add(5, Point2f(0, 0), Point3f(0, 0, 0)); // no such slot
+        CHECK(averager.endFrame() == (frame == 14));
+    }
+    CHECK(!averager.active());
+    averager.add(0, Point2f(1000, 1000), Point3f(0, 0, 1000));
+    CHECK(!averager.endFrame());
+    CHECK(averager.samples(0) == 15);
+
+    // the streaming mean and variance agree with two passes
+    PointAverager::Point point;
+    CHECK(averager.result(0, point));
+    double mean, variance;
+    reference(u, mean, variance);
+    CHECK(fabs(point.uv.x - mean) < 1e-4 && fabs(point.variance.x - variance) < 1e-4);
+    reference(v, mean, variance);
+    CHECK(fabs(point.uv.y - mean) < 1e-4 && fabs(point.variance.y - variance) < 1e-4);
+    reference(z, mean, variance);
+    CHECK(fabs(point.xyz.z - mean) < 1e-4 && fabs(point.variance.z - variance) < 1e-4);
+    CHECK(point.xyz.x == 1.0f && point.xyz.y == 2.0f);
+    // a slot which is never seen is not saved
+    CHECK(averager.samples(1) == 0);
+    CHECK(!averager.result(1, point));
+
+    // a point should be seen in ten frames
+    for(int seen = 9; seen <= 10; seen++){
+        averager.start(1);
+        for(int frame = 0; frame < 15; frame++){
+            if(frame < seen) averager.add(0, Point2f(10, 10), Point3f(0, 0, 50));
+            averager.endFrame();
+        }
+        CHECK(averager.result(0, point) == (seen == 10));
+    }
+
+    // a point which moved is rejected, by its uv or by its depth
+    averager.start(3);
+    for(int frame = 0; frame < 15; frame++){
+        float side = frame % 2 ? 1.0f : -1.0f;
+        averager.add(0, Point2f(10, 10), Point3f(0, 0, 50));
+        averager.add(1, Point2f(10 + side, 10), Point3f(0, 0, 50));     // 1 px^2
+        averager.add(2, Point2f(10, 10), Point3f(0, 0, 50 + 1.5f * side)); // 2.25 cm^2
+        averager.endFrame();
+    }
+    CHECK(averager.result(0, point));
+    CHECK(!averager.result(1, point));
+    CHECK(!averager.result(2, point));
+
+    // a cancelled window takes no more points
+    averager.start(1);
+    averager.add(0, Point2f(10, 10), Point3f(0, 0, 50));
+    averager.cancel();
+    CHECK(!averager.active());
+    averager.add(0, Point2f(10, 10), Point3f(0, 0, 50));
+    CHECK(averager.samples(0) == 1);
+
+    return checkFailures;
+}
@@ -0,0 +1,100 @@
+#include "Benchmark.h"
+#include "PackKernels.h"
+#include "ThreadPool.h"
+#include "UndistortedPreview.h"
+#include <random>
+
+using namespace std;
+using namespace cv;
+
+static const int WIDTH = 224, HEIGHT = 172; // pico flexx
+
+// Packing before the kernels were specialized: one loop per format, the flip is tested per pixel
+static void branchyRow(const Mat &image, int row, jint *out, bool flip)
+{
+    int last = image.rows * image.cols - 1;
+    int k = flip ? last - row * image.cols : row * image.cols;
+    if(image.type() == CV_8UC3){
+        const Vec3b *ptr = image.ptr<Vec3b>(row);
+        for (int j = 0; j < image.cols; j++){
+            Vec3b p = ptr[j];
+            out[k] = (255 & 0xff) << 24 | (p[2] & 0xff) << 16 | (p[1] & 0xff) << 8 | (p[0] & 0xff);
+            k = flip ? k-1 : k+1;
+        }
+    }
+    else{
+        const uint8_t *ptr = image.ptr<uint8_t>(row);
+        for (int j = 0; j < image.cols; j++){
+            uint8_t p = ptr[j];
+            out[k] = (255 & 0xff) << 24 | (p & 0xff) << 16 | (p & 0xff) << 8 | (p & 0xff);
+            k = flip ? k-1 : k+1;
+        }
+    }
+}
+
+// GRAY preview of Calibrator::publishFrame without the undistortion, packed like CallbackManager
+static void distortedPreview(const Mat &gray, const Mat &retro, Mat &bgr, vector<jint> &out)
+{
+    normalize(gray, bgr, 0, 255, NORM_MINMAX, CV_8UC1);
+    cvtColor(bgr, bgr, COLOR_GRAY2BGR);
+    bgr.setTo(Scalar(255,0,255), retro);
+    for(int y = 0; y < bgr.rows; y++) PACK_KERNELS[BGR_PREVIEW][false](bgr, y, out.data());
+}
+
+int main()
+{
+    mt19937 random(45);
+    uniform_int_distribution<int> value(0, 255);
+    Mat images[2] = {Mat(Size(WIDTH, HEIGHT), CV_8UC3), Mat(Size(WIDTH, HEIGHT), CV_8UC1)}; // by PreviewFormat
+    for(Mat &image : images){
+        uint8_t *data = image.ptr<uint8_t>(0);
+        for(size_t i = 0; i < image.total() * image.channels(); i++) data[i] = (uint8_t)value(random);
+    }
+    vector<jint> out(WIDTH * HEIGHT);
+
+    printf("Packing a %dx%d preview to ARGB, one thread\n", WIDTH, HEIGHT);
+    for(int format = 0; format < 2; format++){
+        for(int flip = 0; flip < 2; flip++)
+        {
+            const Mat &image = images[format];
+            double branchy = measure([&]{
+                for(int y = 0; y < HEIGHT; y++) branchyRow(image, y, out.data(), flip);
+                benchmarkSink = out[WIDTH];
+            });
+            char name[64];
+            snprintf(name, sizeof(name), "%s, %s: branchy", format == BGR_PREVIEW ? "bgr" : "gray", flip ? "flipped" : "upright");
+            report(name, branchy, branchy);
+            report("  specialized", measure([&]{
+                for(int y = 0; y < HEIGHT; y++) PACK_KERNELS[format][flip](image, y, out.data());
+                benchmarkSink = out[WIDTH];
+            }), branchy);
+        }
+    }
+
+    // pico flexx like lens, gray image of ambient noise with a few retro markers
+    Mat cameraMatrix = (Mat1d(3, 3) << 210, 0, 112, 0, 210, 86, 0, 0, 1);
+    Mat distortion = (Mat1d(1, 5) << -0.2, 0.05, 0, 0, 0);
+    uniform_int_distribution<int> ambient(100, 400);
+    Mat gray(Size(WIDTH, HEIGHT), CV_16UC1);
+    for(int y = 0; y < HEIGHT; y++){
+        uint16_t *row = gray.ptr<uint16_t>(y);
+        for(int x = 0; x < WIDTH; x++) row[x] = (uint16_t)((x % 40) < 4 && (y % 40) < 4 ? 3000 : ambient(random));
+    }
+    Mat retro = gray > 1000; // segmentation output, the same for both previews
+    UndistortedPreview undistorted;
+    undistorted.create(cameraMatrix, distortion, gray.size());
+    ThreadPool::shared().setDeterministic(true); // one thread like the packing above
+
+    printf("\nGRAY preview of a %dx%d image to ARGB, one thread\n", WIDTH, HEIGHT);
+    Mat bgr, argb;
+    double distorted = measure([&]{
+        distortedPreview(gray, retro, bgr, out);
+        benchmarkSink = out[WIDTH];
+    });
+    report("distorted: normalize, color, mask, pack", distorted, distorted);
+    report("undistorted: single pass remap", measure([&]{
+        undistorted.render(gray, retro, argb);
+        benchmarkSink = argb.ptr<int>(0)[WIDTH / 2];
+    }), distorted);
+    return 0;
+}
@@ -0,0 +1,81 @@
+#include "Benchmark.h"
+#include "PyramidDetector.h"
+#include <random>
+
+static const int WIDTH = 224, HEIGHT = 172; // pico flexx
+static const int THRESHOLD = 1000;
+static const float MATCH_DISTANCE = 0.5f; // in pixel, centroids closer than this are the same blob
+
+// Ambient gray with round markers of 1 to 4 px radius at sub-pixel positions
+static Mat synthesize(int markers, mt19937 &random)
+{
+    uniform_int_distribution<int> ambient(100, 400);
+    uniform_real_distribution<float> px(6, WIDTH - 6), py(6, HEIGHT - 6), radius(0.6f, 4);
+    Mat gray(Size(WIDTH, HEIGHT), CV_16UC1);
+    for(int y = 0; y < HEIGHT; y++){
+        uint16_t *row = gray.ptr<uint16_t>(y);
+        for(int x = 0; x < WIDTH; x++) row[x] = (uint16_t)ambient(random);
+    }
+    for(int i = 0; i < markers; i++)
+    {
+        float cx = px(random), cy = py(random), r = radius(random);
+        for(int y = (int)(cy - r); y <= (int)(cy + r) + 1; y++){
+            for(int x = (int)(cx - r); x <= (int)(cx + r) + 1; x++){
+                float d = hypotf(x - cx, y - cy);
+                if(d <= r) gray.at<uint16_t>(y, x) = (uint16_t)(3000 - 500 * d / r);
+            }
+        }
+    }
+    return gray;
+}
+
+// Blobs of the reference with a pyramid blob closer than MATCH_DISTANCE, and the largest distance
+static int match(const vector<Blob> &reference, const vector<Blob> &blobs, float &maxError)
+{
+    int matched = 0;
+    maxError = 0;
+    for(const Blob &ref : reference)
+    {
+        float best = -1;
+        for(const Blob &blob : blobs){
+            float d = (float)norm(ref.centroid - blob.centroid);
+            if(best < 0 || d < best) best = d;
+        }
+        if(best >= 0 && best < MATCH_DISTANCE){
+            matched++;
+            maxError = max(maxError, best);
+        }
+    }
+    return matched;
+}
+
+int main()
+{
+    mt19937 random(38);
+    Segmenter segmenter;
+    PyramidDetector pyramid;
+    vector<Blob> reference, blobs;
+
+    printf("Retro detection in a %dx%d gray image, pyramid vs full frame segmentation\n", WIDTH, HEIGHT);
+    for(int markers : {0, 4, 16, 64})
+    {
+        Mat gray = synthesize(markers, random);
+        segmenter.segment(gray, THRESHOLD, reference);
+        pyramid.detect(gray, THRESHOLD, blobs);
+        float maxError;
+        int matched = match(reference, blobs, maxError);
+        printf("%d markers: %d of %d blobs matched (%d found), max centroid error %.3f px\n",
+               markers, matched, (int)reference.size(), (int)blobs.size(), maxError);
+
+        double full = measure([&]{
+            segmenter.segment(gray, THRESHOLD, reference);
+            benchmarkSink = (int)reference.size();
+        });
+        report("  full frame", full, full);
+        report("  pyramid", measure([&]{
+            pyramid.detect(gray, THRESHOLD, blobs);
+            benchmarkSink = (int)blobs.size();
+        }), full);
+    }
+    return 0;
+}
@@ -0,0 +1,118 @@
+#include "Check.h"
+#include "PyramidDetector.h"
+#include <random>
+
+static const int THRESHOLD = 1000;
+
+// Ambient gray with rectangular markers of 1 to 6 px, some of them touching
+static Mat synthesize(Size size, int markers, mt19937 &random)
+{
+    uniform_int_distribution<int> ambient(0, THRESHOLD), side(1, 6), retro(THRESHOLD + 1, 4095);
+    uniform_int_distribution<int> px(0, size.width - 1), py(0, size.height - 1);
+    Mat gray(size, CV_16UC1);
+    for(int y = 0; y < size.height; y++){
+        uint16_t *row = gray.ptr<uint16_t>(y);
+        for(int x = 0; x < size.width; x++) row[x] = (uint16_t)ambient(random);
+    }
+    Rect image(Point(0, 0), size);
+    for(int i = 0; i < markers; i++){
+        Rect marker = Rect(px(random), py(random), side(random), side(random)) & image;
+        gray(marker).setTo(Scalar(retro(random)));
+    }
+    return gray;
+}
+
+// Ambient gray with round markers of 0.6 to 4 px radius at sub-pixel positions, their edges fall
+// off below the threshold
+static Mat synthesizeRound(Size size, int markers, mt19937 &random)
+{
+    uniform_int_distribution<int> ambient(100, 400);
+    uniform_real_distribution<float> px(6, size.width - 6), py(6, size.height - 6), radius(0.6f, 4);
+    Mat gray(size, CV_16UC1);
+    for(int y = 0; y < size.height; y++){
+        uint16_t *row = gray.ptr<uint16_t>(y);
+        for(int x = 0; x < size.width; x++) row[x] = (uint16_t)ambient(random);
+    }
+    for(int i = 0; i < markers; i++)
+    {
+        float cx = px(random), cy = py(random), r = radius(random);
+        for(int y = (int)(cy - r); y <= (int)(cy + r) + 1; y++){
+            for(int x = (int)(cx - r); x <= (int)(cx + r) + 1; x++){
+                float d = hypotf(x - cx, y - cy);
+                if(d <= r) gray.at<uint16_t>(y, x) = (uint16_t)(3000 - 2500 * d / r);
+            }
+        }
+    }
+    return gray;
+}
+
+// Largest centroid distance from a blob of the reference to the closest blob, -1 if one is missing
+static float centroidError(const vector<Blob> &reference, const vector<Blob> &blobs)
+{
+    float maxError = 0;
+    for(const Blob &ref : reference)
+    {
+        float best = -1;
+        for(const Blob &blob : blobs){
+            float d = (float)norm(ref.centroid - blob.centroid);
+            if(best < 0 || d < best) best = d;
+        }
+        if(best < 0) return -1;
+        maxError = max(maxError, best);
+    }
+    return maxError;
+}
+
+static bool before(const Blob &a, const Blob &b)
+{
+    if(a.bbox.y != b.bbox.y) return a.bbox.y < b.bbox.y;
+    if(a.bbox.x != b.bbox.x) return a.bbox.x < b.bbox.x;
+    return a.area < b.area;
+}
+
+int main()
+{
+    mt19937 random(40);
+    // widths around the 32 bit words, so regions start inside a word and end in the last one
+    const Size sizes[] = {Size(224, 172), Size(101, 67), Size(33, 129)};
+
+    Segmenter segmenter;
+    PyramidDetector pyramid;
+    vector<Blob> full, blobs;
+    for(Size size : sizes){
+        for(int markers : {0, 1, 8, 40})
+        {
+            Mat gray = synthesize(size, markers, random);
+            segmenter.segment(gray, THRESHOLD, full);
+            pyramid.detect(gray, THRESHOLD, blobs);
+
+            // same blobs as the full frame
+            CHECK(blobs.size() == full.size());
+            if(blobs.size() == full.size()){
+                sort(blobs.begin(), blobs.end(), before);
+                sort(full.begin(), full.end(), before);
+                for(size_t i = 0; i < blobs.size(); i++){
+                    CHECK(blobs[i].bbox == full[i].bbox);
+                    CHECK(blobs[i].area == full[i].area);
+                    CHECK(fabs(blobs[i].centroid.x - full[i].centroid.x) < 1e-3 && fabs(blobs[i].centroid.y - full[i].centroid.y) < 1e-3);
+                }
+            }
+
+            // the mask assembled from the regions is the mask of the full frame
+            CHECK(pyramid.packedWords() == segmenter.packedWords());
+            CHECK(pyramid.packedMask() == segmenter.packedMask());
+        }
+    }
+    // accuracy against the full frame on markers whose edges are cut by the threshold
+    for(int markers : {4, 16, 64})
+    {
+        Mat gray = synthesizeRound(sizes[0], markers, random);
+        segmenter.segment(gray, THRESHOLD, full);
+        pyramid.detect(gray, THRESHOLD, blobs);
+        CHECK(!full.empty());
+        CHECK(blobs.size() == full.size());
+        float error = centroidError(full, blobs);
+        CHECK(error >= 0 && error < 1e-3f);
+    }
+    return checkFailures;
+}
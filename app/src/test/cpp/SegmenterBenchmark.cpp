@@ -0,0 +1,92 @@
+#include "Benchmark.h"
+#include "Segmenter.h"
+#include <random>
+
+static const int WIDTH = 224, HEIGHT = 172; // pico flexx
+static const int THRESHOLD = 1000;
+
+// Ambient gray with square markers of 2 to 8 px
+static Mat synthesize(int markers, mt19937 &random)
+{
+    uniform_int_distribution<int> ambient(100, 400), side(2, 8), px(0, WIDTH - 8), py(0, HEIGHT - 8);
+    Mat gray(Size(WIDTH, HEIGHT), CV_16UC1);
+    for(int y = 0; y < HEIGHT; y++){
+        uint16_t *row = gray.ptr<uint16_t>(y);
+        for(int x = 0; x < WIDTH; x++) row[x] = (uint16_t)ambient(random);
+    }
+    for(int i = 0; i < markers; i++){
+        Rect marker(px(random), py(random), side(random), side(random));
+        gray(marker).setTo(Scalar(3000));
+    }
+    return gray;
+}
+
+// Segmentation before the packed mask: byte mask, outer contours and their moments
+static void segmentContours(const Mat &gray, int threshold, Mat &mask, vector<vector<Point>> &contours, vector<Blob> &blobs)
+{
+    mask = gray > threshold;
+    findContours(mask, contours, RETR_EXTERNAL, CHAIN_APPROX_NONE);
+    blobs.clear();
+    for(const vector<Point> &contour : contours)
+    {
+        Blob blob;
+        blob.bbox = boundingRect(contour);
+        Moments m = moments(contour);
+        blob.area = (int)m.m00;
+        if(m.m00 > 0) blob.centroid = Point2f((float)(m.m10 / m.m00), (float)(m.m01 / m.m00));
+        blobs.push_back(blob);
+    }
+}
+
+// Foreground runs of the packed mask, one Run each in the Segmenter
+static int countRuns(const vector<uint32_t> &mask, int words)
+{
+    int runs = 0;
+    for(size_t row = 0; row < mask.size(); row += words)
+    {
+        uint32_t carry = 0; // last bit of the previous word
+        for(int w = 0; w < words; w++){
+            uint32_t bits = mask[row + w];
+            runs += __builtin_popcount(bits & ~(bits << 1 | carry));
+            carry = bits >> 31;
+        }
+    }
+    return runs;
+}
+
+int main()
+{
+    mt19937 random(39);
+    Segmenter segmenter;
+    segmenter.setStripes(1);
+    vector<Blob> blobs;
+    Mat mask;
+    vector<vector<Point>> contours;
+
+    printf("Segmentation of a %dx%d gray image, packed mask + runs vs byte mask + findContours, one thread\n", WIDTH, HEIGHT);
+    for(int markers : {4, 16, 64, 256})
+    {
+        Mat gray = synthesize(markers, random);
+
+        segmenter.segment(gray, THRESHOLD, blobs);
+        int found = (int)blobs.size();
+        size_t packed = segmenter.packedMask().size() * sizeof(uint32_t)
+                      + countRuns(segmenter.packedMask(), segmenter.packedWords()) * sizeof(Segmenter::Run);
+        segmentContours(gray, THRESHOLD, mask, contours, blobs);
+        size_t bytes = mask.total();
+        for(const vector<Point> &contour : contours) bytes += contour.size() * sizeof(Point) + sizeof(vector<Point>);
+        printf("%d markers, %d blobs (%d contours): packed %.1f KB, byte mask + contours %.1f KB (%.1fx)\n",
+               markers, found, (int)contours.size(), packed / 1024.0, bytes / 1024.0, (double)bytes / packed);
+
+        double runs = measure([&]{
+            segmenter.segment(gray, THRESHOLD, blobs);
+            benchmarkSink = (int)blobs.size();
+        });
+        report("  packed mask + runs", runs, runs);
+        report("  byte mask + findContours", measure([&]{
+            segmentContours(gray, THRESHOLD, mask, contours, blobs);
+            benchmarkSink = (int)blobs.size();
+        }), runs);
+    }
+    return 0;
+}
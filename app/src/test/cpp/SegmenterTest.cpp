@@ -0,0 +1,73 @@
+#include "Check.h"
+#include "Segmenter.h"
+#include <random>
+
+static const int THRESHOLD = 1000;
+
+// Gray image with a random mask of the given density above the threshold, the rest is ambient
+static Mat randomImage(Size size, double density, mt19937 &random)
+{
+    uniform_real_distribution<double> coin(0, 1);
+    uniform_int_distribution<int> retro(THRESHOLD + 1, 4095), ambient(0, THRESHOLD);
+    Mat gray(size, CV_16UC1);
+    for(int y = 0; y < size.height; y++){
+        uint16_t *row = gray.ptr<uint16_t>(y);
+        for(int x = 0; x < size.width; x++) row[x] = (uint16_t)(coin(random) < density ? retro(random) : ambient(random));
+    }
+    return gray;
+}
+
+static bool before(const Blob &a, const Blob &b)
+{
+    if(a.bbox.y != b.bbox.y) return a.bbox.y < b.bbox.y;
+    if(a.bbox.x != b.bbox.x) return a.bbox.x < b.bbox.x;
+    return a.area < b.area;
+}
+
+static void compare(vector<Blob> parallel, vector<Blob> serial)
+{
+    CHECK(parallel.size() == serial.size());
+    if(parallel.size() != serial.size()) return;
+    sort(parallel.begin(), parallel.end(), before);
+    sort(serial.begin(), serial.end(), before);
+    for(size_t i = 0; i < parallel.size(); i++)
+    {
+        const Blob &p = parallel[i], &s = serial[i];
+        CHECK(p.bbox == s.bbox);
+        CHECK(p.area == s.area);
+        CHECK(fabs(p.centroid.x - s.centroid.x) < 1e-3 && fabs(p.centroid.y - s.centroid.y) < 1e-3);
+        CHECK(p.peak == s.peak);
+    }
+}
+
+int main()
+{
+    mt19937 random(35);
+    // widths around the 32 bit words of the packed mask, heights with partial stripes
+    const Size sizes[] = {Size(224, 172), Size(101, 67), Size(64, 48), Size(33, 129)};
+    const double densities[] = {0.01, 0.1, 0.3, 0.5};
+    const int stripes[] = {1, 2, 3, 7};
+
+    Segmenter segmenter;
+    vector<Blob> parallel, serial;
+    for(Size size : sizes){
+        for(double density : densities){
+            Mat gray = randomImage(size, density, random);
+            segmenter.segmentSerial(gray, THRESHOLD, serial);
+            for(int count : stripes){
+                segmenter.setStripes(count);
+                segmenter.segment(gray, THRESHOLD, parallel);
+                compare(parallel, serial);
+            }
+        }
+    }
+
+    // a region of a larger image, as the pyramid detector segments it
+    Mat whole = randomImage(Size(224, 172), 0.2, random);
+    Mat region = whole(Rect(37, 21, 120, 90));
+    segmenter.segmentSerial(region, THRESHOLD, serial);
+    segmenter.setStripes(3);
+    segmenter.segment(region, THRESHOLD, parallel);
+    compare(parallel, serial);
+    return checkFailures;
+}
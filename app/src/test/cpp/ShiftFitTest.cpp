@@ -0,0 +1,107 @@
+#include "Check.h"
+#include "ShiftFit.h"
+#include <random>
+
+// Shift of the setup in pro. pixel, c * e^(a * depth) per axis
+static const Vec4d MODEL(150, -0.02, -80, -0.015);
+static const double MARKER_VARIANCE = 3.0;   // in pro. pixel^2, a centroid quantized on the camera grid
+
+static Point2d shiftAt(double depth, const Vec4d &model = MODEL)
+{
+    return Point2d(model[0] * exp(model[1] * depth), model[2] * exp(model[3] * depth));
+}
+
+// A marker held at every 10 cm from 40 to 140 cm, twice
+static vector<ShiftFit::Sample> markers(mt19937 &random, const Vec4d &model = MODEL)
+{
+    normal_distribution<double> noise(0, sqrt(MARKER_VARIANCE));
+    vector<ShiftFit::Sample> samples;
+    for(int depth = 40; depth <= 140; depth += 10){
+        for(int i = 0; i < 2; i++){
+            Point2d shift = shiftAt(depth, model) + Point2d(noise(random), noise(random));
+            samples.push_back({(double)depth, shift, Point2d(MARKER_VARIANCE, MARKER_VARIANCE)});
+        }
+    }
+    return samples;
+}
+
+// Grid pixels of a wall tilted from 88 to 92 cm. The decoded projector coordinates are off by a
+// few pixels where the stripes are blurred, so the wall shifts differ from the markers by a bias
+// and a spread of their own. Each pixel has the variance of a marker, as calibrate floors it.
+static vector<ShiftFit::Sample> scan(mt19937 &random)
+{
+    normal_distribution<double> noise(0, 2.0);
+    vector<ShiftFit::Sample> samples;
+    for(int y = 0; y < 15; y++){
+        for(int x = 0; x < 20; x++){
+            double depth = 88 + 4.0 * x / 19;
+            Point2d shift = shiftAt(depth) + Point2d(4 + noise(random), -3 + noise(random));
+            samples.push_back({depth, shift, Point2d(MARKER_VARIANCE, MARKER_VARIANCE)});
+        }
+    }
+    return samples;
+}
+
+// Largest relative error of c and of the shift over the range of the markers
+static double error(const Vec4d &fit)
+{
+    double worst = 0;
+    for(int depth = 40; depth <= 140; depth += 5){
+        Point2d expected = shiftAt(depth), fitted = shiftAt(depth, fit);
+        worst = max(worst, fabs(fitted.x - expected.x) / fabs(expected.x));
+        worst = max(worst, fabs(fitted.y - expected.y) / fabs(expected.y));
+    }
+    return worst;
+}
+
+int main()
+{
+    mt19937 random(50);
+
+    // merge is the mean and the sample variance
+    vector<ShiftFit::Sample> three = {{80, Point2d(1, -2), Point2d(0, 0)}, {82, Point2d(3, -2), Point2d(0, 0)},
+                                      {84, Point2d(5, -5), Point2d(0, 0)}};
+    ShiftFit::Sample merged = ShiftFit::merge(three);
+    CHECK(fabs(merged.depth - 82) < 1e-12);
+    CHECK(fabs(merged.shift.x - 3) < 1e-12 && fabs(merged.shift.y + 3) < 1e-12);
+    CHECK(fabs(merged.variance.x - 4) < 1e-12 && fabs(merged.variance.y - 3) < 1e-12);
+
+    // noiseless points give the model back
+    vector<ShiftFit::Sample> exact;
+    for(int depth = 40; depth <= 140; depth += 20) exact.push_back({(double)depth, shiftAt(depth), Point2d(1, 1)});
+    Vec4d fit = ShiftFit::fit(exact);
+    for(int i = 0; i < 4; i++) CHECK(fabs(fit[i] - MODEL[i]) < 1e-6 * fabs(MODEL[i]));
+
+    // markers only, then with a scan merged into one point of its depth
+    vector<ShiftFit::Sample> points = markers(random);
+    double markerError = error(ShiftFit::fit(points));
+    CHECK(markerError < 0.05);
+    vector<ShiftFit::Sample> wall = scan(random);
+    vector<ShiftFit::Sample> withScan = points;
+    withScan.push_back(ShiftFit::merge(wall));
+    fit = ShiftFit::fit(withScan);
+    CHECK(fabs(fit[1] - MODEL[1]) < 0.002 && fabs(fit[3] - MODEL[3]) < 0.002);
+    CHECK(error(fit) < 0.06);
+    // the wall pixels one by one pull the curve to the bias of the wall
+    vector<ShiftFit::Sample> pixels = points;
+    pixels.insert(pixels.end(), wall.begin(), wall.end());
+    double pixelError = error(ShiftFit::fit(pixels));
+    CHECK(pixelError > 2 * error(fit));
+    printf("largest shift error: markers %.1f%%, merged scan %.1f%%, scan pixels %.1f%%\n",
+           100 * markerError, 100 * error(fit), 100 * pixelError);
+
+    // a small shift crosses zero in the noise at far depths; the points of the other sign are
+    // left out instead of being mirrored, c keeps the sign of the setup
+    Vec4d small(3, -0.02, -3, -0.02);
+    fit = ShiftFit::fit(markers(random, small));
+    CHECK(fit[0] > 0 && fit[2] < 0);
+    CHECK(fit[1] < 0 && fit[3] < 0);
+    CHECK(fabs(fit[0] / small[0] - 1) < 0.5 && fabs(fit[2] / small[2] - 1) < 0.5);
+
+    // no fit from less than two points of a sign
+    vector<ShiftFit::Sample> single = {{50, Point2d(5, 0), Point2d(1, 1)}, {60, Point2d(-5, 0), Point2d(1, 1)}};
+    fit = ShiftFit::fit(single);
+    CHECK(fit[0] == 0 && fit[1] == 0 && fit[2] == 0 && fit[3] == 0);
+
+    return checkFailures;
+}
@@ -0,0 +1,78 @@
+#include "Benchmark.h"
+#include "CamListener.h"
+#include "ThreadPool.h"
+#include <random>
+
+static const int WIDTH = 224, HEIGHT = 172; // pico flexx
+
+// Camera which is fed one stream after the other, nothing is detected or published so only
+// the ingestion of the royale data is measured
+class StreamCamera : public CamListener {
+
+public:
+    StreamCamera()
+    {
+        setCamera(WIDTH, HEIGHT, 62, 45);
+        mt19937 random(27);
+        normal_distribution<float> noise(0, 0.005f);
+        uniform_int_distribution<int> ambient(100, 400);
+        data.width = image.width = WIDTH;
+        data.height = image.height = HEIGHT;
+        data.points.resize(WIDTH * HEIGHT);
+        image.cdData.resize(WIDTH * HEIGHT);
+        for(int i = 0; i < WIDTH * HEIGHT; i++)
+        {
+            DepthPoint &p = data.points[i];
+            int x = i % WIDTH, y = i / WIDTH;
+            p.z = 1.5f + noise(random);
+            p.x = (x - WIDTH / 2) * p.z / 210;
+            p.y = (y - HEIGHT / 2) * p.z / 210;
+            p.noise = 0;
+            p.grayValue = (uint16_t)((x % 40) < 4 && (y % 40) < 4 ? 3000 : ambient(random));
+            p.depthConfidence = 255;
+            image.cdData[i] = (uint16_t)(p.z * 1000 + 0.5f); // confidence 0 means 100%
+        }
+    }
+
+    void feed(int stream)
+    {
+        if(stream == DEPTH_DATA) onNewData(&data);
+        else onNewData(&image);
+    }
+
+    size_t bytes(int stream) const
+    {
+        return stream == DEPTH_DATA ? data.points.size() * sizeof(DepthPoint) : image.cdData.size() * sizeof(uint16_t);
+    }
+
+protected:
+    void detectFrame(Frame &frame) override {}
+    void publishFrame(Frame &frame) override {}
+
+private:
+    DepthData data;
+    DepthImage image;
+};
+
+int main()
+{
+    StreamCamera camera;
+    printf("Ingestion of a %dx%d frame per royale stream, the mode selects the stream\n", WIDTH, HEIGHT);
+    for(int deterministic = 1; deterministic >= 0; deterministic--)
+    {
+        ThreadPool::shared().setDeterministic(deterministic);
+        printf(deterministic ? "one thread\n" : "%d pool threads\n", ThreadPool::shared().size());
+        for(int compact = 0; compact < 2; compact++)
+        {
+            camera.setCompactFrames(compact);
+            double depthData = measure([&]{ camera.feed(CamListener::DEPTH_DATA); });
+            char name[64];
+            snprintf(name, sizeof(name), "depth data (%.0f KB), %s", camera.bytes(CamListener::DEPTH_DATA) / 1024.0,
+                     compact ? "compact" : "float");
+            report(name, depthData, depthData);
+            snprintf(name, sizeof(name), "  depth image (%.0f KB), DEPTH mode", camera.bytes(CamListener::DEPTH_IMAGE) / 1024.0);
+            report(name, measure([&]{ camera.feed(CamListener::DEPTH_IMAGE); }), depthData);
+        }
+    }
+    return 0;
+}
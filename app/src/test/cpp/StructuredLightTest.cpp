@@ -0,0 +1,132 @@
+#include "Check.h"
+#include "StructuredLight.h"
+#include <random>
+
+// pico flexx sees a 1280x720 projector a bit larger than its view, every camera pixel averages
+// the projector pixels of its footprint
+static const Size PROJECTOR(1280, 720), CAMERA(224, 172);
+static const Point2f FOOTPRINT(1280 * 1.1f / 224, 720 * 1.1f / 172); // in pro. pixel
+static const Point2f ORIGIN(-60, -40); // projector coordinate of the top left camera pixel
+static const Rect SHADOW(700, 250, 180, 230); // projector pixels which an object blocks, in pro. pixel
+static const int FRAMES = 3; // per pattern
+
+// Projector coordinate of the center of a camera pixel
+static Point2f expected(int x, int y)
+{
+    return Point2f(ORIGIN.x + (x + 0.5f) * FOOTPRINT.x - 0.5f, ORIGIN.y + (y + 0.5f) * FOOTPRINT.y - 0.5f);
+}
+
+// Calls f(px, py) for the projector pixels in the footprint of a camera pixel
+template <typename F>
+static void footprint(int x, int y, F f)
+{
+    for(int dy = 0; dy < (int)FOOTPRINT.y; dy++){
+        for(int dx = 0; dx < (int)FOOTPRINT.x; dx++){
+            f((int)(ORIGIN.x + x * FOOTPRINT.x + dx), (int)(ORIGIN.y + y * FOOTPRINT.y + dy));
+        }
+    }
+}
+
+// Share of the footprint of a camera pixel which is in the shadow
+static float shadowed(int x, int y)
+{
+    int count = 0, dark = 0;
+    footprint(x, y, [&](int px, int py){
+        count++;
+        dark += SHADOW.contains(Point(px, py));
+    });
+    return (float)dark / count;
+}
+
+// Gray image of a pattern: ambient light, the footprint mean with a gain falling off along x,
+// and sensor noise. The shadow gets the ambient light only.
+static void capture(const Mat &pattern, Mat &gray, mt19937 &random)
+{
+    normal_distribution<float> noise(0, 6);
+    gray.create(CAMERA, CV_16UC1);
+    for(int y = 0; y < CAMERA.height; y++){
+        for(int x = 0; x < CAMERA.width; x++)
+        {
+            double sum = 0;
+            int count = 0;
+            footprint(x, y, [&](int px, int py){
+                count++;
+                bool onProjector = px >= 0 && py >= 0 && px < PROJECTOR.width && py < PROJECTOR.height;
+                if(onProjector && !SHADOW.contains(Point(px, py))) sum += pattern.ptr<uint8_t>(py)[px];
+            });
+            float gain = 400 + 3 * x;
+            gray.at<uint16_t>(y, x) = saturate_cast<uint16_t>(150 + gain * sum / count / 255 + noise(random));
+        }
+    }
+}
+
+int main()
+{
+    mt19937 random(50);
+    StructuredLight scan;
+    scan.create(PROJECTOR, CAMERA, FOOTPRINT);
+    CHECK(scan.ready());
+
+    scan.start();
+    Mat pattern, gray;
+    for(int i = 0; i < scan.patterns(); i++)
+    {
+        scan.render(i, pattern);
+        CHECK(pattern.size() == PROJECTOR);
+        for(int f = 0; f < FRAMES; f++){
+            capture(pattern, gray, random);
+            scan.add(i, gray);
+        }
+        scan.endPattern(i);
+    }
+
+    Mat coordinates;
+    int decoded = scan.decode(coordinates);
+    int lit = 0, found = 0, inShadow = 0, edges = 0, edgeWrong = 0, wrong = 0;
+    double error = 0, maxError = 0;
+    for(int y = 0; y < CAMERA.height; y++){
+        for(int x = 0; x < CAMERA.width; x++)
+        {
+            Point2f e = expected(x, y);
+            Vec2f c = coordinates.ptr<Vec2f>(y)[x];
+            bool valid = c[0] >= 0;
+            float dark = shadowed(x, y);
+            if(dark == 1){
+                inShadow += valid;
+                continue;
+            }
+            if(dark > 0){
+                // partly occluded, the lit part of the footprint may be decoded
+                edges += valid;
+                if(valid && max(fabs(c[0] - e.x), fabs(c[1] - e.y)) > FOOTPRINT.x) edgeWrong++;
+                continue;
+            }
+            // the whole footprint lies on the projector
+            bool inside = e.x - FOOTPRINT.x / 2 >= 0 && e.y - FOOTPRINT.y / 2 >= 0 &&
+                          e.x + FOOTPRINT.x / 2 < PROJECTOR.width && e.y + FOOTPRINT.y / 2 < PROJECTOR.height;
+            if(!inside || !valid){
+                lit += inside;
+                continue;
+            }
+            lit++;
+            found++;
+            double d = max(fabs(c[0] - e.x), fabs(c[1] - e.y));
+            if(d > FOOTPRINT.x) wrong++; // a wrong Gray code bit
+            error += d;
+            maxError = max(maxError, d);
+        }
+    }
+    printf("%d patterns, %d pixels decoded, %d of %d lit pixels, mean error %.2f max %.2f pro. pixel, "
+           "%d at the shadow edge (%d off), %d in the shadow\n",
+           scan.patterns(), decoded, found, lit, found > 0 ? error / found : 0, maxError, edges, edgeWrong, inShadow);
+
+    // nearly every lit pixel is decoded, within a fraction of a camera pixel
+    CHECK(found >= lit * 0.98);
+    CHECK(wrong == 0);
+    CHECK(found > 0 && error / found < FOOTPRINT.y / 4);
+    CHECK(maxError < FOOTPRINT.y / 2);
+    // the shadow has no contrast, none of its pixels is decoded, its edge is not decoded far off
+    CHECK(inShadow == 0);
+    CHECK(edgeWrong == 0);
+    return checkFailures;
+}
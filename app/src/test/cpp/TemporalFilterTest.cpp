@@ -0,0 +1,84 @@
+#include "Check.h"
+#include "TemporalFilter.h"
+#include <random>
+
+using namespace std;
+
+static const int WIDTH = 64;
+static const float UNIT = 0.00025f; // state resolution in meters
+
+// One frame of a single row at depth z, returns the filtered depth of the first pixel
+static float feed(TemporalFilter &filter, float z, uint8_t conf, uint8_t *filteredConf = nullptr)
+{
+    vector<Vec3f> xyz(WIDTH, Vec3f(0.1f * z, -0.05f * z, z));
+    vector<uint8_t> confidence(WIDTH, conf);
+    filter.filterRow(0, xyz.data(), confidence.data(), WIDTH);
+    if(filteredConf) *filteredConf = confidence[0];
+    // x and y stay on the ray of the pixel
+    CHECK(fabs(xyz[0][0] - 0.1f * xyz[0][2]) < 1e-4f);
+    return xyz[0][2];
+}
+
+int main()
+{
+    TemporalFilter filter;
+    filter.create(WIDTH, 1);
+
+    // the first sample after a reset seeds depth and confidence
+    uint8_t conf;
+    CHECK(fabs(feed(filter, 1.5f, 200, &conf) - 1.5f) < UNIT);
+    CHECK(conf == 200);
+
+    // a step within the motion gate converges from either side to within one unit
+    float up = 0, down = 0;
+    for(int i = 0; i < 40; i++) up = feed(filter, 1.52f, 200);
+    CHECK(fabs(up - 1.52f) <= UNIT * 1.01f);
+    for(int i = 0; i < 40; i++) down = feed(filter, 1.5f, 200);
+    CHECK(fabs(down - 1.5f) <= UNIT * 1.01f);
+    // a quarter of the step after one frame
+    filter.reset();
+    feed(filter, 1.5f, 200);
+    CHECK(fabs(feed(filter, 1.52f, 200) - 1.505f) < UNIT * 1.01f);
+
+    // symmetric noise does not bias the average
+    mt19937 random(43);
+    normal_distribution<float> noise(0, 0.004f);
+    filter.reset();
+    double sum = 0;
+    int frames = 0;
+    for(int i = 0; i < 4000; i++){
+        float z = feed(filter, 1.5f + noise(random), 200);
+        if(i >= 100){
+            sum += z;
+            frames++;
+        }
+    }
+    CHECK(fabs(sum / frames - 1.5) < UNIT / 2);
+
+    // a sample below the confidence gate holds the average, the confidence is filtered down
+    filter.reset();
+    feed(filter, 1.5f, 200);
+    CHECK(fabs(feed(filter, 1.51f, 20, &conf) - 1.5f) < UNIT);
+    CHECK(conf == 200 - (180 + 2) / 4);
+
+    // motion restarts the average
+    CHECK(fabs(feed(filter, 1.6f, 200) - 1.6f) < UNIT);
+
+    // after a reset the history is gone
+    filter.reset();
+    CHECK(fabs(feed(filter, 0.8f, 120, &conf) - 0.8f) < UNIT);
+    CHECK(conf == 120);
+
+    // compact rows in millimeters
+    filter.reset();
+    vector<uint16_t> depth(WIDTH, 1500);
+    vector<uint8_t> confidence(WIDTH, 200);
+    filter.filterRow(0, depth.data(), confidence.data(), WIDTH);
+    CHECK(depth[0] == 1500 && confidence[0] == 200);
+    for(int i = 0; i < 40; i++){
+        fill(depth.begin(), depth.end(), 1490);
+        filter.filterRow(0, depth.data(), confidence.data(), WIDTH);
+    }
+    CHECK(depth[0] == 1490);
+    return checkFailures;
+}
@@ -0,0 +1,98 @@
+#include "Benchmark.h"
+#include "IngestKernels.h"
+#include "ThreadPool.h"
+#include <random>
+
+static const int WIDTH = 352, HEIGHT = 287; // pico monstar
+
+// Ingestion of a frame in tasks of one row of tiles, as CamListener::updateMaps splits it
+static void ingest(ThreadPool &pool, const vector<DepthPoint> &points, Frame &frame)
+{
+    mutex histMutex;
+    fill(frame.grayHistogram, frame.grayHistogram + Frame::HIST_BINS, 0);
+    pool.parallelFor(0, frame.tileSums.rows, 1, [&](int from, int to)
+    {
+        int local[HIST_LANES * Frame::HIST_BINS] = {0};
+        vector<int> columns (2 * WIDTH);
+        for (int ty = from; ty < to; ty++)
+        {
+            fill(columns.begin(), columns.end(), 0);
+            for (int y = ty * Frame::TILE; y < min((ty + 1) * Frame::TILE, HEIGHT); y++)
+            {
+                IngestRow row;
+                row.xyz = frame.xyzMap.ptr<Vec3f>(y);
+                row.depth = nullptr;
+                row.conf = frame.confMap.ptr<uint8_t>(y);
+                row.gray = frame.grayImage.ptr<uint16_t>(y);
+                row.hist = Frame::histogramRow(y) ? local : nullptr;
+                row.columns = columns.data();
+                row.rowWeight = Frame::tileWeight(y);
+                POINT_KERNELS[0][0][1](points.data() + y * WIDTH, WIDTH, row);
+            }
+            reduceTiles(columns.data(), WIDTH, frame.tileSums.ptr<int>(ty));
+        }
+        lock_guard<mutex> lock (histMutex);
+        mergeHistogram(local, frame.grayHistogram);
+    });
+    benchmarkSink = frame.grayHistogram[10];
+}
+
+// Compute bound rows: a 7x7 box sum of the gray image
+static void boxSum(ThreadPool &pool, const Mat &gray, Mat &sums)
+{
+    pool.parallelFor(3, HEIGHT - 3, 8, [&](int from, int to)
+    {
+        for(int y = from; y < to; y++){
+            int *out = sums.ptr<int>(y);
+            for(int x = 3; x < WIDTH - 3; x++){
+                int sum = 0;
+                for(int dy = -3; dy <= 3; dy++){
+                    const uint16_t *in = gray.ptr<uint16_t>(y + dy);
+                    for(int dx = -3; dx <= 3; dx++) sum += in[x + dx];
+                }
+                out[x] = sum;
+            }
+        }
+    });
+    benchmarkSink = sums.ptr<int>(HEIGHT / 2)[WIDTH / 2];
+}
+
+int main()
+{
+    mt19937 random(34);
+    uniform_int_distribution<int> ambient(100, 400);
+    vector<DepthPoint> points(WIDTH * HEIGHT);
+    for(DepthPoint &p : points){
+        p.x = p.y = 0;
+        p.z = 1.5f;
+        p.noise = 0;
+        p.grayValue = (uint16_t)ambient(random);
+        p.depthConfidence = 255;
+    }
+    Frame frame;
+    frame.create(WIDTH, HEIGHT);
+    Mat gray(Size(WIDTH, HEIGHT), CV_16UC1), sums(Size(WIDTH, HEIGHT), CV_32SC1);
+    for(int y = 0; y < HEIGHT; y++){
+        for(int x = 0; x < WIDTH; x++) gray.ptr<uint16_t>(y)[x] = (uint16_t)ambient(random);
+    }
+
+    int cores = (int)thread::hardware_concurrency();
+    printf("Scaling of the pool from 1 to N threads on %d cores, %dx%d frame\n", cores, WIDTH, HEIGHT);
+    double ingestOne = 0, boxOne = 0;
+    for(int n : {1, 2, 4, 8})
+    {
+        ThreadPool pool(n);
+        double ingestTime = measure([&]{ ingest(pool, points, frame); });
+        double boxTime = measure([&]{ boxSum(pool, gray, sums); });
+        if(n == 1){
+            ingestOne = ingestTime;
+            boxOne = boxTime;
+        }
+        char name[64];
+        snprintf(name, sizeof(name), "%d threads: ingestion", n);
+        report(name, ingestTime, ingestOne);
+        snprintf(name, sizeof(name), "%d threads: 7x7 box sum", n);
+        report(name, boxTime, boxOne);
+    }
+    return 0;
+}
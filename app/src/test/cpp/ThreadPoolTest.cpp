@@ -0,0 +1,76 @@
+#include "Check.h"
+#include "ThreadPool.h"
+#include <chrono>
+#include <set>
+
+// Every index of [begin, end) is visited exactly once
+static bool complete(ThreadPool &pool, int begin, int end, int grain)
+{
+    vector<atomic<int>> visits(max(end, 1));
+    for(auto &v : visits) v = 0;
+    pool.parallelFor(begin, end, grain, [&](int from, int to){
+        for(int i = from; i < to; i++) visits[i]++;
+    });
+    for(int i = 0; i < (int)visits.size(); i++){
+        if(visits[i] != (i >= begin && i < end ? 1 : 0)) return false;
+    }
+    return true;
+}
+
+int main()
+{
+    ThreadPool pool(4);
+    CHECK(pool.size() == 4);
+
+    CHECK(complete(pool, 0, 0, 1));
+    CHECK(complete(pool, 0, 1, 1));
+    CHECK(complete(pool, 0, 5, 16));
+    CHECK(complete(pool, 3, 1000, 1));
+    CHECK(complete(pool, 7, 1000, 13));
+    CHECK(complete(pool, 0, 172, 16));
+    for(int i = 0; i < 200; i++){
+        if(!complete(pool, 0, 100, 1)) { CHECK(false); break; }
+    }
+
+    // nested calls from every worker complete and do not deadlock
+    atomic<int> inner (0);
+    pool.parallelFor(0, 16, 1, [&](int from, int to){
+        for(int i = from; i < to; i++){
+            pool.parallelFor(0, 64, 4, [&](int a, int b){ inner += b - a; });
+        }
+    });
+    CHECK(inner == 16 * 64);
+
+    // a task of the pool splits slow work, its chunks queued at that worker are stolen by the others
+    thread::id owner;
+    mutex idMutex;
+    set<thread::id> runners;
+    pool.parallelFor(0, 2, 1, [&](int from, int){
+        if(from == 0) return;
+        owner = this_thread::get_id();
+        pool.parallelFor(0, 32, 1, [&](int, int){
+            this_thread::sleep_for(chrono::milliseconds(2));
+            lock_guard<mutex> lock (idMutex);
+            runners.insert(this_thread::get_id());
+        });
+    });
+    CHECK(runners.size() > 1);
+    CHECK(runners.count(owner) == 1);
+
+    // deterministic: chunks of grain in order on the calling thread
+    pool.setDeterministic(true);
+    vector<pair<int, int>> chunks;
+    set<thread::id> threads;
+    pool.parallelFor(2, 45, 10, [&](int from, int to){
+        chunks.push_back(make_pair(from, to));
+        threads.insert(this_thread::get_id());
+    });
+    CHECK(chunks.size() == 5);
+    for(int c = 0; c < (int)chunks.size(); c++){
+        CHECK(chunks[c].first == 2 + c * 10);
+        CHECK(chunks[c].second == min(2 + (c + 1) * 10, 45));
+    }
+    CHECK(threads.size() == 1 && threads.count(this_thread::get_id()) == 1);
+    CHECK(complete(pool, 0, 100, 3));
+    return checkFailures;
+}
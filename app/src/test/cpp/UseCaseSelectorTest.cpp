@@ -0,0 +1,27 @@
+#include "Check.h"
+#include "UseCaseSelector.h"
+
+static const int PROBE_FRAMES_45 = 67; // frames of a 1.5 s probe at 45 fps
+
+int main()
+{
+    UseCaseSelector selector;
+
+    // cheap frames run at the maximum of the use case
+    CHECK(selector.frameRateFor(45, PROBE_FRAMES_45, 5000) == 45);
+    // 25 ms per frame leaves 20% of a 32 fps period free
+    CHECK(selector.frameRateFor(45, PROBE_FRAMES_45, 25000) == 32);
+    CHECK(selector.frameRateFor(45, PROBE_FRAMES_45, 17777) == 45); // just fits
+    CHECK(selector.frameRateFor(45, PROBE_FRAMES_45, 17800) == 44);
+    CHECK(selector.frameRateFor(45, PROBE_FRAMES_45, 20000) == 40);
+    // very slow processing still gets a frame rate
+    CHECK(selector.frameRateFor(5, 8, 2000000) == 1);
+
+    // the camera dropped frames, the measurement is not trusted
+    CHECK(selector.frameRateFor(45, PROBE_FRAMES_45 * 9 / 10 - 1, 5000) == 0);
+    CHECK(selector.frameRateFor(45, PROBE_FRAMES_45 * 9 / 10 + 1, 5000) == 45);
+    // nothing measured
+    CHECK(selector.frameRateFor(45, PROBE_FRAMES_45, 0) == 0);
+    CHECK(selector.frameRateFor(45, 0, 5000) == 0);
+    return checkFailures;
+}
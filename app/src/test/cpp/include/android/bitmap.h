@@ -0,0 +1,20 @@
+#pragma once
+
+// Host replacement of jnigraphics, there are no java bitmaps on the host so nothing can be locked
+#include <jni.h>
+#include <cstdint>
+
+enum {ANDROID_BITMAP_RESULT_SUCCESS = 0, ANDROID_BITMAP_RESULT_BAD_PARAMETER = -1};
+enum AndroidBitmapFormat {ANDROID_BITMAP_FORMAT_NONE = 0, ANDROID_BITMAP_FORMAT_RGBA_8888 = 1};
+
+typedef struct {
+    uint32_t width;
+    uint32_t height;
+    uint32_t stride;
+    int32_t format;
+    uint32_t flags;
+} AndroidBitmapInfo;
+
+static inline int AndroidBitmap_getInfo(JNIEnv*, jobject, AndroidBitmapInfo*) { return ANDROID_BITMAP_RESULT_BAD_PARAMETER; }
+static inline int AndroidBitmap_lockPixels(JNIEnv*, jobject, void**) { return ANDROID_BITMAP_RESULT_BAD_PARAMETER; }
+static inline int AndroidBitmap_unlockPixels(JNIEnv*, jobject) { return ANDROID_BITMAP_RESULT_BAD_PARAMETER; }
@@ -0,0 +1,20 @@
+#pragma once
+
+// Host replacement of the NDK log, errors are printed always, the rest when NATIVE_LOG is set
+#include <cstdarg>
+#include <cstdio>
+#include <cstdlib>
+
+enum {ANDROID_LOG_DEBUG = 3, ANDROID_LOG_INFO = 4, ANDROID_LOG_ERROR = 6};
+
+static inline int __android_log_print(int prio, const char *tag, const char *fmt, ...)
+{
+    if(prio < ANDROID_LOG_ERROR && getenv("NATIVE_LOG") == nullptr) return 0;
+    va_list args;
+    va_start(args, fmt);
+    fprintf(stderr, "%s: ", tag);
+    int n = vfprintf(stderr, fmt, args);
+    fputc('\n', stderr);
+    va_end(args);
+    return n;
+}